@@ -0,0 +1,380 @@
+// HeliumBench.cpp — Throughput and allocation benchmarks for the hot paths
+// Builds its fixtures (synthetic caches, a filename corpus, small PDFs)
+// under %TEMP%\HeliumBench, runs each case until it has run long enough to
+// time, and writes the results as JSON in Google Benchmark's layout, so CI
+// can keep one file per commit and existing tooling can diff them.
+//
+//   HeliumBench.exe [--out results.json] [--filter substring] [--quick]
+
+#include "DuplicateCache.h"
+#include "InvoiceRouter.h"
+#include "RelayClient.h"
+#include "ContentHash.h"
+#include <windows.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace Helium;
+
+// ── Allocation counting ───────────────────────────────────────
+
+static std::atomic<uint64_t> g_allocations{0};
+static std::atomic<uint64_t> g_allocatedBytes{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// ── Harness ───────────────────────────────────────────────────
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0;
+    double opsPerSecond = 0;
+    double allocsPerOp = 0;
+    double allocBytesPerOp = 0;
+};
+
+static std::vector<BenchResult> g_results;
+static std::string g_filter;
+static double g_minSeconds = 0.5;
+
+static double SecondsSince(const LARGE_INTEGER& start) {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)(now.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+}
+
+// Runs body(i) for i = 0, 1, ... in doubling rounds until one round takes
+// at least g_minSeconds; that round is reported
+template <typename Body>
+static void Run(const std::string& name, Body body) {
+    if (!g_filter.empty() && name.find(g_filter) == std::string::npos) return;
+
+    body(0);  // Warm up: first-touch page faults, lazy init
+    uint64_t offset = 1;
+
+    BenchResult result;
+    result.name = name;
+    for (uint64_t n = 1;; n *= 2) {
+        uint64_t allocations = g_allocations.load();
+        uint64_t bytes = g_allocatedBytes.load();
+        LARGE_INTEGER start;
+        QueryPerformanceCounter(&start);
+        for (uint64_t i = 0; i < n; i++) {
+            body(offset + i);
+        }
+        double seconds = SecondsSince(start);
+        offset += n;
+
+        if (seconds >= g_minSeconds || n >= (1ull << 30)) {
+            result.iterations = n;
+            result.nsPerOp = seconds * 1e9 / (double)n;
+            result.opsPerSecond = seconds > 0 ? (double)n / seconds : 0;
+            result.allocsPerOp = (double)(g_allocations.load() - allocations) / (double)n;
+            result.allocBytesPerOp = (double)(g_allocatedBytes.load() - bytes) / (double)n;
+            break;
+        }
+    }
+
+    fprintf(stderr, "%-40s %12.0f ns/op %10.2f allocs/op\n",
+            result.name.c_str(), result.nsPerOp, result.allocsPerOp);
+    g_results.push_back(result);
+}
+
+static bool WriteJson(FILE* out) {
+    SYSTEMTIME now;
+    GetSystemTime(&now);
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%04u-%02u-%02uT%02u:%02u:%02uZ\",\n",
+            now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+    fprintf(out, "    \"executable\": \"HeliumBench\"\n  },\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const BenchResult& r = g_results[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %llu, "
+                "\"real_time\": %.3f, \"time_unit\": \"ns\", \"items_per_second\": %.3f, "
+                "\"allocs_per_iter\": %.3f, \"alloc_bytes_per_iter\": %.1f}%s\n",
+                r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp, r.opsPerSecond,
+                r.allocsPerOp, r.allocBytesPerOp, i + 1 < g_results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    return ferror(out) == 0;
+}
+
+// ── Fixtures ──────────────────────────────────────────────────
+
+static std::wstring g_fixtureDir;
+
+static const char* kClients[] = { "GTBank", "MTN", "Airtel", "ExecuJet" };
+
+// Realistic names: what each client's billing system or clerk calls its PDFs
+static std::string ClientFilename(uint64_t i) {
+    char name[128];
+    switch (i % 8) {
+        case 0: sprintf_s(name, "GTBank_Invoice_%04u_%05llu.pdf", 2023u + (unsigned)(i % 3), (unsigned long long)i); break;
+        case 1: sprintf_s(name, "GT-B inv %llu March.pdf", (unsigned long long)i); break;
+        case 2: sprintf_s(name, "MTN_Invoice_NG_%08llu.pdf", (unsigned long long)i); break;
+        case 3: sprintf_s(name, "MTN Bill Statement %llu.pdf", (unsigned long long)i); break;
+        case 4: sprintf_s(name, "Airtel_invoice_%llu.pdf", (unsigned long long)i); break;
+        case 5: sprintf_s(name, "Airtel statement Q%u %llu.pdf", 1u + (unsigned)(i % 4), (unsigned long long)i); break;
+        case 6: sprintf_s(name, "WN%05llu.pdf", (unsigned long long)(i % 100000)); break;
+        default: sprintf_s(name, "INV-%06llu.pdf", (unsigned long long)i); break;
+    }
+    return name;
+}
+
+// Everything else a clerk opens: handbooks, scans, contracts
+static std::string OtherFilename(uint64_t i) {
+    static const char* kNames[] = {
+        "Employee Handbook 2024", "scan0001", "Board minutes", "Contract - signed",
+        "Passport copy", "Q3 report final v2", "Meeting notes", "Brochure",
+    };
+    char name[128];
+    sprintf_s(name, "%s %llu.pdf", kNames[i % 8], (unsigned long long)i);
+    return name;
+}
+
+static std::wstring Widen(const std::string& s) {
+    return std::wstring(s.begin(), s.end());
+}
+
+static bool WriteFileBytes(const std::wstring& path, const void* data, size_t size) {
+    HANDLE hFile = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    DWORD written = 0;
+    BOOL ok = WriteFile(hFile, data, (DWORD)size, &written, nullptr);
+    CloseHandle(hFile);
+    return ok && written == size;
+}
+
+// A wide (version 2) cache of count client-named entries, as older installs
+// and Float's export write it. The first Load migrates it to the compact
+// layout and builds the sidecar index; later Loads time the steady state.
+// Stamped within the last two weeks, so every entry stays in the hot file.
+static std::wstring MakeCache(const wchar_t* tag, uint32_t count) {
+    std::wstring path = g_fixtureDir + L"\\cache-" + tag + L".bin";
+    DeleteFileW((path + L".idx").c_str());
+
+    std::vector<uint8_t> bytes(sizeof(CacheHeader) + (size_t)count * sizeof(CacheEntry));
+    CacheHeader header;
+    header.version = kWideCacheVersion;
+    header.entryCount = count;
+    memcpy(bytes.data(), &header, sizeof(header));
+
+    CacheEntry* entries = (CacheEntry*)(bytes.data() + sizeof(CacheHeader));
+    uint64_t firstStamp = (uint64_t)time(nullptr) - count;
+    for (uint32_t i = 0; i < count; i++) {
+        CacheEntry& e = entries[i];
+        std::string name = ClientFilename(i);
+        memcpy(e.filename, name.c_str(), name.size() + 1);
+        e.submitTimestamp = firstStamp + i;
+        sprintf_s(e.firsReference, "FIRS-%010u", i);
+        sprintf_s(e.submittedBy, "clerk%u@%s.example", i % 20, kClients[i % 4]);
+        e.contentHash = 0x9E3779B97F4A7C15ull * (i + 1);
+    }
+    return WriteFileBytes(path, bytes.data(), bytes.size()) ? path : L"";
+}
+
+// One-page PDF with the given lines in Helvetica, with a correct xref
+static std::wstring MakePdf(const wchar_t* name, const std::vector<std::string>& lines) {
+    std::string content = "BT /F1 11 Tf 72 740 Td 14 TL\n";
+    for (const std::string& line : lines) {
+        content += "(" + line + ") '\n";
+    }
+    content += "ET\n";
+
+    std::vector<std::string> objects = {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+        "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] "
+        "/Resources << /Font << /F1 4 0 R >> >> /Contents 5 0 R >>",
+        "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>",
+        "<< /Length " + std::to_string(content.size()) + " >>\nstream\n" + content + "endstream",
+    };
+
+    std::string pdf = "%PDF-1.4\n";
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < objects.size(); i++) {
+        offsets.push_back(pdf.size());
+        pdf += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+    size_t xref = pdf.size();
+    pdf += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (size_t offset : offsets) {
+        char entry[32];
+        sprintf_s(entry, "%010zu 00000 n \n", offset);
+        pdf += entry;
+    }
+    pdf += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\n";
+    pdf += "startxref\n" + std::to_string(xref) + "\n%%EOF\n";
+
+    std::wstring path = g_fixtureDir + L"\\" + name;
+    return WriteFileBytes(path, pdf.data(), pdf.size()) ? path : L"";
+}
+
+// ── Benchmarks ────────────────────────────────────────────────
+
+static void BenchCache(const wchar_t* tag, const char* label, uint32_t count) {
+    std::wstring path = MakeCache(tag, count);
+    if (path.empty()) {
+        fprintf(stderr, "cache fixture %s: write failed\n", label);
+        return;
+    }
+    std::string suffix = std::string("/") + label;
+
+    // Sidecar index already on disk after the warm-up call
+    Run("cache.load" + suffix, [&](uint64_t) {
+        DuplicateCache cache;
+        cache.Load(path);
+    });
+
+    DuplicateCache cache;
+    cache.Load(path);
+    std::vector<std::string> hits, misses;
+    std::vector<uint64_t> hitHashes;
+    for (uint32_t i = 0; i < 1024; i++) {
+        uint64_t entry = (uint64_t)i * 7919 % count;
+        hits.push_back(ClientFilename(entry));
+        hitHashes.push_back(0x9E3779B97F4A7C15ull * (entry + 1));
+        misses.push_back(OtherFilename(i));
+    }
+
+    Run("cache.check_hit" + suffix, [&](uint64_t i) {
+        cache.Check(hits[i % hits.size()]);
+    });
+    Run("cache.check_miss" + suffix, [&](uint64_t i) {
+        cache.Check(misses[i % misses.size()]);
+    });
+    Run("cache.check_content_hit" + suffix, [&](uint64_t i) {
+        cache.Check(hits[i % hits.size()], hitHashes[i % hitHashes.size()]);
+    });
+}
+
+static void BenchAddEntry() {
+    // Own file: added entries are appended to it by the background writer
+    std::wstring path = MakeCache(L"add", 100000);
+    DuplicateCache cache;
+    cache.Load(path);
+
+    Run("cache.add_entry/100k", [&](uint64_t i) {
+        cache.AddEntry(OtherFilename(i), "FIRS-BENCH", "bench@example", 0x5851F42D4C957F2Dull * (i + 1));
+    });
+    cache.Flush();
+}
+
+static void BenchRouter() {
+    InvoiceRouter router;  // Built-in patterns, no config, no route cache
+
+    std::vector<std::wstring> clientPaths, otherPaths;
+    for (uint64_t i = 0; i < 1024; i++) {
+        clientPaths.push_back(L"C:\\Users\\clerk\\Documents\\Invoices\\" + Widen(ClientFilename(i)));
+        otherPaths.push_back(L"C:\\Users\\clerk\\Documents\\" + Widen(OtherFilename(i)));
+    }
+
+    RouteResult result;
+    Run("router.match_filename/invoice", [&](uint64_t i) {
+        router.RouteFast(clientPaths[i % clientPaths.size()], result);
+    });
+    Run("router.match_filename/other", [&](uint64_t i) {
+        router.RouteFast(otherPaths[i % otherPaths.size()], result);
+    });
+
+    // Filenames that miss Tier 1, so Route() falls through to the content scan
+    std::wstring invoicePdf = MakePdf(L"scan_0001.pdf", {
+        "ACME SUPPLIES NIGERIA LTD", "TAX INVOICE", "Invoice No: 2024-0042",
+        "TIN: 12345678-0001", "Bill To: Helium Logistics", "Subtotal: 200,000.00",
+        "VAT: 15,000.00", "Total Amount: 215,000.00", "Due Date: 30 April 2024",
+    });
+    std::wstring otherPdf = MakePdf(L"scan_0002.pdf", {
+        "Employee Handbook", "Section 1: Working hours", "Staff are expected to arrive by 8am.",
+        "Section 2: Leave", "Annual leave must be requested two weeks ahead.",
+    });
+    if (!invoicePdf.empty()) {
+        Run("router.analyze_content/invoice", [&](uint64_t) { router.Route(invoicePdf); });
+    }
+    if (!otherPdf.empty()) {
+        Run("router.analyze_content/other", [&](uint64_t) { router.Route(otherPdf); });
+    }
+
+    // The field parse alone, over the invoice fixture's page text
+    std::string pageText =
+        "ACME SUPPLIES NIGERIA LTD\nTAX INVOICE\nInvoice No: 2024-0042\nTIN: 12345678-0001\n"
+        "Bill To: Helium Logistics\nSubtotal: 200,000.00\nVAT: 15,000.00\n"
+        "Total Amount: 215,000.00\nDue Date: 30 April 2024\n";
+    Run("router.invoice_fields", [&](uint64_t) {
+        InvoiceFields fields;
+        fields.Parse(pageText);
+    });
+}
+
+static void BenchMultipart() {
+    std::wstring pdfPath = L"C:\\Users\\clerk\\Documents\\Invoices\\GTBank_Invoice_2024_00042.pdf";
+    InvoiceFields fields;
+    fields.tin = "12345678-0001";
+    fields.invoiceNumber = "2024-0042";
+    fields.totalAmount = "215000.00";
+    fields.scanned = true;
+    std::string boundary, preamble, epilogue;
+    Run("relay.multipart_framing", [&](uint64_t) {
+        RelayClient::BuildMultipartFraming(pdfPath, "clerk@gtbank.example", fields, boundary, preamble, epilogue);
+    });
+
+    // The per-byte part of preparing an upload: the body is the mapped file
+    // itself, hashed as it goes out
+    std::vector<uint8_t> body(4 * 1024 * 1024);
+    for (size_t i = 0; i < body.size(); i++) body[i] = (uint8_t)(i * 131);
+    Run("relay.hash_body/4MB", [&](uint64_t) {
+        ContentHasher hasher;
+        hasher.Update(body.data(), body.size());
+        volatile uint64_t sink = hasher.Final();
+        (void)sink;
+    });
+}
+
+int main(int argc, char** argv) {
+    const char* outPath = nullptr;
+    bool quick = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outPath = argv[++i];
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) g_filter = argv[++i];
+        else if (strcmp(argv[i], "--quick") == 0) quick = true;
+    }
+    if (quick) g_minSeconds = 0.05;
+
+    wchar_t temp[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp);
+    g_fixtureDir = std::wstring(temp) + L"HeliumBench";
+    CreateDirectoryW(g_fixtureDir.c_str(), nullptr);
+
+    BenchCache(L"1k", "1k", 1000);
+    BenchCache(L"100k", "100k", 100000);
+    if (!quick) BenchCache(L"1m", "1M", 1000000);  // ~370 MB fixture
+    BenchAddEntry();
+    BenchRouter();
+    BenchMultipart();
+
+    FILE* out = stdout;
+    if (outPath && fopen_s(&out, outPath, "w") != 0) {
+        fprintf(stderr, "can't write %s\n", outPath);
+        return 1;
+    }
+    bool ok = WriteJson(out);
+    if (out != stdout) fclose(out);
+    return ok ? 0 : 1;
+}
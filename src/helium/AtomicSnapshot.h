@@ -0,0 +1,45 @@
+// AtomicSnapshot.h — RCU-style publication of immutable state
+// Readers grab the current snapshot without blocking; a writer builds the
+// replacement off to the side and publishes it with a single atomic swap.
+// The old snapshot is freed when its last reader lets go of it.
+
+#pragma once
+
+#include <memory>
+#include <atomic>
+
+namespace Helium {
+
+template <typename T>
+class AtomicSnapshot {
+public:
+    AtomicSnapshot() = default;
+    AtomicSnapshot(const AtomicSnapshot&) = delete;
+    AtomicSnapshot& operator=(const AtomicSnapshot&) = delete;
+
+    // Current snapshot (may be null before the first Publish)
+    std::shared_ptr<const T> Load() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        return m_ptr.load(std::memory_order_acquire);
+#else
+        return std::atomic_load_explicit(&m_ptr, std::memory_order_acquire);
+#endif
+    }
+
+    void Publish(std::shared_ptr<const T> next) {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        m_ptr.store(std::move(next), std::memory_order_release);
+#else
+        std::atomic_store_explicit(&m_ptr, std::move(next), std::memory_order_release);
+#endif
+    }
+
+private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<std::shared_ptr<const T>> m_ptr;
+#else
+    std::shared_ptr<const T> m_ptr;
+#endif
+};
+
+} // namespace Helium
@@ -0,0 +1,294 @@
+// BatchSubmission.cpp — Submit many invoices at once
+
+#include "BatchSubmission.h"
+#include "StringUtil.h"
+
+namespace Helium {
+
+// Relay serializes FIRS calls per tenant; a few uploads in parallel keep it
+// busy without tripping its rate limit
+static const size_t kMaxParallel = 4;
+
+// Throttled (429 + Retry-After) attempts per file before it counts as failed
+static const int kMaxAttempts = 4;
+
+// Cap on a single Retry-After wait
+static const int kMaxBackoffSeconds = 120;
+
+BatchSubmission::BatchSubmission(RelayClient& relay, DuplicateCache& cache)
+    : m_relay(relay), m_cache(cache), m_limit(kMaxParallel) {
+    m_hDone = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    m_resumeTimer = CreateThreadpoolTimer(&BatchSubmission::ResumeTimerCallback, this, nullptr);
+}
+
+BatchSubmission::~BatchSubmission() {
+    if (m_resumeTimer) {
+        SetThreadpoolTimer(m_resumeTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(m_resumeTimer, TRUE);
+        CloseThreadpoolTimer(m_resumeTimer);
+    }
+    if (m_hDone) {
+        CloseHandle(m_hDone);
+    }
+}
+
+void BatchSubmission::Start(const std::vector<std::wstring>& pdfPaths, const SessionInfo& session,
+                            const BatchProgressCallback& onProgress, const BatchDoneCallback& onDone) {
+    m_session = session;
+    m_onProgress = onProgress;
+    m_onDone = onDone;
+
+    std::vector<size_t> changed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_files.resize(pdfPaths.size());
+        m_attempts.assign(pdfPaths.size(), 0);
+
+        // Pre-check by name first — no file access, and most month-end
+        // re-submissions are caught here. Content duplicates (renamed
+        // copies, the same file in two tabs) are caught once each is hashed.
+        for (size_t i = 0; i < pdfPaths.size(); i++) {
+            BatchFileProgress& file = m_files[i];
+            file.pdfPath = pdfPaths[i];
+
+            DuplicateCheckResult dupCheck = m_cache.Check(Utf8Filename(file.pdfPath));
+            if (dupCheck.status == DuplicateStatus::AlreadySubmitted) {
+                file.status = BatchFileStatus::Skipped;
+                file.firsReference = dupCheck.firsReference;
+                file.error = "Already submitted by " + dupCheck.submittedBy;
+            } else {
+                m_queue.push_back(i);
+            }
+            changed.push_back(i);
+        }
+    }
+
+    ReportAll(changed);
+    Pump();
+}
+
+void BatchSubmission::Cancel() {
+    std::vector<std::shared_ptr<SubmitOperation>> inFlight;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+        m_paused = false;
+        for (const auto& entry : m_inFlight) {
+            inFlight.push_back(entry.second);
+        }
+    }
+    if (m_resumeTimer) {
+        SetThreadpoolTimer(m_resumeTimer, nullptr, 0, 0);
+    }
+
+    // Each completes through OnFileFinished as cancelled
+    for (const auto& op : inFlight) {
+        op->Cancel();
+    }
+    Pump();
+}
+
+void BatchSubmission::Wait() {
+    if (m_hDone) {
+        WaitForSingleObject(m_hDone, INFINITE);
+    }
+}
+
+bool BatchSubmission::IsDone() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_done;
+}
+
+void BatchSubmission::Pump() {
+    std::vector<size_t> changed;
+    bool finished = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_done) return;
+
+        // Cancelled, or over the daily limit: nothing queued will go through
+        if (m_cancelled || !m_stopReason.empty()) {
+            for (size_t index : m_queue) {
+                BatchFileProgress& file = m_files[index];
+                file.status = m_cancelled ? BatchFileStatus::Cancelled : BatchFileStatus::Failed;
+                file.error = m_cancelled ? "Submission cancelled" : m_stopReason;
+                changed.push_back(index);
+            }
+            m_queue.clear();
+        }
+
+        std::shared_ptr<BatchSubmission> self = shared_from_this();
+        while (!m_paused && !m_queue.empty() && m_inFlight.size() < m_limit) {
+            size_t index = m_queue.front();
+            m_queue.pop_front();
+            BatchFileProgress& file = m_files[index];
+            std::string filename = Utf8Filename(file.pdfPath).Str();
+
+            // Callbacks wait on m_mutex until this pass is done
+            std::shared_ptr<SubmitOperation> op = m_relay.SubmitInvoiceAsync(
+                file.pdfPath, m_session.username, m_session.token,
+                [self, index, filename](uint64_t contentHash) {
+                    DuplicateCheckResult dupCheck = self->m_cache.Check(filename, contentHash);
+                    std::lock_guard<std::mutex> lock(self->m_mutex);
+                    BatchFileProgress& file = self->m_files[index];
+                    if (dupCheck.status == DuplicateStatus::AlreadySubmitted) {
+                        file.firsReference = dupCheck.firsReference;
+                        file.error = "Already submitted by " + dupCheck.submittedBy;
+                        return false;
+                    }
+                    if (!self->m_batchHashes.insert(contentHash).second) {
+                        file.error = "Same document as another file in this batch";
+                        return false;
+                    }
+                    return true;
+                },
+                [self, index](uint64_t sent, uint64_t total) {
+                    bool moved;
+                    {
+                        std::lock_guard<std::mutex> lock(self->m_mutex);
+                        BatchFileProgress& file = self->m_files[index];
+                        uint64_t before = file.total ? file.sent * 100 / file.total : 0;
+                        file.sent = sent;
+                        file.total = total;
+                        moved = (total ? sent * 100 / total : 0) != before;
+                    }
+                    // Per percent, not per 64 KB write
+                    if (moved) self->Report(index);
+                },
+                [self, index](const SubmitResult& result) {
+                    self->OnFileFinished(index, result);
+                }
+            );
+
+            if (!op) {
+                file.status = BatchFileStatus::Failed;
+                file.error = "Could not start the submission";
+            } else {
+                file.status = BatchFileStatus::Uploading;
+                file.sent = 0;
+                m_inFlight[index] = op;
+            }
+            changed.push_back(index);
+        }
+
+        if (m_queue.empty() && m_inFlight.empty()) {
+            m_done = true;
+            finished = true;
+        }
+    }
+
+    ReportAll(changed);
+
+    if (finished) {
+        BatchSummary summary;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const BatchFileProgress& file : m_files) {
+                switch (file.status) {
+                case BatchFileStatus::Submitted: summary.submitted++; break;
+                case BatchFileStatus::Skipped:   summary.skipped++; break;
+                case BatchFileStatus::Cancelled: summary.cancelled++; break;
+                default:                         summary.failed++; break;
+                }
+            }
+        }
+        if (m_onDone) {
+            m_onDone(summary);
+        }
+        SetEvent(m_hDone);
+    }
+}
+
+void BatchSubmission::OnFileFinished(size_t index, const SubmitResult& result) {
+    // Before reporting, so a UI refresh already sees it as submitted
+    if (result.success) {
+        m_cache.AddEntry(Utf8Filename(m_files[index].pdfPath).Str(), result.firsReference, m_session.username, result.contentHash);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inFlight.erase(index);
+        BatchFileProgress& file = m_files[index];
+
+        // Free the hash for a retry — unless another file owns it
+        if (!result.success && !result.blocked && result.contentHash) {
+            m_batchHashes.erase(result.contentHash);
+        }
+
+        if (result.success) {
+            file.status = BatchFileStatus::Submitted;
+            file.firsReference = result.firsReference;
+            file.error.clear();
+
+            // Additive increase: earn back parallelism after a 429
+            if (m_limit < kMaxParallel && ++m_cleanRun >= m_limit) {
+                m_limit++;
+                m_cleanRun = 0;
+            }
+        } else if (result.blocked) {
+            file.status = BatchFileStatus::Skipped;     // error set by the content check
+        } else if (result.cancelled) {
+            file.status = BatchFileStatus::Cancelled;
+            file.error = result.error;
+        } else if (result.retryAfterSeconds > 0 && !m_cancelled && ++m_attempts[index] < kMaxAttempts) {
+            // Throttled: retry this file first, with half the parallelism,
+            // once Relay's Retry-After has passed
+            file.status = BatchFileStatus::Queued;
+            file.error = result.error;
+            file.sent = 0;
+            m_queue.push_front(index);
+            m_limit = m_limit > 1 ? m_limit / 2 : 1;
+            m_cleanRun = 0;
+
+            if (!m_paused && m_resumeTimer) {
+                m_paused = true;
+                int seconds = result.retryAfterSeconds < kMaxBackoffSeconds ? result.retryAfterSeconds
+                                                                            : kMaxBackoffSeconds;
+                ULARGE_INTEGER due;
+                due.QuadPart = (ULONGLONG)(-(LONGLONG)seconds * 10000000);
+                FILETIME dueTime;
+                dueTime.dwLowDateTime = due.LowPart;
+                dueTime.dwHighDateTime = due.HighPart;
+                SetThreadpoolTimer(m_resumeTimer, &dueTime, 0, 0);
+            }
+        } else {
+            file.status = BatchFileStatus::Failed;
+            file.error = result.error;
+
+            // 429 without Retry-After is the daily limit, not throttling
+            if (result.httpStatus == 429 && result.retryAfterSeconds == 0) {
+                m_stopReason = result.error;
+            }
+        }
+    }
+
+    Report(index);
+    Pump();
+}
+
+void CALLBACK BatchSubmission::ResumeTimerCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+    auto self = (BatchSubmission*)context;
+    {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        self->m_paused = false;
+    }
+    self->Pump();
+}
+
+void BatchSubmission::Report(size_t index) {
+    if (!m_onProgress) return;
+    BatchFileProgress progress;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        progress = m_files[index];
+    }
+    m_onProgress(index, progress);
+}
+
+void BatchSubmission::ReportAll(const std::vector<size_t>& indices) {
+    for (size_t index : indices) {
+        Report(index);
+    }
+}
+
+} // namespace Helium
@@ -0,0 +1,107 @@
+// BatchSubmission.h — Submit many invoices at once (all open tabs, a folder)
+// One duplicate pre-check pass, one session, and a small pool of concurrent
+// uploads that backs off when Relay throttles (429 + Retry-After).
+
+#pragma once
+
+#include "RelayClient.h"
+#include "DuplicateCache.h"
+#include "SessionToken.h"
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_set>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace Helium {
+
+enum class BatchFileStatus {
+    Queued,
+    Uploading,
+    Submitted,
+    Skipped,        // Already submitted (by name, or same content as another file)
+    Failed,
+    Cancelled
+};
+
+struct BatchFileProgress {
+    std::wstring pdfPath;
+    BatchFileStatus status = BatchFileStatus::Queued;
+    uint64_t sent = 0;              // Upload bytes, while Uploading
+    uint64_t total = 0;
+    std::string firsReference;      // Submitted, or the earlier submission when Skipped
+    std::string error;
+};
+
+struct BatchSummary {
+    size_t submitted = 0;
+    size_t skipped = 0;
+    size_t failed = 0;
+    size_t cancelled = 0;
+};
+
+// index is the file's position in the list passed to Start(). Both run on
+// thread-pool / WinHTTP threads.
+using BatchProgressCallback = std::function<void(size_t index, const BatchFileProgress& progress)>;
+using BatchDoneCallback = std::function<void(const BatchSummary& summary)>;
+
+class BatchSubmission : public std::enable_shared_from_this<BatchSubmission> {
+public:
+    BatchSubmission(RelayClient& relay, DuplicateCache& cache);
+    ~BatchSubmission();
+
+    BatchSubmission(const BatchSubmission&) = delete;
+    BatchSubmission& operator=(const BatchSubmission&) = delete;
+
+    // Pre-check every file against the cache, then upload the rest. Returns
+    // once uploads are under way; onDone runs exactly once (possibly before
+    // this returns, if nothing needed uploading).
+    void Start(const std::vector<std::wstring>& pdfPaths, const SessionInfo& session,
+               const BatchProgressCallback& onProgress, const BatchDoneCallback& onDone);
+
+    // Drop queued files and cancel the uploads in flight
+    void Cancel();
+
+    // Block until onDone has returned. Not from inside a callback.
+    void Wait();
+
+    // onDone has run (or is running)
+    bool IsDone();
+
+private:
+    RelayClient& m_relay;
+    DuplicateCache& m_cache;
+    SessionInfo m_session;
+    BatchProgressCallback m_onProgress;
+    BatchDoneCallback m_onDone;
+
+    std::mutex m_mutex;
+    std::vector<BatchFileProgress> m_files;
+    std::vector<int> m_attempts;
+    std::deque<size_t> m_queue;
+    std::map<size_t, std::shared_ptr<SubmitOperation>> m_inFlight;
+    std::unordered_set<uint64_t> m_batchHashes;     // Content uploaded (or uploading) by this batch
+    size_t m_limit;                                 // Current parallelism; halves on 429
+    size_t m_cleanRun = 0;                          // Successes since the last change to m_limit
+    bool m_paused = false;                          // Waiting out a Retry-After
+    bool m_cancelled = false;
+    bool m_done = false;
+    std::string m_stopReason;                       // Daily limit hit — fail what's left
+
+    PTP_TIMER m_resumeTimer = nullptr;
+    HANDLE m_hDone = nullptr;
+
+    // Start uploads up to the limit; finish the batch when nothing is left
+    void Pump();
+    void OnFileFinished(size_t index, const SubmitResult& result);
+    void Report(size_t index);
+    void ReportAll(const std::vector<size_t>& indices);
+
+    static void CALLBACK ResumeTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+};
+
+} // namespace Helium
@@ -0,0 +1,220 @@
+// CacheShard.cpp — Immutable monthly archive of duplicate-cache entries
+
+#include "CacheShard.h"
+#include <fstream>
+#include <cstring>
+
+namespace Helium {
+
+// ~10 bits per key with seven probes: about 1% false positives
+static const uint32_t kBloomBitsPerKey = 10;
+static const uint32_t kBloomHashes = 7;
+
+// Filename hashes (FNV) and content hashes (XXH64) share the filter; a
+// finalizer spreads both before the double hashing
+static uint64_t MixKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+static void BloomAdd(std::vector<uint64_t>& bloom, uint32_t mask, uint64_t key) {
+    uint64_t mixed = MixKey(key);
+    uint32_t h1 = (uint32_t)mixed;
+    uint32_t h2 = (uint32_t)(mixed >> 32) | 1;
+    for (uint32_t i = 0; i < kBloomHashes; i++) {
+        uint32_t bit = (h1 + i * h2) & mask;
+        bloom[bit >> 6] |= 1ull << (bit & 63);
+    }
+}
+
+std::shared_ptr<CacheShard> CacheShard::Open(const std::wstring& path) {
+    std::ifstream file(path, std::ios::binary);
+    ShardHeader header;
+    ShardHeader expected;
+    if (!file.is_open() ||
+        !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != expected.magic || header.version != expected.version ||
+        header.bloomBits < 64 || (header.bloomBits & (header.bloomBits - 1)) != 0 ||
+        header.slotCount <= header.entryCount || (header.slotCount & (header.slotCount - 1)) != 0) {
+        return nullptr;
+    }
+
+    auto shard = std::make_shared<CacheShard>();
+    shard->m_path = path;
+    shard->m_header = header;
+    shard->m_bloom.resize(header.bloomBits / 64);
+    if (!file.read(reinterpret_cast<char*>(shard->m_bloom.data()),
+                   (std::streamsize)(shard->m_bloom.size() * sizeof(uint64_t)))) {
+        return nullptr;
+    }
+    return shard;
+}
+
+bool CacheShard::Write(const std::wstring& path, uint32_t month, const std::vector<CacheEntry>& entries) {
+    std::unordered_map<std::string, uint32_t> users;
+    std::vector<CacheRecord> records;
+    std::string strings;
+    if (!CacheSnapshot::Encode(entries, 0, users, records, strings)) return false;
+
+    ShardHeader header;
+    header.month = month;
+    header.entryCount = (uint32_t)records.size();
+    header.heapBytes = strings.size();
+    header.bloomBits = 64;
+    while (header.bloomBits < 2 * header.entryCount * kBloomBitsPerKey) {
+        header.bloomBits <<= 1;
+    }
+    header.slotCount = 16;
+    while (header.slotCount < header.entryCount * 2) {
+        header.slotCount <<= 1;
+    }
+
+    // Same tables as the hot file's sidecar index; first entry for a key wins
+    std::vector<uint64_t> bloom(header.bloomBits / 64, 0);
+    std::vector<IndexSlot> slots(2 * (size_t)header.slotCount, IndexSlot{0, 0});
+    uint32_t slotMask = header.slotCount - 1;
+    auto insert = [slotMask](IndexSlot* table, uint64_t hash, uint32_t entry) {
+        uint32_t slot = (uint32_t)hash & slotMask;
+        while (table[slot].entry != 0) {
+            slot = (slot + 1) & slotMask;
+        }
+        table[slot].hash = (uint32_t)(hash >> 32);
+        table[slot].entry = entry;
+    };
+
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        const CacheRecord& record = records[i];
+        uint64_t nameHash = CacheSnapshot::HashFilename(strings.data() + record.filenameOffset,
+                                                        record.filenameLength);
+        insert(slots.data(), nameHash, i + 1);
+        BloomAdd(bloom, header.bloomBits - 1, nameHash);
+        if (record.contentHash != 0) {
+            insert(slots.data() + header.slotCount, record.contentHash, i + 1);
+            BloomAdd(bloom, header.bloomBits - 1, record.contentHash);
+        }
+    }
+
+    std::wstring tempPath = path + L".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(bloom.data()), bloom.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(IndexSlot));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(CacheRecord));
+    file.write(strings.data(), (std::streamsize)strings.size());
+    file.close();
+
+    if (file.fail() ||
+        !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool CacheShard::MayContain(uint64_t key) const {
+    if (m_header.entryCount == 0) return false;
+
+    uint64_t mixed = MixKey(key);
+    uint32_t h1 = (uint32_t)mixed;
+    uint32_t h2 = (uint32_t)(mixed >> 32) | 1;
+    uint32_t mask = m_header.bloomBits - 1;
+    for (uint32_t i = 0; i < kBloomHashes; i++) {
+        uint32_t bit = (h1 + i * h2) & mask;
+        if ((m_bloom[bit >> 6] & (1ull << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CacheShard::FindByContent(uint64_t contentHash, CacheEntry& entry) {
+    if (contentHash == 0 || !EnsureMapped()) return false;
+
+    uint32_t mask = m_header.slotCount - 1;
+    uint32_t tag = (uint32_t)(contentHash >> 32);
+    uint32_t slot = (uint32_t)contentHash & mask;
+    for (uint32_t probes = 0; probes <= mask; probes++) {
+        const IndexSlot& s = m_contentSlots[slot];
+        if (s.entry == 0) {
+            break;
+        }
+        if (s.hash == tag && s.entry <= m_header.entryCount &&
+            m_records[s.entry - 1].contentHash == contentHash) {
+            entry = CacheSnapshot::Decode(m_records[s.entry - 1], m_heap, m_header.heapBytes);
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return false;
+}
+
+bool CacheShard::Find(std::string_view filename, CacheEntry& entry) {
+    if (!EnsureMapped()) return false;
+
+    uint64_t hash = CacheSnapshot::HashFilename(filename.data(), filename.size());
+    uint32_t mask = m_header.slotCount - 1;
+    uint32_t tag = (uint32_t)(hash >> 32);
+    uint32_t slot = (uint32_t)hash & mask;
+    for (uint32_t probes = 0; probes <= mask; probes++) {
+        const IndexSlot& s = m_slots[slot];
+        if (s.entry == 0) {
+            break;
+        }
+        if (s.hash == tag && s.entry <= m_header.entryCount) {
+            const CacheRecord& record = m_records[s.entry - 1];
+            if (CacheSnapshot::HeapString(m_heap, m_header.heapBytes, record.filenameOffset,
+                                          record.filenameLength) == filename) {
+                entry = CacheSnapshot::Decode(record, m_heap, m_header.heapBytes);
+                return true;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+    return false;
+}
+
+bool CacheShard::ReadAll(std::vector<CacheEntry>& entries) {
+    if (!EnsureMapped()) return false;
+
+    entries.reserve(entries.size() + m_header.entryCount);
+    for (uint32_t i = 0; i < m_header.entryCount; i++) {
+        entries.push_back(CacheSnapshot::Decode(m_records[i], m_heap, m_header.heapBytes));
+    }
+    return true;
+}
+
+bool CacheShard::EnsureMapped() {
+    if (m_mapped.load(std::memory_order_acquire)) return true;
+
+    std::lock_guard<std::mutex> lock(m_mapMutex);
+    if (m_mapped.load(std::memory_order_relaxed)) return true;
+
+    // The summary must describe this very file — a rewrite since (a late
+    // arrival merged in) is picked up by the next snapshot's shard list
+    if (!m_file.Open(m_path) || m_file.Size() < FileSize(m_header) ||
+        memcmp(m_file.Data(), &m_header, sizeof(m_header)) != 0) {
+        m_file.Close();
+        return false;
+    }
+
+    const uint8_t* p = m_file.Data() + sizeof(ShardHeader) + m_header.bloomBits / 8;
+    m_slots = reinterpret_cast<const IndexSlot*>(p);
+    m_contentSlots = m_slots + m_header.slotCount;
+    m_records = reinterpret_cast<const CacheRecord*>(m_contentSlots + m_header.slotCount);
+    m_heap = reinterpret_cast<const char*>(m_records + m_header.entryCount);
+    m_mapped.store(true, std::memory_order_release);
+    return true;
+}
+
+uint64_t CacheShard::FileSize(const ShardHeader& header) {
+    return sizeof(ShardHeader) + header.bloomBits / 8 +
+           2 * (uint64_t)header.slotCount * sizeof(IndexSlot) +
+           (uint64_t)header.entryCount * sizeof(CacheRecord) + header.heapBytes;
+}
+
+} // namespace Helium
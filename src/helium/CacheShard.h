@@ -0,0 +1,78 @@
+// CacheShard.h — Immutable monthly archive of duplicate-cache entries
+// The duplicate cache keeps the current and previous month in its hot file
+// and rolls older submissions out into one shard per month. Opening a shard
+// reads only its header and bloom summary; the shard is mapped the first time
+// the summary reports a possible hit, so a Check() miss never touches it.
+//
+// File layout: [ShardHeader][bloom bits][IndexSlot x slotCount]  (by filename)
+//              [IndexSlot x slotCount]                             (by content)
+//              [CacheRecord x entryCount][string bytes]
+
+#pragma once
+
+#include "DuplicateCache.h"
+#include "MappedFile.h"
+#include <windows.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace Helium {
+
+#pragma pack(push, 1)
+struct ShardHeader {
+    uint32_t magic = 0x44485348;     // "HSHD"
+    uint32_t version = 1;
+    uint32_t month = 0;              // YYYYMM (UTC) of every entry
+    uint32_t entryCount = 0;
+    uint32_t bloomBits = 0;          // Power of two, at least 64
+    uint32_t slotCount = 0;          // Per table; power of two
+    uint64_t heapBytes = 0;
+};
+#pragma pack(pop)
+
+class CacheShard {
+public:
+    // Read the header and bloom summary; the rest stays on disk. nullptr if
+    // the file is missing or not a shard.
+    static std::shared_ptr<CacheShard> Open(const std::wstring& path);
+
+    // Write entries as a shard (temp file + atomic swap)
+    static bool Write(const std::wstring& path, uint32_t month, const std::vector<CacheEntry>& entries);
+
+    uint32_t Month() const { return m_header.month; }
+    uint32_t EntryCount() const { return m_header.entryCount; }
+    const std::wstring& Path() const { return m_path; }
+
+    // False: key is certainly not in this shard. Lock-free; keys are
+    // CacheSnapshot::HashFilename() of a filename, or a content hash.
+    bool MayContain(uint64_t key) const;
+
+    // First entry with this key. Maps the shard on first use.
+    bool FindByContent(uint64_t contentHash, CacheEntry& entry);
+    bool Find(std::string_view filename, CacheEntry& entry);
+
+    // Every entry, for merging late arrivals into the month
+    bool ReadAll(std::vector<CacheEntry>& entries);
+
+private:
+    std::wstring m_path;
+    ShardHeader m_header;
+    std::vector<uint64_t> m_bloom;
+
+    std::mutex m_mapMutex;
+    std::atomic<bool> m_mapped{false};
+    MappedFile m_file;
+    const IndexSlot* m_slots = nullptr;
+    const IndexSlot* m_contentSlots = nullptr;
+    const CacheRecord* m_records = nullptr;
+    const char* m_heap = nullptr;
+
+    bool EnsureMapped();
+    static uint64_t FileSize(const ShardHeader& header);
+};
+
+} // namespace Helium
@@ -0,0 +1,155 @@
+// ContentHash.cpp — Streaming XXH64 hash of document bytes
+// Reference algorithm: https://github.com/Cyan4973/xxHash (seed 0)
+
+#include "ContentHash.h"
+#include <windows.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace Helium {
+
+static const uint64_t kPrime1 = 11400714785074694791ULL;
+static const uint64_t kPrime2 = 14029467366897019727ULL;
+static const uint64_t kPrime3 = 1609587929392839161ULL;
+static const uint64_t kPrime4 = 9650029242287828579ULL;
+static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+// Large sequential reads — the hash runs far faster than the disk does
+static const DWORD kReadChunk = 256 * 1024;
+
+static inline uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = Rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t value) {
+    acc ^= Round(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+
+ContentHasher::ContentHasher() {
+    m_acc[0] = kPrime1 + kPrime2;
+    m_acc[1] = kPrime2;
+    m_acc[2] = 0;
+    m_acc[3] = 0 - kPrime1;
+}
+
+void ContentHasher::Update(const void* data, size_t length) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + length;
+    m_totalLength += length;
+
+    // Top up a partial stripe left from the previous chunk
+    if (m_buffered > 0) {
+        size_t take = std::min(sizeof(m_buffer) - m_buffered, length);
+        memcpy(m_buffer + m_buffered, p, take);
+        m_buffered += take;
+        p += take;
+        if (m_buffered < sizeof(m_buffer)) {
+            return;
+        }
+        for (int i = 0; i < 4; i++) {
+            m_acc[i] = Round(m_acc[i], Read64(m_buffer + i * 8));
+        }
+        m_buffered = 0;
+    }
+
+    // Whole 32-byte stripes straight from the caller's buffer
+    while (end - p >= 32) {
+        m_acc[0] = Round(m_acc[0], Read64(p));
+        m_acc[1] = Round(m_acc[1], Read64(p + 8));
+        m_acc[2] = Round(m_acc[2], Read64(p + 16));
+        m_acc[3] = Round(m_acc[3], Read64(p + 24));
+        p += 32;
+    }
+
+    if (p < end) {
+        m_buffered = (size_t)(end - p);
+        memcpy(m_buffer, p, m_buffered);
+    }
+}
+
+uint64_t ContentHasher::Final() const {
+    uint64_t h;
+    if (m_totalLength >= 32) {
+        h = Rotl(m_acc[0], 1) + Rotl(m_acc[1], 7) + Rotl(m_acc[2], 12) + Rotl(m_acc[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = MergeRound(h, m_acc[i]);
+        }
+    } else {
+        h = kPrime5;  // Seed 0: accumulators never started
+    }
+    h += m_totalLength;
+
+    const uint8_t* p = m_buffer;
+    const uint8_t* end = m_buffer + m_buffered;
+    while (end - p >= 8) {
+        h ^= Round(0, Read64(p));
+        h = Rotl(h, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= (uint64_t)Read32(p) * kPrime1;
+        h = Rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * kPrime5;
+        h = Rotl(h, 11) * kPrime1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+
+    return h != 0 ? h : 1;
+}
+
+bool ContentHasher::HashFile(const std::wstring& path, uint64_t& hash) {
+    HANDLE hFile = CreateFileW(
+        path.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+    );
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    ContentHasher hasher;
+    std::vector<uint8_t> buffer(kReadChunk);
+    DWORD bytesRead = 0;
+    bool ok;
+    while ((ok = ReadFile(hFile, buffer.data(), kReadChunk, &bytesRead, nullptr) != 0) && bytesRead > 0) {
+        hasher.Update(buffer.data(), bytesRead);
+    }
+    CloseHandle(hFile);
+
+    if (!ok) {
+        return false;
+    }
+    hash = hasher.Final();
+    return true;
+}
+
+} // namespace Helium
@@ -0,0 +1,34 @@
+// ContentHash.h — Streaming XXH64 hash of document bytes
+// Feeds the content index of the duplicate cache; computed while the PDF is
+// read for upload, so the file is never read twice
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace Helium {
+
+class ContentHasher {
+public:
+    ContentHasher();
+
+    // Hash the next chunk; chunks may be any size
+    void Update(const void* data, size_t length);
+
+    // Hash of everything fed so far. Never 0 — 0 means "no content hash"
+    // in the cache (entries recorded before content hashing existed).
+    uint64_t Final() const;
+
+    // Hash a whole file. Returns false if it cannot be read.
+    static bool HashFile(const std::wstring& path, uint64_t& hash);
+
+private:
+    uint64_t m_acc[4];
+    uint8_t m_buffer[32];
+    size_t m_buffered = 0;
+    uint64_t m_totalLength = 0;
+};
+
+} // namespace Helium
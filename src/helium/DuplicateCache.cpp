@@ -1,148 +1,1251 @@
 // DuplicateCache.cpp — Memory-mapped binary cache for duplicate detection
+//
+// File layout: [CompactCacheHeader][CacheRecord x entryCount] (submitted-invoices.cache)
+//              [string bytes ...]                            (submitted-invoices.cache.str)
+//              [IndexHeader][IndexSlot x slotCount]           (submitted-invoices.cache.idx)
+//                           [IndexSlot x slotCount]           (by filename, then by content)
+//              [CacheShard]                      (submitted-invoices.cache.YYYYMM.shard)
+//
+// Both hot files are append-only: a record's strings are written past the
+// heap's committed length and the record past the current entryCount, both
+// flushed before the header (count and heap length) is bumped, so a crash at
+// any point leaves either the old or the new state, never a truncated file.
+// A full rewrite (Save) only re-lays the records. Once a month the writer
+// rolls everything older than the previous month out into per-month shards,
+// then re-lays the hot file over a new heap generation; a crash in between
+// leaves entries in both places, which lookups and the next roll tolerate.
+// Transforma is the only writer; Float's submissions arrive through sync.
 
 #include "DuplicateCache.h"
+#include "CacheShard.h"
+#include "LatencyStats.h"
 #include <fstream>
+#include <algorithm>
+#include <map>
+#include <unordered_set>
 #include <cstring>
+#include <cstddef>
 #include <ctime>
+#include <chrono>
 
 namespace Helium {
 
+// Unindexed entries tolerated before the on-disk index is rebuilt
+static const uint32_t kCompactThreshold = 256;
+
+// Float signals this after writing its export; directory changes cover
+// Float builds that don't
+static const wchar_t* kSyncEventName = L"Local\\HeliumSubmissionsChanged";
+
+// Safety-net resync if no change notification arrives (e.g. network share)
+static const DWORD kSyncFallbackMs = 60000;
+
+// YYYYMM (UTC) of a submission
+static uint32_t MonthOf(uint64_t timestamp) {
+    time_t t = (time_t)timestamp;
+    tm utc = {};
+    if (gmtime_s(&utc, &t) != 0) return 0;
+    return (uint32_t)(utc.tm_year + 1900) * 100 + (uint32_t)(utc.tm_mon + 1);
+}
+
+// Months before this are archived; the previous month stays hot, so a
+// re-sent invoice from last week never needs a shard
+static uint32_t ArchiveCutoff() {
+    uint32_t month = MonthOf((uint64_t)time(nullptr));
+    return month % 100 == 1 ? (month / 100 - 1) * 100 + 12 : month - 1;
+}
+
+// ---------------------------------------------------------------------------
+// CacheSnapshot
+// ---------------------------------------------------------------------------
+
+std::string_view CacheSnapshot::FilenameAt(uint32_t position) const {
+    if (position < mappedCount) {
+        const CacheRecord& record = mappedRecords[position];
+        return HeapString(heap, heapSize, record.filenameOffset, record.filenameLength);
+    }
+    const CacheEntry& entry = entries[position - mappedCount];
+    return std::string_view(entry.filename, FilenameLength(entry));
+}
+
+uint64_t CacheSnapshot::ContentHashAt(uint32_t position) const {
+    return position < mappedCount ? mappedRecords[position].contentHash
+                                  : entries[position - mappedCount].contentHash;
+}
+
+CacheEntry CacheSnapshot::EntryAt(uint32_t position) const {
+    return position < mappedCount ? Decode(mappedRecords[position], heap, heapSize)
+                                  : entries[position - mappedCount];
+}
+
+uint32_t CacheSnapshot::Find(std::string_view filename) const {
+    if (slots) {
+        uint64_t hash = HashFilename(filename.data(), filename.size());
+        uint32_t tag = (uint32_t)(hash >> 32);
+        uint32_t slot = (uint32_t)hash & slotMask;
+
+        // Bounded probe — a corrupt (full) table must not spin forever
+        for (uint32_t probes = 0; probes <= slotMask; probes++) {
+            const IndexSlot& s = slots[slot];
+            if (s.entry == 0) {
+                break;
+            }
+            if (s.hash == tag && s.entry <= indexedCount && FilenameAt(s.entry - 1) == filename) {
+                return s.entry - 1;
+            }
+            slot = (slot + 1) & slotMask;
+        }
+    }
+
+    auto it = filenameIndex.find(filename);
+    return it != filenameIndex.end() ? it->second : kNotFound;
+}
+
+uint32_t CacheSnapshot::FindByContent(uint64_t contentHash) const {
+    if (contentHash == 0) {
+        return kNotFound;
+    }
+
+    if (contentSlots) {
+        uint32_t tag = (uint32_t)(contentHash >> 32);
+        uint32_t slot = (uint32_t)contentHash & slotMask;
+        for (uint32_t probes = 0; probes <= slotMask; probes++) {
+            const IndexSlot& s = contentSlots[slot];
+            if (s.entry == 0) {
+                break;
+            }
+            if (s.hash == tag && s.entry <= indexedCount &&
+                mappedRecords[s.entry - 1].contentHash == contentHash) {
+                return s.entry - 1;
+            }
+            slot = (slot + 1) & slotMask;
+        }
+    }
+
+    auto it = contentIndex.find(contentHash);
+    return it != contentIndex.end() ? it->second : kNotFound;
+}
+
+void CacheSnapshot::IndexEntry(uint32_t position) {
+    // First entry for a key wins, matching the mapped index
+    filenameIndex.emplace(std::string(FilenameAt(position)), position);
+    uint64_t contentHash = ContentHashAt(position);
+    if (contentHash != 0) {
+        contentIndex.emplace(contentHash, position);
+    }
+}
+
+void CacheSnapshot::ReindexOverlay() {
+    filenameIndex.clear();
+    contentIndex.clear();
+    filenameIndex.reserve(TotalCount() - indexedCount);
+    for (uint32_t p = indexedCount; p < TotalCount(); p++) {
+        IndexEntry(p);
+    }
+}
+
+uint64_t CacheSnapshot::HashFilename(const char* name, size_t length) {
+    // FNV-1a 64 — stable across builds, so the on-disk index stays valid
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t CacheSnapshot::FilenameLength(const CacheEntry& entry) {
+    // Entries written by other tools may fill all 256 bytes without a NUL
+    return strnlen(entry.filename, sizeof(entry.filename));
+}
+
+std::string_view CacheSnapshot::HeapString(const char* heap, uint64_t heapSize, uint32_t offset, uint8_t length) {
+    if (!heap || (uint64_t)offset + length > heapSize) {
+        return std::string_view();
+    }
+    return std::string_view(heap + offset, length);
+}
+
+CacheEntry CacheSnapshot::Decode(const CacheRecord& record, const char* heap, uint64_t heapSize) {
+    CacheEntry entry = {};
+    auto copy = [&](char* out, size_t capacity, uint32_t offset, uint8_t length) {
+        std::string_view text = HeapString(heap, heapSize, offset, length);
+        if (!text.empty()) {
+            memcpy(out, text.data(), std::min(text.size(), capacity - 1));
+        }
+    };
+    copy(entry.filename, sizeof(entry.filename), record.filenameOffset, record.filenameLength);
+    copy(entry.firsReference, sizeof(entry.firsReference), record.firsOffset, record.firsLength);
+    copy(entry.submittedBy, sizeof(entry.submittedBy), record.userOffset, record.userLength);
+    entry.submitTimestamp = record.submitTimestamp;
+    entry.contentHash = record.contentHash;
+    return entry;
+}
+
+bool CacheSnapshot::Encode(const std::vector<CacheEntry>& entries, uint64_t heapBase,
+                           std::unordered_map<std::string, uint32_t>& users,
+                           std::vector<CacheRecord>& records, std::string& strings) {
+    strings.clear();
+    auto place = [&](const char* text, size_t capacity, uint32_t& offset, uint8_t& length) {
+        size_t n = strnlen(text, capacity);
+        offset = (uint32_t)(heapBase + strings.size());
+        length = (uint8_t)std::min<size_t>(n, 255);
+        strings.append(text, length);
+    };
+
+    records.clear();
+    records.reserve(entries.size());
+    for (const CacheEntry& entry : entries) {
+        CacheRecord record = {};
+        record.contentHash = entry.contentHash;
+        record.submitTimestamp = entry.submitTimestamp;
+        place(entry.filename, sizeof(entry.filename), record.filenameOffset, record.filenameLength);
+        place(entry.firsReference, sizeof(entry.firsReference), record.firsOffset, record.firsLength);
+
+        std::string user(entry.submittedBy, strnlen(entry.submittedBy, sizeof(entry.submittedBy)));
+        auto it = users.find(user);
+        if (it != users.end()) {
+            record.userOffset = it->second;
+            record.userLength = (uint8_t)user.size();
+        } else {
+            place(entry.submittedBy, sizeof(entry.submittedBy), record.userOffset, record.userLength);
+            users.emplace(std::move(user), record.userOffset);
+        }
+        records.push_back(record);
+    }
+
+    // Offsets are 32-bit: ~80 million submissions' worth of strings
+    return heapBase + strings.size() <= 0xFFFFFFFFull;
+}
+
+// ---------------------------------------------------------------------------
+// DuplicateCache
+// ---------------------------------------------------------------------------
+
 DuplicateCache::DuplicateCache() {}
 
 DuplicateCache::~DuplicateCache() {
     StopBackgroundSync();
+    StopWriter();
 }
 
 bool DuplicateCache::Load(const std::wstring& cachePath) {
-    m_cachePath = cachePath;
+    ScopedLatency timer(LatencyStage::CacheLoad);
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
     std::lock_guard<std::mutex> lock(m_mutex);
+    m_cachePath = cachePath;
+    m_diskCount = 0;
+    m_headerDirty = false;
+    m_rolledCutoff = 0;
+    m_userOffsets.clear();
+    m_usersInterned = false;
 
-    std::ifstream file(cachePath, std::ios::binary);
-    if (!file.is_open()) {
-        // No cache file yet — start fresh
-        return true;
-    }
+    // Older installs wrote wide version 1/2 entries
+    MigrateLegacy();
 
-    CacheHeader header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    auto snap = std::make_shared<CacheSnapshot>();
+    snap->shards = LoadShards();
+
+    // Mapped mode: startup costs the map call, lookups fault in a page or two
+    if (MapCacheFile(*snap)) {
+        m_diskCount = snap->mappedCount;
+        if (!LoadIndexFile(*snap) || snap->mappedCount - snap->indexedCount > kCompactThreshold) {
+            BuildIndex(*snap);
+            WriteIndexFile(*snap);
+        }
+        snap->ReindexOverlay();
+        m_snapshot.Publish(std::move(snap));
 
-    if (header.version != 1) {
-        // Unknown version — start fresh
+        // An old install's history, or a month turned since the last run
+        if (NeedsRollLocked()) {
+            m_rollPending = true;
+            StartWriterLocked();
+        }
         return true;
     }
 
-    m_entries.resize(header.entryCount);
-    file.read(reinterpret_cast<char*>(m_entries.data()),
-              header.entryCount * sizeof(CacheEntry));
-    file.close();
-
-    // Build index
-    m_filenameIndex.clear();
-    for (const auto& entry : m_entries) {
-        m_filenameIndex.insert(std::string(entry.filename));
+    // Copy-in fallback (mapping refused, e.g. file locked by another writer).
+    // No cache file yet, or unknown version — start fresh.
+    if (ReadCacheFile(*snap)) {
+        m_diskCount = snap->TotalCount();
     }
 
+    snap->ReindexOverlay();
+    m_snapshot.Publish(std::move(snap));
     return true;
 }
 
-DuplicateCheckResult DuplicateCache::Check(const std::string& filename) {
+DuplicateCheckResult DuplicateCache::Check(std::string_view filename, uint64_t contentHash) {
+    ScopedLatency timer(LatencyStage::CacheCheck);
     DuplicateCheckResult result;
+    result.status = DuplicateStatus::NotSubmitted;
 
-    std::lock_guard<std::mutex> lock(m_mutex);
+    // Holding the snapshot keeps its mappings alive even if a newer one is
+    // published while we read
+    std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+    if (!snap) {
+        result.status = DuplicateStatus::CacheUnavailable;
+        return result;
+    }
 
-    if (m_filenameIndex.find(filename) == m_filenameIndex.end()) {
-        result.status = DuplicateStatus::NotSubmitted;
+    // Same bytes under any name are a duplicate
+    uint32_t position = snap->FindByContent(contentHash);
+    if (position != CacheSnapshot::kNotFound) {
+        FillResult(*snap, position, result);
         return result;
     }
 
-    // Find the full entry for details
-    for (const auto& entry : m_entries) {
-        if (std::string(entry.filename) == filename) {
-            result.status = DuplicateStatus::AlreadySubmitted;
-            result.firsReference = entry.firsReference;
-            result.submittedBy = entry.submittedBy;
-            result.submitTimestamp = entry.submitTimestamp;
-            return result;
+    // Archived months: a shard is only mapped when its summary says maybe
+    CacheEntry archived;
+    if (FindArchivedContent(*snap, contentHash, archived)) {
+        FillResult(archived, result);
+        return result;
+    }
+
+    // A filename hit only counts if its content is unknown (entry predates
+    // content hashing) or we have no hash to compare against. Hits and misses
+    // cost the same: one probe into each index, no key built.
+    position = snap->Find(filename);
+    if (position != CacheSnapshot::kNotFound) {
+        if (contentHash == 0 || snap->ContentHashAt(position) == 0) {
+            FillResult(*snap, position, result);
         }
+        return result;
     }
 
-    // Shouldn't reach here, but just in case
-    result.status = DuplicateStatus::AlreadySubmitted;
+    if (FindArchivedFilename(*snap, filename, archived) &&
+        (contentHash == 0 || archived.contentHash == 0)) {
+        FillResult(archived, result);
+    }
     return result;
 }
 
-void DuplicateCache::AddEntry(const std::string& filename, const std::string& firsRef, const std::string& user) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+bool DuplicateCache::FindArchivedContent(const CacheSnapshot& snap, uint64_t contentHash, CacheEntry& entry) {
+    if (contentHash == 0 || !snap.shards) return false;
+    for (const std::shared_ptr<CacheShard>& shard : *snap.shards) {
+        if (shard->MayContain(contentHash) && shard->FindByContent(contentHash, entry)) {
+            return true;
+        }
+    }
+    return false;
+}
 
+bool DuplicateCache::FindArchivedFilename(const CacheSnapshot& snap, std::string_view filename, CacheEntry& entry) {
+    if (!snap.shards || snap.shards->empty()) return false;
+    uint64_t key = CacheSnapshot::HashFilename(filename.data(), filename.size());
+    for (const std::shared_ptr<CacheShard>& shard : *snap.shards) {
+        if (shard->MayContain(key) && shard->Find(filename, entry)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DuplicateCache::IsKnown(const CacheSnapshot* snap, std::string_view filename, uint64_t contentHash) {
+    if (!snap) return false;
+
+    // Same rule as Check(): a hashed row is known by its content; its name
+    // only counts against an entry that has no hash. Dropping a same-named
+    // row with new content would let Check() pass that invoice again.
+    CacheEntry archived;
+    if (snap->FindByContent(contentHash) != CacheSnapshot::kNotFound ||
+        FindArchivedContent(*snap, contentHash, archived)) {
+        return true;
+    }
+
+    uint32_t position = snap->Find(filename);
+    if (position != CacheSnapshot::kNotFound) {
+        return contentHash == 0 || snap->ContentHashAt(position) == 0;
+    }
+    return FindArchivedFilename(*snap, filename, archived) &&
+           (contentHash == 0 || archived.contentHash == 0);
+}
+
+void DuplicateCache::AddEntry(const std::string& filename, const std::string& firsRef, const std::string& user,
+                              uint64_t contentHash) {
     CacheEntry entry = {};
     strncpy_s(entry.filename, filename.c_str(), sizeof(entry.filename) - 1);
     strncpy_s(entry.firsReference, firsRef.c_str(), sizeof(entry.firsReference) - 1);
     strncpy_s(entry.submittedBy, user.c_str(), sizeof(entry.submittedBy) - 1);
     entry.submitTimestamp = (uint64_t)time(nullptr);
+    entry.contentHash = contentHash;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    AppendLocked({entry});
+}
+
+void DuplicateCache::AppendLocked(const std::vector<CacheEntry>& records) {
+    std::shared_ptr<const CacheSnapshot> current = m_snapshot.Load();
+    auto next = current ? std::make_shared<CacheSnapshot>(*current)
+                        : std::make_shared<CacheSnapshot>();
 
-    m_entries.push_back(entry);
-    m_filenameIndex.insert(filename);
+    for (const CacheEntry& record : records) {
+        next->entries.push_back(record);
+        next->IndexEntry(next->TotalCount() - 1);
+    }
+    m_snapshot.Publish(std::move(next));
 
-    // Persist immediately
-    Save();
+    // Persist in the background — a bulk submitter never waits on the disk
+    StartWriterLocked();
+}
+
+void DuplicateCache::StartWriterLocked() {
+    if (!m_writerThread.joinable()) {
+        m_writerRunning = true;
+        m_writerThread = std::thread(&DuplicateCache::WriterLoop, this);
+    }
+    m_writerWake.notify_one();
 }
 
 bool DuplicateCache::Save() {
-    if (m_cachePath.empty()) return false;
+    ScopedLatency timer(LatencyStage::CacheSave);
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return SaveLocked();
+}
+
+void DuplicateCache::Flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_writerIdle.wait_for(lock, std::chrono::seconds(5), [this] {
+        return !m_writerRunning || (!HasPendingLocked() && !m_writerBusy);
+    });
+}
+
+bool DuplicateCache::SaveLocked() {
+    std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+    if (m_cachePath.empty() || !snap) return false;
 
-    std::ofstream file(m_cachePath, std::ios::binary | std::ios::trunc);
+    // Mapped records are copied as they are — their strings are already in
+    // the heap. The rest get their strings appended to it first.
+    CompactCacheHeader current;
+    std::ifstream existing(m_cachePath, std::ios::binary);
+    if (!existing.read(reinterpret_cast<char*>(&current), sizeof(current)) ||
+        current.version != kCacheVersion) {
+        current = CompactCacheHeader();
+    }
+    existing.close();
+
+    HANDLE hHeap = OpenForAppend(GetHeapPath(current.heapGeneration));
+    if (hHeap == INVALID_HANDLE_VALUE) return false;
+    InternMappedUsers();
+    std::unordered_map<std::string, uint32_t> users = m_userOffsets;
+    uint64_t heapBytes = current.heapBytes;
+    std::vector<CacheRecord> overlay;
+    bool encoded = EncodeRecords(hHeap, heapBytes, snap->entries, users, overlay);
+    CloseHandle(hHeap);
+    if (!encoded) return false;
+
+    // Write a complete new record file next to the old one, then swap it
+    // in, so a crash mid-write never leaves a truncated cache behind
+    std::wstring tempPath = m_cachePath + L".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
     if (!file.is_open()) return false;
 
-    CacheHeader header;
-    header.version = 1;
-    header.entryCount = (uint32_t)m_entries.size();
-    header.lastSyncTimestamp = (uint64_t)time(nullptr);
+    CompactCacheHeader header;
+    header.entryCount = snap->TotalCount();
+    header.lastSyncTimestamp = m_lastSyncTimestamp;
+    header.heapBytes = heapBytes;
+    header.heapGeneration = current.heapGeneration;
 
     file.write(reinterpret_cast<const char*>(&header), sizeof(header));
-    file.write(reinterpret_cast<const char*>(m_entries.data()),
-               m_entries.size() * sizeof(CacheEntry));
+    file.write(reinterpret_cast<const char*>(snap->mappedRecords),
+               (std::streamsize)snap->mappedCount * sizeof(CacheRecord));
+    file.write(reinterpret_cast<const char*>(overlay.data()),
+               overlay.size() * sizeof(CacheRecord));
     file.close();
+    if (file.fail()) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    // Published snapshots keep their views valid after the swap (MappedFile
+    // opens the file share-delete), so readers never see entries vanish
+    if (!MoveFileExW(tempPath.c_str(), m_cachePath.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    m_userOffsets.swap(users);
+    m_diskCount = snap->TotalCount();
+    m_headerDirty = false;
+    CompactLocked();
     return true;
 }
 
-void DuplicateCache::StartBackgroundSync(const std::wstring& syncDbPath) {
-    m_syncDbPath = syncDbPath;
-    m_running = true;
-    m_syncThread = std::thread(&DuplicateCache::SyncLoop, this);
+bool DuplicateCache::HasPendingLocked() const {
+    std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+    return m_headerDirty || (snap && m_diskCount < snap->TotalCount());
 }
 
-void DuplicateCache::StopBackgroundSync() {
-    m_running = false;
-    if (m_syncThread.joinable()) {
-        m_syncThread.join();
+void DuplicateCache::WriterLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_writerWake.wait(lock, [this] { return !m_writerRunning || HasPendingLocked() || m_rollPending; });
+        bool pending = HasPendingLocked();
+        bool roll = m_rollPending && m_writerRunning;  // Never holds up shutdown
+        if (!pending && !roll) {
+            break; // Stopping, nothing left to persist
+        }
+
+        m_writerBusy = true;
+        lock.unlock();
+        bool written = !pending || WritePending();
+        if (written && roll) {
+            RollShards();
+        }
+        lock.lock();
+        m_writerBusy = false;
+        m_writerIdle.notify_all();
+
+        if (!written) {
+            // Disk full / file locked — keep entries in memory and retry later
+            m_writerWake.wait_for(lock, std::chrono::seconds(5), [this] { return !m_writerRunning; });
+            if (!m_writerRunning) break;
+        }
+    }
+    m_writerRunning = false;
+    m_writerIdle.notify_all();
+}
+
+void DuplicateCache::StopWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_writerRunning = false;
+    }
+    m_writerWake.notify_one();
+    if (m_writerThread.joinable()) {
+        m_writerThread.join();
+    }
+}
+
+bool DuplicateCache::WritePending() {
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+
+    // Copy out the pending tail; later snapshots may grow while we write
+    std::vector<CacheEntry> records;
+    uint32_t first;
+    uint64_t watermark;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+        first = m_diskCount;
+        watermark = m_lastSyncTimestamp;
+        for (uint32_t p = first; snap && p < snap->TotalCount(); p++) {
+            records.push_back(snap->EntryAt(p));
+        }
+        m_headerDirty = false;
+    }
+
+    if (!AppendToFile(records, watermark)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_headerDirty = true;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_diskCount = first + (uint32_t)records.size();
+
+    std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+    if (snap && snap->TotalCount() - snap->indexedCount > kCompactThreshold) {
+        CompactLocked();
+    }
+    if (NeedsRollLocked()) {
+        m_rollPending = true;
+    }
+    return true;
+}
+
+HANDLE DuplicateCache::OpenForAppend(const std::wstring& path) {
+    HANDLE hFile = CreateFileW(
+        path.c_str(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (hFile == INVALID_HANDLE_VALUE) {
+        // First submission on this machine — create the cache directory
+        std::wstring dir = path.substr(0, path.find_last_of(L"\\/"));
+        CreateDirectoryW(dir.c_str(), nullptr);
+        hFile = CreateFileW(
+            path.c_str(), GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr
+        );
+    }
+    return hFile;
+}
+
+static bool WriteAt(HANDLE hFile, uint64_t offset, const void* data, DWORD size) {
+    LARGE_INTEGER pos;
+    pos.QuadPart = (LONGLONG)offset;
+    DWORD written = 0;
+    return SetFilePointerEx(hFile, pos, nullptr, FILE_BEGIN) &&
+           WriteFile(hFile, data, size, &written, nullptr) && written == size;
+}
+
+bool DuplicateCache::EncodeRecords(HANDLE hHeap, uint64_t& heapBytes, const std::vector<CacheEntry>& entries,
+                                   std::unordered_map<std::string, uint32_t>& users,
+                                   std::vector<CacheRecord>& records) {
+    // Strings for every record in one write at the heap's committed end;
+    // a torn tail from an earlier crash is simply overwritten
+    std::string strings;
+    uint64_t base = heapBytes;
+    if (!CacheSnapshot::Encode(entries, base, users, records, strings)) return false;
+    if (strings.empty()) return true;
+
+    if (!WriteAt(hHeap, base, strings.data(), (DWORD)strings.size()) || !FlushFileBuffers(hHeap)) {
+        return false;
+    }
+    heapBytes = base + strings.size();
+    return true;
+}
+
+void DuplicateCache::InternMappedUsers() {
+    if (m_usersInterned) return;
+    m_usersInterned = true;
+
+    // A dozen distinct addresses across the whole file; the first offset
+    // seen for each is reused. Best effort — a miss just stores a copy.
+    std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+    if (!snap) return;
+    uint32_t lastOffset = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < snap->mappedCount; i++) {
+        const CacheRecord& record = snap->mappedRecords[i];
+        if (record.userOffset == lastOffset) continue;
+        lastOffset = record.userOffset;
+        std::string_view user = CacheSnapshot::HeapString(snap->heap, snap->heapSize,
+                                                          record.userOffset, record.userLength);
+        if (user.size() == record.userLength) {
+            m_userOffsets.emplace(std::string(user), record.userOffset);
+        }
+    }
+}
+
+bool DuplicateCache::AppendToFile(const std::vector<CacheEntry>& records, uint64_t lastSyncTimestamp) {
+    if (m_cachePath.empty()) return false;
+
+    HANDLE hFile = OpenForAppend(m_cachePath);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    CompactCacheHeader header;
+    DWORD bytesRead = 0;
+    bool ok = GetFileSizeEx(hFile, &size) != 0;
+
+    if (ok && size.QuadPart < (LONGLONG)sizeof(CompactCacheHeader)) {
+        // New file — write an empty header first
+        ok = WriteAt(hFile, 0, &header, sizeof(header));
+        size.QuadPart = sizeof(header);
+    } else if (ok) {
+        ok = ReadFile(hFile, &header, sizeof(header), &bytesRead, nullptr) &&
+             bytesRead == sizeof(header) && header.version == kCacheVersion;
+    }
+
+    // The header names the heap generation its records point into
+    HANDLE hHeap = ok ? OpenForAppend(GetHeapPath(header.heapGeneration)) : INVALID_HANDLE_VALUE;
+    if (hHeap == INVALID_HANDLE_VALUE) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    std::unordered_map<std::string, uint32_t> users;
+    if (ok) {
+        // Append after the last complete record the header vouches for;
+        // anything beyond it is a torn write from a crash and gets overwritten
+        uint64_t complete = ((uint64_t)size.QuadPart - sizeof(CompactCacheHeader)) / sizeof(CacheRecord);
+        uint32_t count = header.entryCount < complete ? header.entryCount : (uint32_t)complete;
+
+        // Interned offsets are only adopted once the header commits them
+        InternMappedUsers();
+        users = m_userOffsets;
+        uint64_t heapBytes = header.heapBytes;
+        std::vector<CacheRecord> encoded;
+        ok = EncodeRecords(hHeap, heapBytes, records, users, encoded);
+
+        if (ok && !encoded.empty()) {
+            ok = WriteAt(hFile, sizeof(CompactCacheHeader) + (uint64_t)count * sizeof(CacheRecord),
+                         encoded.data(), (DWORD)(encoded.size() * sizeof(CacheRecord))) &&
+                 FlushFileBuffers(hFile);
+        }
+
+        // Publish the records (and the sync watermark) only once durable
+        header.entryCount = count + (uint32_t)encoded.size();
+        header.lastSyncTimestamp = lastSyncTimestamp;
+        header.heapBytes = heapBytes;
+        ok = ok && WriteAt(hFile, offsetof(CompactCacheHeader, entryCount), &header.entryCount,
+                           offsetof(CompactCacheHeader, heapGeneration) - offsetof(CompactCacheHeader, entryCount)) &&
+             FlushFileBuffers(hFile);
+    }
+
+    CloseHandle(hHeap);
+    CloseHandle(hFile);
+    if (ok) {
+        m_userOffsets.swap(users);
+    }
+    return ok;
+}
+
+void DuplicateCache::CompactLocked() {
+    // Map the grown file afresh and fold everything persisted into a rebuilt
+    // on-disk index. Readers keep using the old snapshot until the swap.
+    std::shared_ptr<const CacheSnapshot> current = m_snapshot.Load();
+    auto next = std::make_shared<CacheSnapshot>();
+    if (!current || !MapCacheFile(*next)) {
+        return;
+    }
+
+    uint32_t newMapped = std::min(next->mappedCount, m_diskCount);
+    if (newMapped < current->mappedCount || newMapped > current->TotalCount()) {
+        return;
     }
+    next->mappedCount = newMapped;
+
+    uint32_t absorbed = newMapped - current->mappedCount;
+    next->entries.assign(current->entries.begin() + absorbed, current->entries.end());
+    next->shards = current->shards;
+
+    BuildIndex(*next);
+    WriteIndexFile(*next);
+    next->ReindexOverlay();
+    m_snapshot.Publish(std::move(next));
+}
+
+bool DuplicateCache::NeedsRollLocked() const {
+    // Records are appended in time order, so the first one is the oldest.
+    // Attempted once per cutoff, so a failing roll isn't retried per append.
+    std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+    uint32_t cutoff = ArchiveCutoff();
+    return cutoff != m_rolledCutoff && snap && snap->mappedCount > 0 &&
+           MonthOf(snap->mappedRecords[0].submitTimestamp) < cutoff;
 }
 
-void DuplicateCache::SyncLoop() {
-    while (m_running) {
-        // Sleep 60 seconds between syncs
-        for (int i = 0; i < 600 && m_running; i++) {
-            Sleep(100);
+bool DuplicateCache::RollShards() {
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+
+    // Fold everything persisted into the mapping, so the hot file is exactly
+    // the mapped records and the overlay is exactly what's unpersisted
+    std::shared_ptr<const CacheSnapshot> snap;
+    uint64_t watermark;
+    uint32_t cutoff = ArchiveCutoff();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rollPending = false;
+        m_rolledCutoff = cutoff;
+        snap = m_snapshot.Load();
+        if (snap && snap->mappedCount < m_diskCount) {
+            CompactLocked();
+            snap = m_snapshot.Load();
         }
-        if (m_running) {
-            SyncFromDatabase();
+        watermark = m_lastSyncTimestamp;
+        if (m_cachePath.empty() || !snap || !snap->cacheFile || snap->mappedCount != m_diskCount) {
+            return false;
         }
     }
+
+    const CompactCacheHeader* hot = reinterpret_cast<const CompactCacheHeader*>(snap->cacheFile->Data());
+    std::map<uint32_t, std::vector<uint32_t>> byMonth;
+    std::vector<CacheEntry> kept;
+    for (uint32_t i = 0; i < snap->mappedCount; i++) {
+        uint32_t month = MonthOf(snap->mappedRecords[i].submitTimestamp);
+        if (month < cutoff) {
+            byMonth[month].push_back(i);
+        } else {
+            kept.push_back(snap->EntryAt(i));
+        }
+    }
+    if (byMonth.empty()) return true;
+
+    // One month at a time, merged into the shard already written for it
+    // (late Float rows, or a roll interrupted before the hot file swap)
+    for (const auto& month : byMonth) {
+        std::vector<CacheEntry> entries;
+        std::unordered_set<uint64_t> seen;
+        auto keyOf = [](const CacheEntry& e) {
+            return CacheSnapshot::HashFilename(e.filename, CacheSnapshot::FilenameLength(e)) ^
+                   (e.contentHash * 0x9E3779B97F4A7C15ull) ^ e.submitTimestamp;
+        };
+
+        std::shared_ptr<CacheShard> existing = CacheShard::Open(GetShardPath(month.first));
+        if (existing && !existing->ReadAll(entries)) {
+            return false;  // Unreadable shard — never overwrite it with less
+        }
+        for (const CacheEntry& e : entries) {
+            seen.insert(keyOf(e));
+        }
+        for (uint32_t position : month.second) {
+            CacheEntry e = snap->EntryAt(position);
+            if (seen.insert(keyOf(e)).second) {
+                entries.push_back(e);
+            }
+        }
+        if (!CacheShard::Write(GetShardPath(month.first), month.first, entries)) {
+            return false;
+        }
+    }
+
+    // Re-lay the hot file over a fresh heap generation: the old heap stays
+    // valid for the old record file until the swap, and for snapshots still
+    // mapping it after
+    uint64_t generation = hot->heapGeneration + 1;
+    std::wstring heapPath = GetHeapPath(generation);
+    HANDLE hHeap = CreateFileW(heapPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hHeap == INVALID_HANDLE_VALUE) return false;
+
+    std::unordered_map<std::string, uint32_t> users;
+    std::vector<CacheRecord> records;
+    CompactCacheHeader header;
+    header.lastSyncTimestamp = watermark;
+    header.heapGeneration = generation;
+    bool ok = EncodeRecords(hHeap, header.heapBytes, kept, users, records);
+    CloseHandle(hHeap);
+    header.entryCount = (uint32_t)records.size();
+
+    std::wstring tempPath = m_cachePath + L".tmp";
+    if (ok) {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(CacheRecord));
+        out.close();
+        ok = !out.fail() &&
+             MoveFileExW(tempPath.c_str(), m_cachePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    }
+    if (!ok) {
+        DeleteFileW(tempPath.c_str());
+        DeleteFileW(heapPath.c_str());
+        return false;
+    }
+    DeleteFileW(GetHeapPath(hot->heapGeneration).c_str());
+    DeleteFileW(GetIndexPath().c_str());
+
+    // Nothing was persisted meanwhile (we are the writer), so the current
+    // overlay is still exactly the unpersisted tail
+    std::shared_ptr<const CacheShardList> shards = LoadShards();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<const CacheSnapshot> current = m_snapshot.Load();
+    auto next = std::make_shared<CacheSnapshot>();
+    next->shards = shards;
+    m_userOffsets.swap(users);
+    m_usersInterned = true;
+
+    if (MapCacheFile(*next) && next->mappedCount == records.size()) {
+        BuildIndex(*next);
+        WriteIndexFile(*next);
+    } else {
+        // Mapping refused: carry the kept entries in memory instead
+        next = std::make_shared<CacheSnapshot>();
+        next->shards = shards;
+        next->entries = kept;
+    }
+    m_diskCount = (uint32_t)records.size();
+    next->entries.insert(next->entries.end(), current->entries.begin(), current->entries.end());
+    next->ReindexOverlay();
+    m_snapshot.Publish(std::move(next));
+    return true;
+}
+
+std::shared_ptr<const CacheShardList> DuplicateCache::LoadShards() const {
+    // Only headers and bloom summaries are read here, a few KB per month
+    auto shards = std::make_shared<CacheShardList>();
+    size_t lastSlash = m_cachePath.find_last_of(L"\\/");
+    std::wstring dir = lastSlash != std::wstring::npos ? m_cachePath.substr(0, lastSlash + 1) : L"";
+
+    WIN32_FIND_DATAW data;
+    HANDLE hFind = FindFirstFileExW((m_cachePath + L".*.shard").c_str(), FindExInfoBasic, &data,
+                                    FindExSearchNameMatch, nullptr, 0);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            std::shared_ptr<CacheShard> shard = CacheShard::Open(dir + data.cFileName);
+            if (shard && shard->Path() == GetShardPath(shard->Month())) {
+                shards->push_back(std::move(shard));
+            }
+        } while (FindNextFileW(hFind, &data));
+        FindClose(hFind);
+    }
+
+    // Newest first: re-sent invoices are usually recent
+    std::sort(shards->begin(), shards->end(),
+              [](const std::shared_ptr<CacheShard>& a, const std::shared_ptr<CacheShard>& b) {
+                  return a->Month() > b->Month();
+              });
+    return shards;
+}
+
+std::wstring DuplicateCache::GetHeapPath(uint64_t generation) const {
+    return generation == 0 ? m_cachePath + L".str"
+                           : m_cachePath + L"." + std::to_wstring(generation) + L".str";
+}
+
+std::wstring DuplicateCache::GetShardPath(uint32_t month) const {
+    return m_cachePath + L"." + std::to_wstring(month) + L".shard";
+}
+
+void DuplicateCache::StartBackgroundSync(const std::wstring& syncSourcePath) {
+    if (m_syncWatcher.IsRunning()) return;
+
+    // Catch up on anything Float exported while we weren't running, then
+    // follow the export's directory plus a named event Float can set
+    // directly after a commit
+    m_syncDbPath = syncSourcePath;
+    m_syncWatcher.Start(syncSourcePath, [this] { SyncFromDatabase(); },
+                        true, kSyncEventName, kSyncFallbackMs);
+}
+
+void DuplicateCache::StopBackgroundSync() {
+    m_syncWatcher.Stop();
 }
 
 void DuplicateCache::SyncFromDatabase() {
-    // NOTE: This will use SQLite to query Float's sync.db for submitted invoices.
-    // For the spike, the binary cache file is the source of truth.
-    //
-    // Full implementation:
-    //   sqlite3* db;
-    //   sqlite3_open(syncDbPath, &db);
-    //   sqlite3_exec(db, "SELECT filename, submit_time, firs_ref, user FROM submitted_invoices", ...);
-    //   // Merge results into m_entries / m_filenameIndex
-    //   sqlite3_close(db);
-    //
-    // SumatraPDF does NOT bundle SQLite, so we'd add it as a dependency (~500KB).
-    // Alternative: Float writes the binary cache file directly, Transforma just reads it.
+    // Float's sync.db is SQLite, which SumatraPDF does not bundle. Float
+    // exports its submitted_invoices table in the wide [CacheHeader][CacheEntry]
+    // format instead (version 1 or 2), appended in submission order — so new
+    // rows are exactly the tail newer than our watermark, and a sync reads
+    // only those pages.
+    MappedFile source;
+    if (!source.Open(m_syncDbPath) || source.Size() < sizeof(CacheHeader)) {
+        return;
+    }
+
+    const CacheHeader* header = reinterpret_cast<const CacheHeader*>(source.Data());
+    size_t rowSize;
+    if (header->version == 1) {
+        rowSize = sizeof(CacheEntryV1);
+    } else if (header->version == kWideCacheVersion) {
+        rowSize = sizeof(CacheEntry);
+    } else {
+        return;
+    }
+
+    uint64_t available = (source.Size() - sizeof(CacheHeader)) / rowSize;
+    uint32_t count = (uint32_t)std::min<uint64_t>(header->entryCount, available);
+    const uint8_t* rows = source.Data() + sizeof(CacheHeader);
+    auto rowAt = [&](uint32_t i) {
+        const uint8_t* p = rows + (size_t)i * rowSize;
+        if (header->version == 1) {
+            CacheEntryV1 legacy;
+            memcpy(&legacy, p, sizeof(legacy));
+            return FromV1(legacy);
+        }
+        CacheEntry entry;
+        memcpy(&entry, p, sizeof(entry));
+        return entry;
+    };
+
+    uint64_t watermark;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        watermark = m_lastSyncTimestamp;
+    }
+
+    // Walk back from the newest row. Rows stamped exactly at the watermark are
+    // re-examined (same-second submissions) and dropped if already known.
+    std::shared_ptr<const CacheSnapshot> snap = m_snapshot.Load();
+    std::vector<CacheEntry> fresh;
+    uint64_t newest = watermark;
+    for (uint32_t i = count; i-- > 0;) {
+        CacheEntry row = rowAt(i);
+        if (row.submitTimestamp < watermark) {
+            break;
+        }
+        newest = std::max(newest, row.submitTimestamp);
+
+        std::string_view name(row.filename, CacheSnapshot::FilenameLength(row));
+        if (!IsKnown(snap.get(), name, row.contentHash)) {
+            fresh.push_back(row);
+        }
+    }
+    std::reverse(fresh.begin(), fresh.end());
+
+    // Build and publish the merged snapshot; Check() keeps reading the old
+    // one until the swap and never waits on us
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<const CacheSnapshot> current = m_snapshot.Load();
+    std::vector<CacheEntry> merged;
+    for (const CacheEntry& row : fresh) {
+        std::string_view name(row.filename, CacheSnapshot::FilenameLength(row));
+        bool known = IsKnown(current.get(), name, row.contentHash);
+        bool repeated = std::any_of(merged.begin(), merged.end(), [&](const CacheEntry& e) {
+            if (row.contentHash != 0 && e.contentHash != 0) {
+                return e.contentHash == row.contentHash;
+            }
+            return CacheSnapshot::FilenameLength(e) == name.size() &&
+                   memcmp(e.filename, name.data(), name.size()) == 0;
+        });
+        if (!known && !repeated) {
+            merged.push_back(row);
+        }
+    }
+
+    if (newest != m_lastSyncTimestamp) {
+        m_lastSyncTimestamp = newest;
+        m_headerDirty = true;
+    }
+
+    if (!merged.empty()) {
+        AppendLocked(merged);
+    } else if (m_headerDirty && m_writerThread.joinable()) {
+        m_writerWake.notify_one();
+    }
+}
+
+bool DuplicateCache::MigrateLegacy() {
+    std::ifstream in(m_cachePath, std::ios::binary);
+    CacheHeader header;
+    if (!in.is_open() ||
+        !in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        (header.version != 1 && header.version != kWideCacheVersion)) {
+        return false;
+    }
+
+    std::vector<CacheEntry> entries;
+    if (header.version == 1) {
+        std::vector<CacheEntryV1> legacy(header.entryCount);
+        in.read(reinterpret_cast<char*>(legacy.data()), legacy.size() * sizeof(CacheEntryV1));
+        legacy.resize((size_t)in.gcount() / sizeof(CacheEntryV1));
+        for (const CacheEntryV1& old : legacy) {
+            entries.push_back(FromV1(old));
+        }
+    } else {
+        entries.resize(header.entryCount);
+        in.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(CacheEntry));
+        entries.resize((size_t)in.gcount() / sizeof(CacheEntry));
+    }
+    in.close();
+
+    // Wide records don't reference the heap, so a fresh one can replace any
+    // leftover: a crash anywhere below leaves the old file intact, and the
+    // next start simply migrates again
+    std::wstring heapTemp = GetHeapPath(0) + L".tmp";
+    HANDLE hHeap = CreateFileW(heapTemp.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hHeap == INVALID_HANDLE_VALUE) return false;
+
+    std::unordered_map<std::string, uint32_t> users;
+    std::vector<CacheRecord> records;
+    CompactCacheHeader compact;
+    compact.lastSyncTimestamp = header.lastSyncTimestamp;
+    bool ok = EncodeRecords(hHeap, compact.heapBytes, entries, users, records);
+    CloseHandle(hHeap);
+    compact.entryCount = (uint32_t)records.size();
+
+    std::wstring tempPath = m_cachePath + L".tmp";
+    if (ok) {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&compact), sizeof(compact));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(CacheRecord));
+        out.close();
+        ok = !out.fail();
+    }
+
+    // Heap first: the new record file is only valid beside it
+    ok = ok &&
+         MoveFileExW(heapTemp.c_str(), GetHeapPath(0).c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) &&
+         MoveFileExW(tempPath.c_str(), m_cachePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    if (!ok) {
+        DeleteFileW(heapTemp.c_str());
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    // The old index described wide entries
+    DeleteFileW(GetIndexPath().c_str());
+    return true;
+}
+
+bool DuplicateCache::MapCacheFile(CacheSnapshot& snap) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(m_cachePath) || file->Size() < sizeof(CompactCacheHeader)) {
+        return false;
+    }
+
+    const CompactCacheHeader* header = reinterpret_cast<const CompactCacheHeader*>(file->Data());
+    if (header->version != kCacheVersion) {
+        return false;
+    }
+
+    // A short file (interrupted writer) exposes only its complete records
+    uint64_t available = (file->Size() - sizeof(CompactCacheHeader)) / sizeof(CacheRecord);
+    snap.mappedCount = (uint32_t)std::min<uint64_t>(header->entryCount, available);
+    snap.mappedRecords = reinterpret_cast<const CacheRecord*>(file->Data() + sizeof(CompactCacheHeader));
+
+    // Only the committed part of the heap; a missing heap leaves strings
+    // empty (content hashes still match) rather than failing the load
+    if (header->heapBytes > 0) {
+        auto heap = std::make_shared<MappedFile>();
+        if (heap->Open(GetHeapPath(header->heapGeneration))) {
+            snap.heap = reinterpret_cast<const char*>(heap->Data());
+            snap.heapSize = std::min<uint64_t>(heap->Size(), header->heapBytes);
+            snap.heapFile = std::move(heap);
+        }
+    }
+
+    m_lastSyncTimestamp = std::max(m_lastSyncTimestamp, header->lastSyncTimestamp);
+    snap.cacheFile = std::move(file);
+    return true;
+}
+
+bool DuplicateCache::ReadCacheFile(CacheSnapshot& snap) {
+    std::ifstream file(m_cachePath, std::ios::binary);
+    CompactCacheHeader header;
+    if (!file.is_open() ||
+        !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.version != kCacheVersion) {
+        return false;
+    }
+
+    std::vector<CacheRecord> records(header.entryCount);
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(CacheRecord));
+    records.resize((size_t)file.gcount() / sizeof(CacheRecord));
+
+    std::string heap((size_t)header.heapBytes, '\0');
+    std::ifstream heapFile(GetHeapPath(header.heapGeneration), std::ios::binary);
+    heapFile.read(&heap[0], (std::streamsize)heap.size());
+    heap.resize((size_t)heapFile.gcount());
+
+    m_lastSyncTimestamp = header.lastSyncTimestamp;
+    snap.entries.reserve(records.size());
+    for (const CacheRecord& record : records) {
+        snap.entries.push_back(CacheSnapshot::Decode(record, heap.data(), heap.size()));
+    }
+    return true;
+}
+
+bool DuplicateCache::LoadIndexFile(CacheSnapshot& snap) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(GetIndexPath())) {
+        return false;
+    }
+
+    const IndexHeader* header = reinterpret_cast<const IndexHeader*>(file->Data());
+    IndexHeader expected;
+    bool valid =
+        file->Size() >= sizeof(IndexHeader) &&
+        header->magic == expected.magic &&
+        header->version == expected.version &&
+        header->entryCount <= snap.mappedCount &&
+        header->slotCount > header->entryCount &&
+        (header->slotCount & (header->slotCount - 1)) == 0 &&
+        file->Size() == sizeof(IndexHeader) + 2 * (uint64_t)header->slotCount * sizeof(IndexSlot);
+
+    // The index may trail the cache (appends since), but must describe the
+    // same leading entries — a rewritten cache invalidates it
+    if (valid) {
+        uint64_t lastHash = header->entryCount > 0
+            ? HashRecord(snap.mappedRecords[header->entryCount - 1]) : 0;
+        valid = header->lastEntryHash == lastHash;
+    }
+
+    if (!valid) {
+        // Stale or foreign index — caller rebuilds it
+        return false;
+    }
+
+    snap.slots = reinterpret_cast<const IndexSlot*>(file->Data() + sizeof(IndexHeader));
+    snap.contentSlots = snap.slots + header->slotCount;
+    snap.slotMask = header->slotCount - 1;
+    snap.indexedCount = header->entryCount;
+    snap.indexFile = std::move(file);
+    snap.builtSlots.reset();
+    return true;
+}
+
+void DuplicateCache::BuildIndex(CacheSnapshot& snap) {
+    // Load factor <= 0.5 keeps probe chains to a slot or two
+    uint32_t slotCount = 16;
+    while (slotCount < snap.mappedCount * 2) {
+        slotCount <<= 1;
+    }
+
+    // Filename table, then content table, as laid out on disk
+    auto slots = std::make_shared<std::vector<IndexSlot>>(2 * (size_t)slotCount, IndexSlot{0, 0});
+    uint32_t mask = slotCount - 1;
+
+    auto insert = [mask](IndexSlot* table, uint64_t hash, uint32_t entry) {
+        uint32_t slot = (uint32_t)hash & mask;
+        while (table[slot].entry != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot].hash = (uint32_t)(hash >> 32);
+        table[slot].entry = entry;
+    };
+
+    for (uint32_t i = 0; i < snap.mappedCount; i++) {
+        std::string_view filename = snap.FilenameAt(i);
+        insert(slots->data(), CacheSnapshot::HashFilename(filename.data(), filename.size()), i + 1);
+        uint64_t contentHash = snap.mappedRecords[i].contentHash;
+        if (contentHash != 0) {
+            insert(slots->data() + slotCount, contentHash, i + 1);
+        }
+    }
+
+    snap.indexFile.reset();
+    snap.slots = slots->data();
+    snap.contentSlots = slots->data() + slotCount;
+    snap.slotMask = mask;
+    snap.indexedCount = snap.mappedCount;
+    snap.builtSlots = std::move(slots);
+}
+
+bool DuplicateCache::WriteIndexFile(const CacheSnapshot& snap) {
+    if (!snap.builtSlots) return false;
+
+    IndexHeader header;
+    header.entryCount = snap.indexedCount;
+    header.slotCount = (uint32_t)(snap.builtSlots->size() / 2);
+    header.lastEntryHash = snap.indexedCount > 0 ? HashRecord(snap.mappedRecords[snap.indexedCount - 1]) : 0;
+
+    std::wstring indexPath = GetIndexPath();
+    std::wstring tempPath = indexPath + L".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(snap.builtSlots->data()),
+               snap.builtSlots->size() * sizeof(IndexSlot));
+    file.close();
+
+    if (file.fail() ||
+        !MoveFileExW(tempPath.c_str(), indexPath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint64_t DuplicateCache::HashRecord(const CacheRecord& record) {
+    return CacheSnapshot::HashFilename(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+CacheEntry DuplicateCache::FromV1(const CacheEntryV1& legacy) {
+    CacheEntry entry = {};
+    memcpy(&entry, &legacy, sizeof(legacy));  // v2 only appends a field
+    entry.contentHash = 0;
+    return entry;
+}
+
+void DuplicateCache::FillResult(const CacheSnapshot& snap, uint32_t position, DuplicateCheckResult& result) {
+    result.status = DuplicateStatus::AlreadySubmitted;
+    if (position < snap.mappedCount) {
+        const CacheRecord& record = snap.mappedRecords[position];
+        result.firsReference = CacheSnapshot::HeapString(snap.heap, snap.heapSize,
+                                                         record.firsOffset, record.firsLength);
+        result.submittedBy = CacheSnapshot::HeapString(snap.heap, snap.heapSize,
+                                                       record.userOffset, record.userLength);
+        result.submitTimestamp = record.submitTimestamp;
+        return;
+    }
+
+    FillResult(snap.entries[position - snap.mappedCount], result);
+}
+
+void DuplicateCache::FillResult(const CacheEntry& entry, DuplicateCheckResult& result) {
+    result.status = DuplicateStatus::AlreadySubmitted;
+    result.firsReference.assign(entry.firsReference,
+                                strnlen(entry.firsReference, sizeof(entry.firsReference)));
+    result.submittedBy.assign(entry.submittedBy,
+                              strnlen(entry.submittedBy, sizeof(entry.submittedBy)));
+    result.submitTimestamp = entry.submitTimestamp;
 }
 
 } // namespace Helium
@@ -1,29 +1,102 @@
 // DuplicateCache.h — Memory-mapped binary cache for duplicate invoice detection
-// Syncs from Float's sync.db every 60 seconds in background
+// Syncs incrementally from Float's exported submissions as soon as they change.
+// Submissions older than the previous month are rolled out into monthly
+// shards (CacheShard.h), so the hot file stays a couple of months long.
 
 #pragma once
 
+#include "MappedFile.h"
+#include "AtomicSnapshot.h"
+#include "FileWatcher.h"
 #include <windows.h>
 #include <string>
-#include <unordered_set>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <atomic>
 
 namespace Helium {
 
+class CacheShard;
+using CacheShardList = std::vector<std::shared_ptr<CacheShard>>;
+
+// Version 2 added CacheEntry::contentHash; version 3 is the compact layout
+// below. Versions 1 and 2 — still Float's export format — are migrated on load.
+static const uint32_t kWideCacheVersion = 2;
+static const uint32_t kCacheVersion = 3;
+
 #pragma pack(push, 1)
+// Header of the version 1/2 (wide) formats
 struct CacheHeader {
-    uint32_t version = 1;
+    uint32_t version = kWideCacheVersion;
     uint32_t entryCount = 0;
-    uint64_t lastSyncTimestamp = 0;
+    uint64_t lastSyncTimestamp = 0;  // Newest Float submission already imported
 };
 
+// Version 1 layout — old cache files and Float's export
+struct CacheEntryV1 {
+    char filename[256];
+    uint64_t submitTimestamp;
+    char firsReference[32];
+    char submittedBy[64];
+};
+
+// Version 2 layout. Also the in-memory form of entries not yet mapped.
 struct CacheEntry {
     char filename[256];
     uint64_t submitTimestamp;
     char firsReference[32];
     char submittedBy[64];
+    uint64_t contentHash;            // XXH64 of the PDF bytes; 0 = unknown (migrated)
+};
+
+// Version 3: [CompactCacheHeader][CacheRecord x entryCount] in the cache
+// file, strings in an append-only heap beside it (<cache>.str, or
+// <cache>.<generation>.str once a roll has re-laid it). Same first 16 bytes
+// as CacheHeader, so the version check reads either.
+struct CompactCacheHeader {
+    uint32_t version = kCacheVersion;
+    uint32_t entryCount = 0;
+    uint64_t lastSyncTimestamp = 0;
+    uint64_t heapBytes = 0;          // Committed heap length; past it is a torn append
+    uint64_t heapGeneration = 0;     // Names the heap file; bumped when a roll rewrites it
+};
+
+// Two to a cache line; a million submissions map as 32 MB of records.
+// Strings are unterminated heap ranges; submittedBy is interned, so the
+// same dozen addresses are stored once.
+struct CacheRecord {
+    uint64_t contentHash;
+    uint64_t submitTimestamp;
+    uint32_t filenameOffset;
+    uint32_t firsOffset;
+    uint32_t userOffset;
+    uint8_t filenameLength;
+    uint8_t firsLength;
+    uint8_t userLength;
+    uint8_t reserved;
+};
+static_assert(sizeof(CacheRecord) == 32, "CacheRecord must stay 32 bytes");
+
+// Sidecar lookup index (<cache>.idx): two open-addressing hash tables (by
+// filename, then by content hash) over the first entryCount entries of the
+// mapped cache file, so a lookup touches a page or two. Entries appended
+// since are indexed in memory until compaction.
+struct IndexHeader {
+    uint32_t magic = 0x58444948;     // "HIDX"
+    uint32_t version = 4;            // 4: over compact (v3 cache) records
+    uint32_t entryCount = 0;         // Leading cache entries covered
+    uint32_t slotCount = 0;          // Per table; power of two
+    uint64_t lastEntryHash = 0;      // Hash of entry[entryCount - 1] (detects rewrites)
+};
+
+struct IndexSlot {
+    uint32_t hash;      // High 32 bits of the key hash (cheap reject)
+    uint32_t entry;     // Entry index + 1; 0 = empty slot
 };
 #pragma pack(pop)
 
@@ -40,42 +113,173 @@ struct DuplicateCheckResult {
     uint64_t submitTimestamp = 0;
 };
 
+// Immutable view of the cache. Positions [0, mappedCount) are records read
+// in place from the mapped cache and heap files, [mappedCount, TotalCount())
+// live in entries. Writers copy the current snapshot, extend it and publish
+// the copy.
+struct CacheSnapshot {
+    static const uint32_t kNotFound = 0xFFFFFFFF;
+
+    std::shared_ptr<MappedFile> cacheFile;
+    std::shared_ptr<MappedFile> heapFile;
+    std::shared_ptr<MappedFile> indexFile;
+    std::shared_ptr<std::vector<IndexSlot>> builtSlots;
+    const CacheRecord* mappedRecords = nullptr;
+    uint32_t mappedCount = 0;
+    const char* heap = nullptr;
+    uint64_t heapSize = 0;
+
+    // On-disk (or rebuilt) indexes over positions [0, indexedCount)
+    const IndexSlot* slots = nullptr;
+    const IndexSlot* contentSlots = nullptr;
+    uint32_t slotMask = 0;
+    uint32_t indexedCount = 0;
+
+    // Transparent hash so lookups take a string_view without building a key
+    struct FilenameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const {
+            return (size_t)HashFilename(name.data(), name.size());
+        }
+    };
+
+    // Entries not in the mapped file (copy-in fallback, appended or synced
+    // since), plus indexes over positions at or past indexedCount
+    std::vector<CacheEntry> entries;
+    std::unordered_map<std::string, uint32_t, FilenameHash, std::equal_to<>> filenameIndex;
+    std::unordered_map<uint64_t, uint32_t> contentIndex;
+
+    // Archived months, newest first; shared between snapshots
+    std::shared_ptr<const CacheShardList> shards;
+
+    uint32_t TotalCount() const { return mappedCount + (uint32_t)entries.size(); }
+    std::string_view FilenameAt(uint32_t position) const;
+    uint64_t ContentHashAt(uint32_t position) const;
+    CacheEntry EntryAt(uint32_t position) const;
+
+    // Position of the first entry with this key, or kNotFound
+    uint32_t Find(std::string_view filename) const;
+    uint32_t FindByContent(uint64_t contentHash) const;
+    void IndexEntry(uint32_t position);
+    void ReindexOverlay();
+
+    static uint64_t HashFilename(const char* name, size_t length);
+    static size_t FilenameLength(const CacheEntry& entry);
+
+    // A record's string; empty if it points outside the heap (torn or
+    // missing heap file)
+    static std::string_view HeapString(const char* heap, uint64_t heapSize, uint32_t offset, uint8_t length);
+    static CacheEntry Decode(const CacheRecord& record, const char* heap, uint64_t heapSize);
+
+    // Records for entries, their strings laid out from heapBase (submittedBy
+    // interned through users). False if the heap would pass 4 GB.
+    static bool Encode(const std::vector<CacheEntry>& entries, uint64_t heapBase,
+                       std::unordered_map<std::string, uint32_t>& users,
+                       std::vector<CacheRecord>& records, std::string& strings);
+};
+
 class DuplicateCache {
 public:
     DuplicateCache();
     ~DuplicateCache();
 
-    // Initialize cache from disk file
+    // Map cache file and its index (falls back to reading into memory)
     bool Load(const std::wstring& cachePath);
 
-    // Check if a filename has been submitted before
-    DuplicateCheckResult Check(const std::string& filename);
+    // Check if a document has been submitted before. With a content hash the
+    // bytes decide: a renamed copy is a duplicate, and a same-named file with
+    // different content is not. Without one, the filename decides.
+    // Lock-free: never waits for AddEntry, the writer or the sync thread. A
+    // miss reads the hot file's index and the shards' bloom summaries only.
+    DuplicateCheckResult Check(std::string_view filename, uint64_t contentHash = 0);
 
-    // Add entry after successful submission
-    void AddEntry(const std::string& filename, const std::string& firsRef, const std::string& user);
+    // Add entry after successful submission. Visible to Check() immediately;
+    // the record is appended to disk by the background writer.
+    void AddEntry(const std::string& filename, const std::string& firsRef, const std::string& user,
+                  uint64_t contentHash = 0);
 
-    // Start background sync thread (syncs from Float's sync.db every 60s)
-    void StartBackgroundSync(const std::wstring& syncDbPath);
+    // Start watching Float's exported submissions file and importing new rows
+    void StartBackgroundSync(const std::wstring& syncSourcePath);
 
     // Stop background sync
     void StopBackgroundSync();
 
-    // Persist cache to disk
+    // Rewrite the whole cache file (temp file + atomic swap)
     bool Save();
 
+    // Block until every added entry has been appended and flushed
+    void Flush();
+
 private:
-    std::wstring m_cachePath;
-    std::vector<CacheEntry> m_entries;
-    std::unordered_set<std::string> m_filenameIndex; // Fast lookup
+    AtomicSnapshot<CacheSnapshot> m_snapshot;
+
+    // Writer-side state. m_mutex serializes snapshot builders (AddEntry,
+    // sync, compaction); m_fileMutex serializes everything that writes the
+    // cache file and is always taken before m_mutex, never after.
     std::mutex m_mutex;
+    std::mutex m_fileMutex;
+    std::wstring m_cachePath;
+    uint64_t m_lastSyncTimestamp = 0;
+    uint32_t m_diskCount = 0;        // Positions below this are persisted
+    bool m_headerDirty = false;      // Sync watermark moved, header not yet written
+    bool m_rollPending = false;      // Hot file holds months due for archiving
+    uint32_t m_rolledCutoff = 0;     // Cutoff of the last roll attempt (one a month)
+
+    // Background append writer
+    std::thread m_writerThread;
+    std::condition_variable m_writerWake;
+    std::condition_variable m_writerIdle;
+    bool m_writerRunning = false;
+    bool m_writerBusy = false;
 
     // Background sync
-    std::thread m_syncThread;
-    std::atomic<bool> m_running{false};
+    FileWatcher m_syncWatcher;
     std::wstring m_syncDbPath;
 
-    void SyncLoop();
     void SyncFromDatabase();
+
+    void WriterLoop();
+    void StopWriter();
+    bool WritePending();
+    bool AppendToFile(const std::vector<CacheEntry>& records, uint64_t lastSyncTimestamp);
+    void AppendLocked(const std::vector<CacheEntry>& records);
+    void CompactLocked();
+    bool SaveLocked();
+    bool HasPendingLocked() const;
+    void StartWriterLocked();
+
+    // Archive months before the cutoff into shards and re-lay the hot file
+    bool RollShards();
+    bool NeedsRollLocked() const;
+    std::shared_ptr<const CacheShardList> LoadShards() const;
+    static bool FindArchivedContent(const CacheSnapshot& snap, uint64_t contentHash, CacheEntry& entry);
+    static bool FindArchivedFilename(const CacheSnapshot& snap, std::string_view filename, CacheEntry& entry);
+    static bool IsKnown(const CacheSnapshot* snap, std::string_view filename, uint64_t contentHash);
+
+    bool MigrateLegacy();
+    bool MapCacheFile(CacheSnapshot& snap);
+    bool ReadCacheFile(CacheSnapshot& snap);
+    bool LoadIndexFile(CacheSnapshot& snap);
+    bool WriteIndexFile(const CacheSnapshot& snap);
+    static void BuildIndex(CacheSnapshot& snap);
+
+    // submittedBy -> heap offset of its one stored copy. Built from the
+    // mapped records on first append; guarded by m_fileMutex.
+    std::unordered_map<std::string, uint32_t> m_userOffsets;
+    bool m_usersInterned = false;
+    void InternMappedUsers();
+
+    std::wstring GetIndexPath() const { return m_cachePath + L".idx"; }
+    std::wstring GetHeapPath(uint64_t generation) const;
+    std::wstring GetShardPath(uint32_t month) const;
+    static HANDLE OpenForAppend(const std::wstring& path);
+    static bool EncodeRecords(HANDLE hHeap, uint64_t& heapBytes, const std::vector<CacheEntry>& entries,
+                              std::unordered_map<std::string, uint32_t>& users,
+                              std::vector<CacheRecord>& records);
+    static uint64_t HashRecord(const CacheRecord& record);
+    static CacheEntry FromV1(const CacheEntryV1& legacy);
+    static void FillResult(const CacheSnapshot& snap, uint32_t position, DuplicateCheckResult& result);
+    static void FillResult(const CacheEntry& entry, DuplicateCheckResult& result);
 };
 
 } // namespace Helium
@@ -0,0 +1,220 @@
+// FallbackHandler.cpp — Launch non-invoice PDFs with the user's previous viewer
+
+#include "FallbackHandler.h"
+#include <shlwapi.h>
+#include <shellapi.h>
+#include <cwchar>
+
+namespace Helium {
+
+static const wchar_t* kFileExtsKey =
+    L"Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\FileExts\\.pdf";
+
+static const DWORD kMaxCommandChars = 4096;
+
+FallbackHandler::FallbackHandler() {}
+
+FallbackHandler::~FallbackHandler() {
+    if (m_hFileExts) RegCloseKey(m_hFileExts);
+    if (m_hChanged) CloseHandle(m_hChanged);
+}
+
+bool FallbackHandler::Open(const std::wstring& pdfPath) {
+    std::wstring progId, command;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        RefreshIfChanged();
+        progId = m_progId;
+        command = m_command;
+    }
+
+    if (!command.empty()) {
+        if (Launch(BuildCommandLine(command, pdfPath))) return true;
+
+        // The viewer moved (updated, reinstalled) since it was resolved
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Resolve();
+        if (!m_command.empty() && m_command != command &&
+            Launch(BuildCommandLine(m_command, pdfPath))) {
+            return true;
+        }
+        return false;
+    }
+
+    // Packaged apps register no command line — only the shell can start
+    // them, by ProgId (never the .pdf association, which is us). A packaged
+    // app is never this executable, so it needs no launch marker.
+    if (progId.empty()) return false;
+
+    SHELLEXECUTEINFOW info = {};
+    info.cbSize = sizeof(info);
+    info.fMask = SEE_MASK_CLASSNAME | SEE_MASK_NOASYNC;
+    info.lpVerb = L"open";
+    info.lpFile = pdfPath.c_str();
+    info.lpClass = progId.c_str();
+    info.nShow = SW_SHOWNORMAL;
+    return ShellExecuteExW(&info) != FALSE;
+}
+
+std::wstring FallbackHandler::QueryProgId() {
+    HKEY hKey;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, (std::wstring(kFileExtsKey) + L"\\UserChoice").c_str(),
+                      0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+        return L"";  // No override set — use system default
+    }
+
+    wchar_t progId[256];
+    DWORD size = sizeof(progId);
+    LONG result = RegGetValueW(hKey, nullptr, L"ProgId", RRF_RT_REG_SZ, nullptr, progId, &size);
+    RegCloseKey(hKey);
+
+    return result == ERROR_SUCCESS ? progId : L"";
+}
+
+void FallbackHandler::RefreshIfChanged() {
+    if (m_hChanged && WaitForSingleObject(m_hChanged, 0) == WAIT_OBJECT_0) {
+        m_resolved = false;  // New default app chosen
+    }
+    if (m_resolved) return;
+
+    // Re-arm before reading, so a change during Resolve() isn't missed
+    ArmNotification();
+    Resolve();
+}
+
+void FallbackHandler::ArmNotification() {
+    if (!m_hFileExts &&
+        RegOpenKeyExW(HKEY_CURRENT_USER, kFileExtsKey, 0, KEY_NOTIFY, &m_hFileExts) != ERROR_SUCCESS) {
+        m_hFileExts = nullptr;
+        return;  // Never watched: resolved once per process
+    }
+    if (!m_hChanged) {
+        m_hChanged = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!m_hChanged) return;
+    }
+
+    // One-shot; thread-agnostic so it survives the calling thread exiting
+    ResetEvent(m_hChanged);
+    RegNotifyChangeKeyValue(m_hFileExts, TRUE,
+                            REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC,
+                            m_hChanged, TRUE);
+}
+
+void FallbackHandler::Resolve() {
+    m_resolved = true;
+    m_progId = QueryProgId();
+    m_command.clear();
+
+    wchar_t command[kMaxCommandChars];
+    DWORD chars = kMaxCommandChars;
+    HRESULT hr = AssocQueryStringW(ASSOCF_NOTRUNCATE | ASSOCF_INIT_IGNOREUNKNOWN, ASSOCSTR_COMMAND,
+                                   m_progId.empty() ? L".pdf" : m_progId.c_str(), L"open",
+                                   command, &chars);
+    if (FAILED(hr)) return;
+
+    wchar_t expanded[kMaxCommandChars];
+    DWORD length = ExpandEnvironmentStringsW(command, expanded, kMaxCommandChars);
+    std::wstring resolved = length > 0 && length <= kMaxCommandChars ? expanded : command;
+
+    // The association (or the saved choice) is us: there's nothing to fall back to
+    if (IsOwnExecutable(resolved)) {
+        m_progId.clear();
+        return;
+    }
+    m_command = resolved;
+}
+
+bool FallbackHandler::Launch(const std::wstring& commandLine) {
+    STARTUPINFOW si = {};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi = {};
+
+    // CreateProcessW may write to the command line buffer
+    std::wstring buffer = commandLine;
+    std::vector<wchar_t> environment = BuildChildEnvironment();
+    if (!CreateProcessW(nullptr, &buffer[0], nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT,
+                        environment.data(), nullptr, &si, &pi)) {
+        return false;
+    }
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    return true;
+}
+
+std::vector<wchar_t> FallbackHandler::BuildChildEnvironment() {
+    // Our block plus the marker, kept in the sorted order CreateProcess
+    // expects ("=C:" drive entries first). Any stale marker is replaced.
+    std::wstring marker = std::wstring(kLaunchMarkerVar) + L"=1";
+    size_t nameLength = wcslen(kLaunchMarkerVar);
+    std::vector<wchar_t> block;
+    bool inserted = false;
+
+    LPWCH strings = GetEnvironmentStringsW();
+    for (const wchar_t* p = strings; p && *p; p += wcslen(p) + 1) {
+        const wchar_t* equals = wcschr(p + 1, L'=');
+        int length = equals ? (int)(equals - p) : (int)wcslen(p);
+        int order = CompareStringOrdinal(p, length, kLaunchMarkerVar, (int)nameLength, TRUE);
+        if (order == CSTR_EQUAL) continue;
+        if (!inserted && order == CSTR_GREATER_THAN && *p != L'=') {
+            block.insert(block.end(), marker.c_str(), marker.c_str() + marker.size() + 1);
+            inserted = true;
+        }
+        block.insert(block.end(), p, p + wcslen(p) + 1);
+    }
+    if (strings) FreeEnvironmentStringsW(strings);
+
+    if (!inserted) {
+        block.insert(block.end(), marker.c_str(), marker.c_str() + marker.size() + 1);
+    }
+    block.push_back(L'\0');
+    return block;
+}
+
+std::wstring FallbackHandler::BuildCommandLine(const std::wstring& command, const std::wstring& pdfPath) {
+    // Shell placeholders: %1 / %L = the file, %* and %2..%9 = no further
+    // arguments, %% = literal percent
+    std::wstring line;
+    bool substituted = false;
+    for (size_t i = 0; i < command.size(); i++) {
+        wchar_t c = command[i];
+        if (c != L'%' || i + 1 == command.size()) {
+            line += c;
+            continue;
+        }
+        wchar_t next = command[++i];
+        if (next == L'1' || next == L'L' || next == L'l') {
+            bool quoted = i >= 2 && command[i - 2] == L'"';
+            line += quoted ? pdfPath : L"\"" + pdfPath + L"\"";
+            substituted = true;
+        } else if (next == L'%') {
+            line += L'%';
+        } else if (next == L'*' || (next >= L'2' && next <= L'9')) {
+            // Dropped
+        } else {
+            line += c;
+            line += next;
+        }
+    }
+    if (!substituted) {
+        line += L" \"" + pdfPath + L"\"";
+    }
+    return line;
+}
+
+bool FallbackHandler::IsOwnExecutable(const std::wstring& command) {
+    std::wstring exe;
+    if (!command.empty() && command[0] == L'"') {
+        size_t close = command.find(L'"', 1);
+        exe = command.substr(1, close == std::wstring::npos ? std::wstring::npos : close - 1);
+    } else {
+        exe = command.substr(0, command.find(L' '));
+    }
+
+    wchar_t self[MAX_PATH];
+    DWORD length = GetModuleFileNameW(nullptr, self, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) return false;
+
+    return CompareStringOrdinal(exe.c_str(), (int)exe.size(), self, (int)length, TRUE) == CSTR_EQUAL;
+}
+
+} // namespace Helium
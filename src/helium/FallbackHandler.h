@@ -0,0 +1,60 @@
+// FallbackHandler.h — Launch non-invoice PDFs with the user's previous viewer
+// The UserChoice ProgId is resolved to its concrete "open" command line once
+// (AssocQueryString) and kept until the association changes, which a
+// registry notification on the .pdf FileExts key reports. Opens are then a
+// plain CreateProcess — no shell association lookup, and a command that
+// points back at our own executable is refused, so a fallback can't loop.
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#pragma comment(lib, "shlwapi.lib")
+
+namespace Helium {
+
+class FallbackHandler {
+public:
+    FallbackHandler();
+    ~FallbackHandler();
+
+    FallbackHandler(const FallbackHandler&) = delete;
+    FallbackHandler& operator=(const FallbackHandler&) = delete;
+
+    // Start the previous handler on pdfPath. False if there is none other
+    // than us, or it couldn't be started — open the file here instead.
+    bool Open(const std::wstring& pdfPath);
+
+    // Set in the environment of the viewers Open starts, never in ours:
+    // should the handler still turn out to be us (another install, a
+    // wrapper), that launch opens the file itself instead of routing again
+    static constexpr const wchar_t* kLaunchMarkerVar = L"HELIUM_FALLBACK_LAUNCH";
+
+private:
+    std::mutex m_mutex;
+    bool m_resolved = false;
+    std::wstring m_progId;          // As resolved; "" = system default
+    std::wstring m_command;         // "open" command template; "" = none usable
+
+    HKEY m_hFileExts = nullptr;     // ...\FileExts\.pdf, watched for a new UserChoice
+    HANDLE m_hChanged = nullptr;    // Signalled by RegNotifyChangeKeyValue
+
+    // Resolved command for the current association (caller holds m_mutex)
+    void RefreshIfChanged();
+    void ArmNotification();
+    void Resolve();
+
+    // The user's chosen ProgId for .pdf, "" if none is set (a registry read;
+    // Resolve caches it until the association changes)
+    static std::wstring QueryProgId();
+
+    static bool Launch(const std::wstring& commandLine);
+    static std::vector<wchar_t> BuildChildEnvironment();
+    static std::wstring BuildCommandLine(const std::wstring& command, const std::wstring& pdfPath);
+    static bool IsOwnExecutable(const std::wstring& command);
+};
+
+} // namespace Helium
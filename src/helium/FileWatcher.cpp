@@ -0,0 +1,175 @@
+// FileWatcher.cpp — Change notification for a single file
+
+#include "FileWatcher.h"
+
+namespace Helium {
+
+// Writers (Float's export, editors saving JSON) touch a file in a few
+// bursts — coalesce them into one callback
+static const DWORD kSettleMs = 150;
+
+FileWatcher::FileWatcher() {}
+
+FileWatcher::~FileWatcher() {
+    Stop();
+}
+
+bool FileWatcher::Start(const std::wstring& path, Callback onChange, bool catchUp,
+                        const wchar_t* signalName, DWORD fallbackMs) {
+    if (m_thread.joinable()) return false;
+
+    m_path = path;
+    m_onChange = std::move(onChange);
+    m_catchUp = catchUp;
+    m_signalName = signalName ? signalName : L"";
+    m_fallbackMs = fallbackMs;
+
+    m_hStop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!m_hStop) return false;
+
+    // Here rather than on the thread, so a directory that can't be watched
+    // fails Start() instead of leaving a thread that never calls back
+    m_watching = OpenWatch();
+    if (!m_watching && m_fallbackMs == INFINITE) {
+        CloseWatch();
+        CloseHandle(m_hStop);
+        m_hStop = nullptr;
+        return false;
+    }
+
+    m_running = true;
+    m_thread = std::thread(&FileWatcher::WatchLoop, this);
+    return true;
+}
+
+void FileWatcher::Stop() {
+    m_running = false;
+    if (m_hStop) {
+        SetEvent(m_hStop);
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_hStop) {
+        CloseHandle(m_hStop);
+        m_hStop = nullptr;
+    }
+}
+
+bool FileWatcher::OpenWatch() {
+    size_t lastSlash = m_path.find_last_of(L"\\/");
+    std::wstring dir = lastSlash != std::wstring::npos ? m_path.substr(0, lastSlash) : L".";
+    m_name = lastSlash != std::wstring::npos ? m_path.substr(lastSlash + 1) : m_path;
+
+    m_hDir = CreateFileW(
+        dir.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr
+    );
+    m_overlapped = {};
+    m_overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    return ArmWatch();
+}
+
+bool FileWatcher::ArmWatch() {
+    if (m_hDir == INVALID_HANDLE_VALUE || !m_overlapped.hEvent) return false;
+    ResetEvent(m_overlapped.hEvent);
+    return ReadDirectoryChangesW(
+        m_hDir, m_changes, sizeof(m_changes), FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+        nullptr, &m_overlapped, nullptr) != 0;
+}
+
+void FileWatcher::CloseWatch() {
+    if (m_hDir != INVALID_HANDLE_VALUE) {
+        if (m_watching) {
+            DWORD bytes = 0;
+            CancelIoEx(m_hDir, &m_overlapped);
+            GetOverlappedResult(m_hDir, &m_overlapped, &bytes, TRUE);
+        }
+        CloseHandle(m_hDir);
+        m_hDir = INVALID_HANDLE_VALUE;
+    }
+    if (m_overlapped.hEvent) {
+        CloseHandle(m_overlapped.hEvent);
+        m_overlapped.hEvent = nullptr;
+    }
+    m_watching = false;
+}
+
+void FileWatcher::WatchLoop() {
+    if (m_catchUp) {
+        m_onChange();
+    }
+
+    HANDLE hSignal = m_signalName.empty() ? nullptr
+                                          : CreateEventW(nullptr, FALSE, FALSE, m_signalName.c_str());
+
+    // A change record for our file (or an overflowed buffer) counts.
+    // Editors often save via rename, so renames onto the name count too.
+    auto touchesFile = [&](DWORD bytes) {
+        if (bytes == 0) return true;
+        const BYTE* p = m_changes;
+        for (;;) {
+            auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+            int len = (int)(info->FileNameLength / sizeof(WCHAR));
+            if (CompareStringOrdinal(info->FileName, len, m_name.c_str(), (int)m_name.size(), TRUE) == CSTR_EQUAL) {
+                return true;
+            }
+            if (info->NextEntryOffset == 0) return false;
+            p += info->NextEntryOffset;
+        }
+    };
+
+    bool timerOnly = false;     // Waiting on the notifications failed
+
+    // The fallback poll keeps its own deadline, moved only by a callback:
+    // changes to other files in the directory (the cache's own journal and
+    // index writes) must not keep pushing it back
+    bool polling = m_fallbackMs != INFINITE;
+    ULONGLONG fallbackDue = GetTickCount64() + (polling ? m_fallbackMs : 0);
+    auto untilFallback = [&]() -> DWORD {
+        if (!polling) return INFINITE;
+        ULONGLONG now = GetTickCount64();
+        return now >= fallbackDue ? 0 : (DWORD)(fallbackDue - now);
+    };
+
+    while (m_running) {
+        // Stop first so it always wins
+        HANDLE handles[3] = { m_hStop };
+        DWORD count = 1;
+        if (m_watching && !timerOnly) handles[count++] = m_overlapped.hEvent;
+        if (hSignal && !timerOnly) handles[count++] = hSignal;
+
+        DWORD wait = WaitForMultipleObjects(count, handles, FALSE, untilFallback());
+        if (wait == WAIT_OBJECT_0 || !m_running) {
+            break;
+        }
+
+        // Never a change: carry on with the fallback poll alone, or stop
+        // if there is none (or waiting on the stop event failed too)
+        if (wait == WAIT_FAILED) {
+            if (count == 1 || !polling) break;
+            timerOnly = true;
+            continue;
+        }
+
+        if (m_watching && wait == WAIT_OBJECT_0 + 1) {
+            DWORD bytes = 0;
+            bool relevant = GetOverlappedResult(m_hDir, &m_overlapped, &bytes, FALSE) && touchesFile(bytes);
+            m_watching = ArmWatch();
+            if (!relevant) continue;
+        }
+
+        if (WaitForSingleObject(m_hStop, kSettleMs) != WAIT_TIMEOUT) {
+            break;
+        }
+        m_onChange();
+        fallbackDue = GetTickCount64() + (polling ? m_fallbackMs : 0);
+    }
+
+    CloseWatch();
+    if (hSignal) CloseHandle(hSignal);
+}
+
+} // namespace Helium
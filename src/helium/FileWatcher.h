@@ -0,0 +1,67 @@
+// FileWatcher.h — Change notification for a single file
+// Watches the file's directory (ReadDirectoryChangesW) on a background thread
+// and calls back once writes settle. Polls only when asked to (fallbackMs),
+// for directories whose change events can't be relied on.
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <functional>
+#include <thread>
+#include <atomic>
+
+namespace Helium {
+
+class FileWatcher {
+public:
+    using Callback = std::function<void()>;
+
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Start watching path. onChange runs on the watcher thread.
+    //   catchUp     — also call onChange once right away
+    //   signalName  — optional named auto-reset event another process can set
+    //   fallbackMs  — call onChange when this long has passed since the last
+    //                 callback, whatever else changed in the directory (for
+    //                 shares that don't deliver change events, or lose them)
+    // Returns false if the directory can't be watched (missing, access
+    // denied) and there is no fallback poll: nothing would ever call back,
+    // so the caller should keep reading the file itself.
+    bool Start(const std::wstring& path, Callback onChange, bool catchUp = false,
+               const wchar_t* signalName = nullptr, DWORD fallbackMs = INFINITE);
+
+    // Stop and join the watcher thread. Safe to call when not started.
+    void Stop();
+
+    bool IsRunning() const { return m_thread.joinable(); }
+
+private:
+    std::wstring m_path;
+    std::wstring m_signalName;
+    Callback m_onChange;
+    bool m_catchUp = false;
+    DWORD m_fallbackMs = INFINITE;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    HANDLE m_hStop = nullptr;
+
+    // Directory watch, opened and first armed by Start()
+    std::wstring m_name;
+    HANDLE m_hDir = INVALID_HANDLE_VALUE;
+    OVERLAPPED m_overlapped = {};
+    bool m_watching = false;
+    alignas(DWORD) BYTE m_changes[4096];
+
+    bool OpenWatch();
+    bool ArmWatch();
+    void CloseWatch();
+    void WatchLoop();
+};
+
+} // namespace Helium
@@ -0,0 +1,156 @@
+// FolderPrefetch.cpp — Warm up the other PDFs in an opened invoice's folder
+
+#include "FolderPrefetch.h"
+#include "InvoiceRouter.h"
+#include "RouteCache.h"
+#include "ContentHash.h"
+#include <algorithm>
+
+namespace Helium {
+
+// A month's invoices from one client; beyond that, the rest of the folder
+// is unlikely to be opened from this one
+static const size_t kMaxSiblings = 200;
+
+// Hashing reads the whole file — leave scanned bundles for submit time
+static const uint64_t kMaxHashBytes = 32ull * 1024 * 1024;
+
+// Remembered hashes before the table is dropped and rebuilt
+static const size_t kMaxRemembered = 4096;
+
+FolderPrefetcher::FolderPrefetcher(InvoiceRouter& router) : m_router(router) {}
+
+FolderPrefetcher::~FolderPrefetcher() {
+    Stop();
+}
+
+void FolderPrefetcher::PrefetchFolder(const std::wstring& pdfPath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingPath = pdfPath;
+    m_generation++;
+    if (!m_running) {
+        m_running = true;
+        m_thread = std::thread(&FolderPrefetcher::WorkerLoop, this);
+    }
+    m_wake.notify_one();
+}
+
+bool FolderPrefetcher::LookupContentHash(const std::wstring& pdfPath, uint64_t& contentHash) {
+    RouteCache::FileKey key;
+    if (!RouteCache::MakeKey(pdfPath, key)) return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_hashes.find(key.pathHash);
+    if (it == m_hashes.end() || it->second.fileSize != key.fileSize ||
+        it->second.writeTime != key.writeTime) {
+        return false;  // Not prefetched, or edited since
+    }
+    contentHash = it->second.contentHash;
+    return true;
+}
+
+void FolderPrefetcher::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_generation++;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void FolderPrefetcher::WorkerLoop() {
+    // Background mode lowers this thread's I/O and memory priority, so the
+    // viewer's own reads always go first
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return !m_running || !m_pendingPath.empty(); });
+        if (!m_running) break;
+
+        std::wstring openedPath = std::move(m_pendingPath);
+        m_pendingPath.clear();
+        uint64_t generation = m_generation;
+
+        lock.unlock();
+        PrefetchSiblings(openedPath, generation);
+        lock.lock();
+    }
+
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+}
+
+void FolderPrefetcher::PrefetchSiblings(const std::wstring& openedPath, uint64_t generation) {
+    for (const std::wstring& path : ListSiblings(openedPath)) {
+        if (m_generation != generation) return;  // Another document opened, or stopping
+
+        // Stores the decision in the route cache
+        RouteResult route = m_router.Route(path);
+        if (route.decision == RouteDecision::NotInvoice) continue;
+
+        RouteCache::FileKey key;
+        if (!RouteCache::MakeKey(path, key) || key.fileSize > kMaxHashBytes) continue;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_hashes.find(key.pathHash);
+            if (it != m_hashes.end() && it->second.fileSize == key.fileSize &&
+                it->second.writeTime == key.writeTime) {
+                continue;
+            }
+        }
+
+        // Also pulls the file into the OS cache for the viewer
+        uint64_t contentHash;
+        if (!ContentHasher::HashFile(path, contentHash)) continue;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_hashes.size() >= kMaxRemembered) {
+            m_hashes.clear();
+        }
+        m_hashes[key.pathHash] = { key.fileSize, key.writeTime, contentHash };
+    }
+}
+
+std::vector<std::wstring> FolderPrefetcher::ListSiblings(const std::wstring& openedPath) {
+    std::vector<std::wstring> siblings;
+    size_t lastSlash = openedPath.find_last_of(L"\\/");
+    if (lastSlash == std::wstring::npos) return siblings;
+
+    std::wstring dir = openedPath.substr(0, lastSlash + 1);
+    std::wstring openedName = openedPath.substr(lastSlash + 1);
+
+    WIN32_FIND_DATAW data;
+    HANDLE hFind = FindFirstFileExW((dir + L"*.pdf").c_str(), FindExInfoBasic, &data,
+                                    FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE) return siblings;
+
+    std::vector<std::wstring> names;
+    do {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        names.push_back(data.cFileName);
+    } while (FindNextFileW(hFind, &data));
+    FindClose(hFind);
+
+    auto less = [](const std::wstring& a, const std::wstring& b) {
+        return CompareStringOrdinal(a.c_str(), (int)a.size(), b.c_str(), (int)b.size(), TRUE) == CSTR_LESS_THAN;
+    };
+    std::sort(names.begin(), names.end(), less);
+
+    // The next files in name order are the likeliest next opens; then the
+    // ones before, nearest first
+    auto after = std::upper_bound(names.begin(), names.end(), openedName, less);
+    auto before = std::lower_bound(names.begin(), after, openedName, less);
+    for (auto it = after; it != names.end() && siblings.size() < kMaxSiblings; ++it) {
+        siblings.push_back(dir + *it);
+    }
+    for (auto it = before; it != names.begin() && siblings.size() < kMaxSiblings;) {
+        --it;
+        siblings.push_back(dir + *it);
+    }
+    return siblings;
+}
+
+} // namespace Helium
@@ -0,0 +1,63 @@
+// FolderPrefetch.h — Warm up the other PDFs in an opened invoice's folder
+// Clerks work through a folder of invoices one after another. While one is
+// on screen, a background thread (low I/O priority) routes its siblings into
+// the route cache and hashes them, so the next one opens straight from the
+// cache, already in the OS file cache, with its duplicate status known.
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+namespace Helium {
+
+class InvoiceRouter;
+
+class FolderPrefetcher {
+public:
+    explicit FolderPrefetcher(InvoiceRouter& router);
+    ~FolderPrefetcher();
+
+    FolderPrefetcher(const FolderPrefetcher&) = delete;
+    FolderPrefetcher& operator=(const FolderPrefetcher&) = delete;
+
+    // Route and hash the other PDFs next to pdfPath, nearest-after first.
+    // A newer call abandons the folder in progress.
+    void PrefetchFolder(const std::wstring& pdfPath);
+
+    // Content hash from the prefetch, if this exact file version was hashed
+    bool LookupContentHash(const std::wstring& pdfPath, uint64_t& contentHash);
+
+    // Stop and join the worker. Safe to call when not started.
+    void Stop();
+
+private:
+    struct Prefetched {
+        uint64_t fileSize;
+        uint64_t writeTime;
+        uint64_t contentHash;
+    };
+
+    InvoiceRouter& m_router;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+    bool m_running = false;
+    std::wstring m_pendingPath;                         // Latest request; older ones are dropped
+    std::atomic<uint64_t> m_generation{0};              // Bumped per request; stale walks stop
+    std::unordered_map<uint64_t, Prefetched> m_hashes;  // By RouteCache path hash
+
+    void WorkerLoop();
+    void PrefetchSiblings(const std::wstring& openedPath, uint64_t generation);
+    static std::vector<std::wstring> ListSiblings(const std::wstring& openedPath);
+};
+
+} // namespace Helium
@@ -1,123 +1,586 @@
 // HeliumController.cpp — Main integration controller
 
 #include "HeliumController.h"
-#include <thread>
+#include "StringUtil.h"
 #include <shlobj.h>
 
 namespace Helium {
 
-HeliumController::HeliumController() {
-    m_buttonState.state = SubmitButtonState::Checking;
-    m_buttonState.label = "Checking...";
-    m_buttonState.tooltip = "Verifying session and connection";
+HeliumController::HeliumController() : m_spool(m_relay, m_cache), m_prefetcher(m_router) {
+    m_buttonState.Publish(std::make_shared<const ButtonStateInfo>(ButtonStateInfo{
+        SubmitButtonState::Checking,
+        "Checking...",
+        "Verifying session and connection",
+        L"Checking..."
+    }));
+    m_revertTimer = CreateThreadpoolTimer(&HeliumController::RevertTimerCallback, this, nullptr);
 }
 
 HeliumController::~HeliumController() {
+    // Startup stages use every subsystem below
+    if (m_hStartupDone) {
+        WaitForSingleObject(m_hStartupDone, INFINITE);
+        CloseHandle(m_hStartupDone);
+    }
+
+    // Its change callback wakes the spool and repaints the button
+    m_relay.Health().Stop();
+
+    m_prefetcher.Stop();
+
+    // Spool jobs hash and copy on the thread pool, then report back to us
+    {
+        std::unique_lock<std::mutex> lock(m_submitMutex);
+        m_spoolJobsDone.wait(lock, [this] { return m_spoolJobs == 0; });
+    }
+
+    // The drain thread calls back into us; queued entries stay on disk
+    m_spool.StopDrain();
+
+    // Callbacks below reference us — let an in-flight upload finish cancelling
+    std::shared_ptr<SubmitOperation> submission;
+    std::shared_ptr<BatchSubmission> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        submission = m_submission;
+        batch = m_batch;
+    }
+    if (submission) {
+        submission->Cancel();
+        submission->Wait();
+    }
+    if (batch) {
+        batch->Cancel();
+        batch->Wait();
+    }
+
+    if (m_revertTimer) {
+        SetThreadpoolTimer(m_revertTimer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(m_revertTimer, TRUE);
+        CloseThreadpoolTimer(m_revertTimer);
+    }
+
     m_cache.StopBackgroundSync();
+    SessionToken::StopWatching();
+
+    // Everything that records has stopped
+    LatencyStats::Dump(GetLatencyLogPath());
+}
+
+LaunchRoute HeliumController::RouteBeforeLaunch(const std::wstring& pdfPath) {
+    // Launched by our own fallback: the user's handler is us after all
+    if (pdfPath.empty() || InvoiceRouter::IsFallbackLaunch()) {
+        return LaunchRoute::OpenInTransforma;
+    }
+
+    int64_t begin = LatencyStats::Now();
+
+    InvoiceRouter router;
+    router.LoadPatterns(GetConfigPath(), false);
+    router.OpenRouteCache(GetRouteCachePath());
+
+    RouteResult result;
+    bool decided = router.RouteFast(pdfPath, result);
+    bool fallback = decided && result.decision == RouteDecision::NotInvoice &&
+                    router.OpenWithFallback(pdfPath);
+
+    // Not dumped on a hand-off: the route-only launch makes no disk writes.
+    // Built with HELIUM_ENABLE_ETW, the sample still reaches WPA.
+    LatencyStats::RecordSince(LatencyStage::LaunchRoute, begin);
+    return fallback ? LaunchRoute::OpenedWithFallback : LaunchRoute::OpenInTransforma;
 }
 
 bool HeliumController::Initialize() {
-    // Load duplicate cache
-    std::wstring cachePath = GetCachePath();
-    m_cache.Load(cachePath);
+    QueryPerformanceCounter(&m_startupBegin);
+
+    // Client routing patterns (mapped from the compiled pack when current).
+    // Stays on this thread: the first OnPdfOpened routes with them.
+    m_router.LoadPatterns(GetConfigPath());
+
+    // Decisions for files routed on earlier launches
+    m_router.OpenRouteCache(GetRouteCachePath());
+
+    // Everything else runs in parallel off the startup path; the viewer
+    // paints meanwhile with the button in Checking
+    m_hStartupDone = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    m_startupPending = 3;
+    m_stages[0] = { this, StartupStage::Cache };
+    m_stages[1] = { this, StartupStage::Session };
+    m_stages[2] = { this, StartupStage::Relay };
+    for (StageContext& stage : m_stages) {
+        if (!TrySubmitThreadpoolCallback(&HeliumController::StartupStageCallback, &stage, nullptr)) {
+            RunStartupStage(stage.stage);
+        }
+    }
+    return true;
+}
 
-    // Check session
-    if (!SessionToken::HasValidSession()) {
-        SetState(SubmitButtonState::NoSession,
-                 "Sign In Required",
-                 "Open Float to sign in to your Helium account");
-        return true; // Non-fatal — user just can't submit yet
+void CALLBACK HeliumController::StartupStageCallback(PTP_CALLBACK_INSTANCE, PVOID context) {
+    auto stage = (StageContext*)context;
+    stage->controller->RunStartupStage(stage->stage);
+}
+
+void HeliumController::RunStartupStage(StartupStage stage) {
+    LARGE_INTEGER begin;
+    QueryPerformanceCounter(&begin);
+
+    switch (stage) {
+    case StartupStage::Cache:
+        // Load duplicate cache
+        m_cache.Load(GetCachePath());
+
+        // Import Float's submissions as they happen
+        m_cache.StartBackgroundSync(GetSyncExportPath());
+
+        // Submissions queued while Relay was down, here or on an earlier run
+        m_spool.Load(GetSpoolPath());
+        m_spool.StartDrain([this](const SpoolEntry& entry, const SubmitResult& result) {
+            OnSpoolDrained(entry, result);
+        });
+        m_timings.cacheMs = ElapsedMs(begin);
+        break;
+
+    case StartupStage::Session:
+        // Decrypts once; later checks hit the in-memory session
+        SessionToken::HasValidSession();
+        m_timings.sessionMs = ElapsedMs(begin);
+        break;
+
+    case StartupStage::Relay:
+        // First probe inline (short timeouts), then the monitor keeps watch
+        m_relay.Health().Start([this](bool reachable) { OnRelayHealthChanged(reachable); });
+        m_timings.relayMs = ElapsedMs(begin);
+        break;
     }
 
-    // Check Relay connectivity
-    if (!m_relay.IsRelayAvailable()) {
-        SetState(SubmitButtonState::FloatNotRunning,
-                 "Start Float",
-                 "Helium Float must be running to submit invoices");
-        return true; // Non-fatal
+    if (--m_startupPending == 0) {
+        FinishStartup();
     }
+}
 
-    SetState(SubmitButtonState::Ready,
-             "Submit to FIRS",
-             "Send this invoice to FIRS for processing");
+void HeliumController::FinishStartup() {
+    m_timings.totalMs = ElapsedMs(m_startupBegin);
+    m_startupDone = true;
 
-    return true;
+    // Session, duplicate and Relay state for whatever is open by now
+    std::wstring current;
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        current = m_currentPdf;
+    }
+    RefreshButtonState(current);
+
+    SetEvent(m_hStartupDone);
+}
+
+StartupTimings HeliumController::GetStartupTimings() {
+    return m_startupDone ? m_timings : StartupTimings{};
+}
+
+double HeliumController::ElapsedMs(const LARGE_INTEGER& since) {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)(now.QuadPart - since.QuadPart) * 1000.0 / (double)frequency.QuadPart;
 }
 
 RouteResult HeliumController::OnPdfOpened(const std::wstring& pdfPath) {
-    m_currentPdf = pdfPath;
-    RouteResult result = m_router.Route(pdfPath);
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        m_currentPdf = pdfPath;
+    }
+    CancelRevert();
+
+    // Converted once: routing and the duplicate check share it
+    Utf8Filename filename(pdfPath);
+    RouteResult result = m_router.Route(pdfPath, filename);
+
+    // Content routing already read the invoice fields; keep them for Submit
+    if (result.fields.scanned) {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        m_fieldsPdf = pdfPath;
+        m_fields = result.fields;
+    }
 
     if (result.decision == RouteDecision::Invoice ||
         result.decision == RouteDecision::Unknown) {
         // Show in Transforma — refresh button state for this file
-        RefreshButtonState(pdfPath);
+        RefreshButtonState(pdfPath, filename);
+
+        // The next invoice in the folder then opens from the caches
+        m_prefetcher.PrefetchFolder(pdfPath);
     }
 
     return result;
 }
 
 void HeliumController::OnSubmitClicked(const std::wstring& currentPdfPath) {
-    // Run submission on background thread to keep UI responsive
-    std::thread([this, currentPdfPath]() {
-        // 1. Check session
-        SessionInfo session = SessionToken::Load();
+    std::lock_guard<std::mutex> lock(m_submitMutex);
+
+    // Double click, or a click while another tab or a batch uploads — one at a time
+    if (!m_startupDone || IsSubmitting()) return;
+
+    // 1. Check session
+    SessionInfo session = SessionToken::Load();
+    if (!session.valid) {
+        SetState(SubmitButtonState::NoSession,
+                 "Sign In Required",
+                 session.error);
+        return;
+    }
+
+    // 2. Relay down — accept it now, send it later
+    if (!m_relay.Health().IsReachable()) {
+        SpoolSubmission(currentPdfPath, session.username);
+        return;
+    }
+
+    // 3. Submit via Relay. The duplicate check runs once the PDF has been
+    // read and hashed, so renamed copies are caught without a second read.
+    CancelRevert();
+    m_submitPercent = -1;
+    SetState(SubmitButtonState::Submitting,
+             "Submitting...",
+             "Sending to Helium Relay for FIRS processing");
+
+    std::string filename = Utf8Filename(currentPdfPath).Str();
+    std::string username = session.username;
+    auto dupCheck = std::make_shared<DuplicateCheckResult>();
+
+    // Unscanned (routed by filename) fields are extracted during the upload's prepare step
+    InvoiceFields fields = m_fieldsPdf == currentPdfPath ? m_fields : InvoiceFields();
+
+    m_submissionPdf = currentPdfPath;
+    m_submission = m_relay.SubmitInvoiceAsync(
+        currentPdfPath, session.username, session.token,
+        [this, filename, dupCheck](uint64_t contentHash) {
+            *dupCheck = m_cache.Check(filename, contentHash);
+            return dupCheck->status != DuplicateStatus::AlreadySubmitted;
+        },
+        [this, currentPdfPath](uint64_t sent, uint64_t total) {
+            OnUploadProgress(currentPdfPath, sent, total);
+        },
+        [this, currentPdfPath, filename, username, dupCheck](const SubmitResult& result) {
+            OnSubmitFinished(currentPdfPath, filename, username, *dupCheck, result);
+        },
+        fields
+    );
+
+    // Holding m_submitMutex until here keeps the completion (which clears
+    // m_submission) from running before it was set
+    if (!m_submission) {
+        m_submissionPdf.clear();
+        SetState(SubmitButtonState::Error,
+                 "Submit Failed",
+                 "Could not start the submission");
+        ScheduleRevert(currentPdfPath, 5000, SubmitButtonState::Ready,
+                       "Submit to FIRS",
+                       "Click to retry submission");
+    }
+}
+
+void HeliumController::OnPdfClosed(const std::wstring& pdfPath) {
+    std::shared_ptr<SubmitOperation> submission;
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        if (m_submission && m_submissionPdf == pdfPath) {
+            submission = m_submission;
+        }
+    }
+    // Completes through OnSubmitFinished with result.cancelled
+    if (submission) {
+        submission->Cancel();
+    }
+}
+
+bool HeliumController::SubmitBatch(const std::vector<std::wstring>& pdfPaths,
+                                   const BatchProgressCallback& onProgress,
+                                   const BatchDoneCallback& onDone) {
+    std::shared_ptr<BatchSubmission> batch;
+    SessionInfo session;
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        if (!m_startupDone || IsSubmitting() || pdfPaths.empty()) return false;
+
+        // One session load for the whole batch
+        session = SessionToken::Load();
         if (!session.valid) {
             SetState(SubmitButtonState::NoSession,
                      "Sign In Required",
                      session.error);
-            return;
+            return false;
         }
 
-        // 2. Check duplicate
-        std::string filename = ExtractFilename(currentPdfPath);
-        auto dupCheck = m_cache.Check(filename);
-        if (dupCheck.status == DuplicateStatus::AlreadySubmitted) {
-            SetState(SubmitButtonState::AlreadySubmitted,
-                     "Already Submitted",
-                     "Submitted by " + dupCheck.submittedBy +
-                     " (Ref: " + dupCheck.firsReference + ")");
-            return;
-        }
+        // The previous batch is done; dropping it here (UI thread) keeps its
+        // destructor off its own timer thread
+        m_batch = std::make_shared<BatchSubmission>(m_relay, m_cache);
+        m_batchTotal = pdfPaths.size();
+        m_batchFinished = 0;
+        batch = m_batch;
+    }
 
-        // 3. Submit via Relay
-        SetState(SubmitButtonState::Submitting,
-                 "Submitting...",
-                 "Sending to Helium Relay for FIRS processing");
-
-        SubmitResult result = m_relay.SubmitInvoice(
-            currentPdfPath, session.username, session.token
-        );
-
-        if (result.success) {
-            // 4. Record in cache
-            m_cache.AddEntry(filename, result.firsReference, session.username);
-
-            SetState(SubmitButtonState::Success,
-                     "Submitted!",
-                     "FIRS Reference: " + result.firsReference);
-
-            // Revert to "Already Submitted" after 3 seconds
-            Sleep(3000);
-            SetState(SubmitButtonState::AlreadySubmitted,
-                     "Already Submitted",
-                     "FIRS Reference: " + result.firsReference);
-        } else {
-            SetState(SubmitButtonState::Error,
-                     "Submit Failed",
-                     result.error);
-
-            // Revert to Ready after 5 seconds
-            Sleep(5000);
-            SetState(SubmitButtonState::Ready,
-                     "Submit to FIRS",
-                     "Click to retry submission");
-        }
-    }).detach();
+    CancelRevert();
+    SetState(SubmitButtonState::Submitting,
+             "Submitting 0/" + std::to_string(pdfPaths.size()),
+             "Sending " + std::to_string(pdfPaths.size()) + " documents to Helium Relay");
+
+    // Started outside m_submitMutex: callbacks take it (IsCurrentPdf) and
+    // onDone may run before Start returns
+    batch->Start(pdfPaths, session,
+        [this, onProgress](size_t index, const BatchFileProgress& progress) {
+            if (progress.status != BatchFileStatus::Queued &&
+                progress.status != BatchFileStatus::Uploading) {
+                size_t finished = ++m_batchFinished;
+                SetState(SubmitButtonState::Submitting,
+                         "Submitting " + std::to_string(finished) + "/" + std::to_string(m_batchTotal),
+                         "Sending " + std::to_string(m_batchTotal) + " documents to Helium Relay");
+            }
+            if (onProgress) onProgress(index, progress);
+        },
+        [this, onDone](const BatchSummary& summary) {
+            if (onDone) onDone(summary);
+
+            std::wstring current;
+            {
+                std::lock_guard<std::mutex> lock(m_submitMutex);
+                current = m_currentPdf;
+            }
+            if (!current.empty()) {
+                RefreshButtonState(current);
+            }
+        });
+    return true;
+}
+
+void HeliumController::CancelBatch() {
+    std::shared_ptr<BatchSubmission> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        batch = m_batch;
+    }
+    if (batch) {
+        batch->Cancel();
+    }
+}
+
+bool HeliumController::IsSubmitting() {
+    return m_submission || m_spoolJobs > 0 || (m_batch && !m_batch->IsDone());
+}
+
+bool HeliumController::IsCurrentPdf(const std::wstring& pdfPath) {
+    std::lock_guard<std::mutex> lock(m_submitMutex);
+    return m_currentPdf == pdfPath;
+}
+
+void HeliumController::OnUploadProgress(const std::wstring& pdfPath, uint64_t sent, uint64_t total) {
+    // Repaint only when the percentage moves, and only for the visible tab
+    int percent = total ? (int)(sent * 100 / total) : 100;
+    if (m_submitPercent.exchange(percent) == percent || !IsCurrentPdf(pdfPath)) {
+        return;
+    }
+    SetState(SubmitButtonState::Submitting,
+             "Submitting " + std::to_string(percent) + "%",
+             "Sending to Helium Relay for FIRS processing");
+}
+
+void HeliumController::OnSubmitFinished(const std::wstring& pdfPath, const std::string& filename,
+                                        const std::string& username, const DuplicateCheckResult& dupCheck,
+                                        const SubmitResult& result) {
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        m_submission.reset();
+        m_submissionPdf.clear();
+    }
+
+    // 4. Record in cache — whichever tab is showing now
+    if (result.success) {
+        m_cache.AddEntry(filename, result.firsReference, username, result.contentHash);
+    }
+
+    // Relay went away mid-session: nothing reached it, so queue the invoice.
+    // The upload already told the health monitor; no probe to wait out here.
+    if (!result.success && result.unreachable) {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        SpoolSubmission(pdfPath, username);
+        return;
+    }
+
+    if (!IsCurrentPdf(pdfPath)) {
+        return;  // Its tab is gone or in the background; it refreshes when shown
+    }
+
+    if (result.blocked) {
+        SetState(SubmitButtonState::AlreadySubmitted,
+                 "Already Submitted",
+                 "Submitted by " + dupCheck.submittedBy +
+                 " (Ref: " + dupCheck.firsReference + ")");
+    } else if (result.success) {
+        SetState(SubmitButtonState::Success,
+                 "Submitted!",
+                 "FIRS Reference: " + result.firsReference);
+
+        // Revert to "Already Submitted" after 3 seconds
+        ScheduleRevert(pdfPath, 3000, SubmitButtonState::AlreadySubmitted,
+                       "Already Submitted",
+                       "FIRS Reference: " + result.firsReference);
+    } else if (result.cancelled) {
+        SetState(SubmitButtonState::Ready,
+                 "Submit to FIRS",
+                 "Submission cancelled");
+    } else {
+        SetState(SubmitButtonState::Error,
+                 "Submit Failed",
+                 result.error);
+
+        // Revert to Ready after 5 seconds
+        ScheduleRevert(pdfPath, 5000, SubmitButtonState::Ready,
+                       "Submit to FIRS",
+                       "Click to retry submission");
+    }
+}
+
+void HeliumController::SpoolSubmission(const std::wstring& pdfPath, const std::string& user) {
+    if (m_currentPdf == pdfPath) {
+        CancelRevert();
+        SetState(SubmitButtonState::Checking,
+                 "Queuing...",
+                 "Saving a copy to send once Helium Float is running");
+    }
+
+    // Hashing and copying a large scan takes a while — never on the UI thread
+    std::unique_ptr<SpoolJob> job(new SpoolJob{ this, pdfPath, user });
+    m_spoolJobs++;
+    if (TrySubmitThreadpoolCallback(&HeliumController::SpoolJobCallback, job.get(), nullptr)) {
+        job.release();
+        return;
+    }
+    m_spoolJobs--;
+    if (m_currentPdf == pdfPath) {
+        SetState(SubmitButtonState::Error,
+                 "Submit Failed",
+                 "Could not queue the submission");
+        ScheduleRevert(pdfPath, 5000, SubmitButtonState::FloatNotRunning,
+                       "Queue for FIRS",
+                       "Click to retry");
+    }
+}
+
+void CALLBACK HeliumController::SpoolJobCallback(PTP_CALLBACK_INSTANCE, PVOID context) {
+    std::unique_ptr<SpoolJob> job((SpoolJob*)context);
+    std::string error;
+    SpoolStatus status = job->controller->m_spool.Enqueue(job->pdfPath, job->user, error);
+    job->controller->FinishSpooling(job->pdfPath, status, error);
+}
+
+void HeliumController::FinishSpooling(const std::wstring& pdfPath, SpoolStatus status, const std::string& error) {
+    // Another tab is showing: it refreshes when this one is shown again
+    if (IsCurrentPdf(pdfPath)) {
+        ReportSpooled(pdfPath, status, error);
+    }
+
+    // Last: once the count drops the destructor may proceed
+    std::lock_guard<std::mutex> lock(m_submitMutex);
+    if (--m_spoolJobs == 0) {
+        m_spoolJobsDone.notify_all();
+    }
+}
+
+void HeliumController::ReportSpooled(const std::wstring& pdfPath, SpoolStatus status, const std::string& error) {
+    switch (status) {
+    case SpoolStatus::Queued:
+    case SpoolStatus::AlreadyQueued:
+        SetState(SubmitButtonState::Queued,
+                 "Queued",
+                 "Will be submitted automatically once Helium Float is running");
+        break;
+    case SpoolStatus::AlreadySubmitted:
+        RefreshButtonState(pdfPath);
+        break;
+    case SpoolStatus::Failed:
+        SetState(SubmitButtonState::Error,
+                 "Submit Failed",
+                 error);
+        ScheduleRevert(pdfPath, 5000, SubmitButtonState::FloatNotRunning,
+                       "Queue for FIRS",
+                       "Click to retry");
+        break;
+    }
+}
+
+void HeliumController::OnSpoolDrained(const SpoolEntry& entry, const SubmitResult& result) {
+    std::wstring current;
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        if (IsSubmitting()) return;       // Its completion sets the button
+        current = m_currentPdf;
+    }
+    if (current.empty() || Utf8Filename(current).View() != entry.filename) {
+        return;  // Not on screen; it refreshes when shown
+    }
+
+    if (result.success) {
+        SetState(SubmitButtonState::Success,
+                 "Submitted!",
+                 "FIRS Reference: " + result.firsReference);
+        ScheduleRevert(current, 3000, SubmitButtonState::AlreadySubmitted,
+                       "Already Submitted",
+                       "FIRS Reference: " + result.firsReference);
+    } else if (result.blocked) {
+        RefreshButtonState(current);
+    } else {
+        SetState(SubmitButtonState::Error,
+                 "Submit Failed",
+                 result.error);
+        ScheduleRevert(current, 5000, SubmitButtonState::Ready,
+                       "Submit to FIRS",
+                       "Click to retry submission");
+    }
+}
+
+void HeliumController::ScheduleRevert(const std::wstring& pdfPath, DWORD delayMs, SubmitButtonState state,
+                                      const std::string& label, const std::string& tooltip) {
+    if (!m_revertTimer) return;
+    {
+        std::lock_guard<std::mutex> lock(m_revertMutex);
+        m_revertPending = true;
+        m_revertPdf = pdfPath;
+        m_revertState = { state, label, tooltip };
+    }
+
+    // Negative due time = relative, in 100ns units
+    ULARGE_INTEGER due;
+    due.QuadPart = (ULONGLONG)(-(LONGLONG)delayMs * 10000);
+    FILETIME dueTime;
+    dueTime.dwLowDateTime = due.LowPart;
+    dueTime.dwHighDateTime = due.HighPart;
+    SetThreadpoolTimer(m_revertTimer, &dueTime, 0, 0);
+}
+
+void HeliumController::CancelRevert() {
+    std::lock_guard<std::mutex> lock(m_revertMutex);
+    m_revertPending = false;
 }
 
-ButtonStateInfo HeliumController::GetButtonState() {
-    return m_buttonState;
+void CALLBACK HeliumController::RevertTimerCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+    auto self = (HeliumController*)context;
+
+    ButtonStateInfo state;
+    std::wstring pdfPath;
+    {
+        std::lock_guard<std::mutex> lock(self->m_revertMutex);
+        if (!self->m_revertPending) return;
+        self->m_revertPending = false;
+        state = self->m_revertState;
+        pdfPath = self->m_revertPdf;
+    }
+
+    if (self->IsCurrentPdf(pdfPath)) {
+        self->SetState(state.state, state.label, state.tooltip);
+    }
+}
+
+std::shared_ptr<const ButtonStateInfo> HeliumController::GetButtonState() const {
+    return m_buttonState.Load();
 }
 
 void HeliumController::SetButtonStateCallback(ButtonStateCallback callback) {
@@ -125,25 +588,50 @@ void HeliumController::SetButtonStateCallback(ButtonStateCallback callback) {
 }
 
 bool HeliumController::CheckRelayConnection() {
-    return m_relay.IsRelayAvailable();
+    return m_relay.Health().IsReachable();
+}
+
+void HeliumController::OnRelayHealthChanged(bool reachable) {
+    if (reachable) {
+        m_spool.Wake();     // Send what was queued without waiting out the backoff
+    }
+
+    std::wstring current;
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        if (IsSubmitting()) return;
+        current = m_currentPdf;
+    }
+    if (!current.empty()) {
+        RefreshButtonState(current);
+    }
 }
 
 void HeliumController::SetState(SubmitButtonState state, const std::string& label,
                                 const std::string& tooltip) {
-    m_buttonState.state = state;
-    m_buttonState.label = label;
-    m_buttonState.tooltip = tooltip;
+    // Built off to the side, then swapped in — a reader sees the old state
+    // or the new one, never a label being rewritten
+    auto next = std::make_shared<const ButtonStateInfo>(ButtonStateInfo{ state, label, tooltip, WidenLabel(label) });
+    m_buttonState.Publish(next);
 
     if (m_onStateChange) {
-        m_onStateChange(m_buttonState);
+        m_onStateChange(*next);
     }
 }
 
 void HeliumController::RefreshButtonState(const std::wstring& pdfPath) {
-    std::string filename = ExtractFilename(pdfPath);
+    RefreshButtonState(pdfPath, Utf8Filename(pdfPath));
+}
+
+void HeliumController::RefreshButtonState(const std::wstring& pdfPath, std::string_view filename) {
+    // Stays Checking until the startup stages are in; FinishStartup refreshes
+    if (!m_startupDone) return;
 
-    // Check duplicate cache first (instant)
-    auto dupCheck = m_cache.Check(filename);
+    // Check duplicate cache first (instant). By content when the folder
+    // prefetch hashed this version — renamed copies show as submitted too.
+    uint64_t contentHash = 0;
+    m_prefetcher.LookupContentHash(pdfPath, contentHash);
+    auto dupCheck = m_cache.Check(filename, contentHash);
     if (dupCheck.status == DuplicateStatus::AlreadySubmitted) {
         SetState(SubmitButtonState::AlreadySubmitted,
                  "Already Submitted",
@@ -152,6 +640,14 @@ void HeliumController::RefreshButtonState(const std::wstring& pdfPath) {
         return;
     }
 
+    // Accepted while Relay was down, not sent yet
+    if (m_spool.IsQueued(filename, contentHash)) {
+        SetState(SubmitButtonState::Queued,
+                 "Queued",
+                 "Will be submitted automatically once Helium Float is running");
+        return;
+    }
+
     // Check session
     if (!SessionToken::HasValidSession()) {
         SetState(SubmitButtonState::NoSession,
@@ -160,6 +656,13 @@ void HeliumController::RefreshButtonState(const std::wstring& pdfPath) {
         return;
     }
 
+    if (!m_relay.Health().IsReachable()) {
+        SetState(SubmitButtonState::FloatNotRunning,
+                 "Queue for FIRS",
+                 "Helium Float isn't running — the invoice is sent once it is");
+        return;
+    }
+
     SetState(SubmitButtonState::Ready,
              "Submit to FIRS",
              "Send this invoice to FIRS for processing");
@@ -173,17 +676,48 @@ std::wstring HeliumController::GetCachePath() {
     return std::wstring(programData) + L"\\Helium\\cache\\submitted-invoices.cache";
 }
 
-std::string HeliumController::ExtractFilename(const std::wstring& path) {
-    // Convert to UTF-8 and extract filename
-    int size = WideCharToMultiByte(CP_UTF8, 0, path.c_str(), (int)path.size(), nullptr, 0, nullptr, nullptr);
-    std::string utf8(size, 0);
-    WideCharToMultiByte(CP_UTF8, 0, path.c_str(), (int)path.size(), &utf8[0], size, nullptr, nullptr);
+std::wstring HeliumController::GetConfigPath() {
+    wchar_t programData[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(nullptr, CSIDL_COMMON_APPDATA, nullptr, 0, programData))) {
+        return L"routing-patterns.json";
+    }
+    return std::wstring(programData) + L"\\Helium\\config\\routing-patterns.json";
+}
 
-    size_t lastSlash = utf8.find_last_of("\\/");
-    if (lastSlash != std::string::npos) {
-        return utf8.substr(lastSlash + 1);
+std::wstring HeliumController::GetRouteCachePath() {
+    wchar_t programData[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(nullptr, CSIDL_COMMON_APPDATA, nullptr, 0, programData))) {
+        return L"route-decisions.cache";
     }
-    return utf8;
+    return std::wstring(programData) + L"\\Helium\\cache\\route-decisions.cache";
+}
+
+std::wstring HeliumController::GetSpoolPath() {
+    wchar_t programData[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(nullptr, CSIDL_COMMON_APPDATA, nullptr, 0, programData))) {
+        return L"spool";
+    }
+    return std::wstring(programData) + L"\\Helium\\spool";
+}
+
+std::wstring HeliumController::GetLatencyLogPath() {
+    wchar_t programData[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(nullptr, CSIDL_COMMON_APPDATA, nullptr, 0, programData))) {
+        return L"latency.log";
+    }
+    return std::wstring(programData) + L"\\Helium\\logs\\latency.log";
+}
+
+std::wstring HeliumController::GetSyncExportPath() {
+    wchar_t programData[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(nullptr, CSIDL_COMMON_APPDATA, nullptr, 0, programData))) {
+        return L"float-submissions.cache";
+    }
+    return std::wstring(programData) + L"\\Helium\\cache\\float-submissions.cache";
+}
+
+std::wstring HeliumController::WidenLabel(const std::string& label) {
+    return Utf8ToWide(label);
 }
 
 } // namespace Helium
@@ -8,8 +8,19 @@
 #include "SessionToken.h"
 #include "InvoiceRouter.h"
 #include "DuplicateCache.h"
+#include "BatchSubmission.h"
+#include "SubmissionSpool.h"
+#include "FolderPrefetch.h"
+#include "AtomicSnapshot.h"
+#include "LatencyStats.h"
 #include <string>
+#include <string_view>
+#include <vector>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 namespace Helium {
 
@@ -17,62 +28,182 @@ enum class SubmitButtonState {
     Ready,              // Blue — "Submit to FIRS"
     AlreadySubmitted,   // Grey — "Already Submitted"
     Checking,           // Blue spinner — "Checking..."
-    Submitting,         // Blue spinner — "Submitting..."
+    Submitting,         // Blue spinner — "Submitting..." / "Submitting 42%"
     Success,            // Green — "Submitted!" (reverts after 3s)
     Error,              // Red — error message
     NoSession,          // Orange — "Sign In Required"
-    FloatNotRunning     // Orange — "Start Float"
+    FloatNotRunning,    // Orange — "Queue for FIRS" (starts Float, spools the invoice)
+    Queued              // Grey — "Queued" (in the spool, sent when Relay is back)
 };
 
 struct ButtonStateInfo {
     SubmitButtonState state;
     std::string label;
     std::string tooltip;
+    std::wstring displayLabel;  // label widened from UTF-8, ready for DrawTextW
 };
 
-// Callback for UI updates (SumatraPDF toolbar repaints)
+// Wall-clock cost of each startup stage (QueryPerformanceCounter)
+struct StartupTimings {
+    double cacheMs = 0;         // Duplicate cache map + index, Float sync, spool
+    double sessionMs = 0;       // Token read + DPAPI decrypt
+    double relayMs = 0;         // First GET /health probe — short timeouts, even when Float is down
+    double totalMs = 0;         // Initialize() to the first real button state
+};
+
+// Callback for UI updates (SumatraPDF toolbar repaints). Runs on whichever
+// thread changed the state — marshal to the UI thread before touching windows.
 using ButtonStateCallback = std::function<void(const ButtonStateInfo&)>;
 
+// What a launch should do with its file, decided before any UI exists
+enum class LaunchRoute {
+    OpenInTransforma,       // Invoice, or needs content analysis — hand off or start the viewer
+    OpenedWithFallback      // Not an invoice, already passed to the fallback handler — exit
+};
+
 class HeliumController {
 public:
     HeliumController();
     ~HeliumController();
 
-    // Initialize all subsystems
+    // Route-only first step of every launch, with no controller: filename
+    // patterns (mapped pack) and the route cache only — no MuPDF, session,
+    // WinHTTP or UI. A known non-invoice goes straight to the fallback.
+    static LaunchRoute RouteBeforeLaunch(const std::wstring& pdfPath);
+
+    // Initialize all subsystems. Returns at once with the button in
+    // Checking: the cache load, session decrypt and Relay probe run in
+    // parallel on the thread pool, and the real state arrives through the
+    // state callback. Register the callback first.
     bool Initialize();
 
+    // Per-stage startup cost; all zero until startup has finished
+    StartupTimings GetStartupTimings();
+
     // Called when user opens a PDF — decides whether to show in Transforma or fallback
     RouteResult OnPdfOpened(const std::wstring& pdfPath);
 
-    // Called when user clicks "Submit to FIRS" button
+    // Called when user clicks "Submit to FIRS" button. Returns at once; the
+    // upload runs asynchronously and reports progress through the callback.
     void OnSubmitClicked(const std::wstring& currentPdfPath);
 
-    // Get current button state (for UI rendering)
-    ButtonStateInfo GetButtonState();
+    // Called when a document's tab closes — cancels its upload, if any
+    void OnPdfClosed(const std::wstring& pdfPath);
 
-    // Register callback for button state changes
+    // Submit several documents (e.g. every open tab) with one session and
+    // a pre-check pass. Returns false if a submission is already running
+    // or there's no session. Callbacks run on thread-pool threads.
+    bool SubmitBatch(const std::vector<std::wstring>& pdfPaths,
+                     const BatchProgressCallback& onProgress,
+                     const BatchDoneCallback& onDone);
+
+    // Stop a running batch; uploads in flight are cancelled
+    void CancelBatch();
+
+    // Current button state (for UI rendering): an immutable snapshot, read
+    // from any thread without locking or copying. Never null.
+    std::shared_ptr<const ButtonStateInfo> GetButtonState() const;
+
+    // Register callback for button state changes. Before Initialize; not
+    // changed once state changes can arrive from other threads.
     void SetButtonStateCallback(ButtonStateCallback callback);
 
-    // Check if Relay is available (called periodically)
+    // Whether Relay is reachable, as last seen by the health monitor.
+    // Never touches the network; changes arrive through the state callback.
     bool CheckRelayConnection();
 
 private:
     RelayClient m_relay;
     DuplicateCache m_cache;
     InvoiceRouter m_router;
-
-    ButtonStateInfo m_buttonState;
+    SubmissionSpool m_spool;
+    FolderPrefetcher m_prefetcher;
+
+    // Staged startup: stages count down, the last one publishes the state
+    enum class StartupStage { Cache, Session, Relay };
+    struct StageContext {
+        HeliumController* controller;
+        StartupStage stage;
+    };
+    StageContext m_stages[3];
+    std::atomic<int> m_startupPending{0};
+    std::atomic<bool> m_startupDone{false};
+    HANDLE m_hStartupDone = nullptr;
+    LARGE_INTEGER m_startupBegin = {};
+    StartupTimings m_timings;
+
+    // Replaced whole on every change; WM_PAINT reads it while workers publish
+    AtomicSnapshot<ButtonStateInfo> m_buttonState;
     ButtonStateCallback m_onStateChange;
+
+    // Guards the current document and the in-flight submission
+    std::mutex m_submitMutex;
     std::wstring m_currentPdf;
+    std::wstring m_fieldsPdf;                       // Document m_fields were read from at open
+    InvoiceFields m_fields;
+    std::shared_ptr<SubmitOperation> m_submission;
+    std::wstring m_submissionPdf;
+    std::atomic<int> m_submitPercent{-1};
+    std::shared_ptr<BatchSubmission> m_batch;       // Kept after it finishes; replaced by the next
+    std::atomic<size_t> m_batchFinished{0};
+    size_t m_batchTotal = 0;
+    int m_spoolJobs = 0;                            // SpoolSubmission copies still running
+    std::condition_variable m_spoolJobsDone;
+
+    // "Submitted!" / "Submit Failed" revert on a thread-pool timer; a newer
+    // state (tab switch, new click) cancels the pending revert
+    PTP_TIMER m_revertTimer = nullptr;
+    std::mutex m_revertMutex;
+    bool m_revertPending = false;
+    std::wstring m_revertPdf;
+    ButtonStateInfo m_revertState;
+
+    static void CALLBACK StartupStageCallback(PTP_CALLBACK_INSTANCE instance, PVOID context);
+    void RunStartupStage(StartupStage stage);
+    void FinishStartup();
+    static double ElapsedMs(const LARGE_INTEGER& since);
 
     void SetState(SubmitButtonState state, const std::string& label,
                   const std::string& tooltip);
 
-    // Update button state based on current PDF
+    // Update button state based on current PDF (filename: its Utf8Filename)
     void RefreshButtonState(const std::wstring& pdfPath);
+    void RefreshButtonState(const std::wstring& pdfPath, std::string_view filename);
+
+    bool IsCurrentPdf(const std::wstring& pdfPath);
+    bool IsSubmitting();    // Caller holds m_submitMutex
+    void OnUploadProgress(const std::wstring& pdfPath, uint64_t sent, uint64_t total);
+    void OnSubmitFinished(const std::wstring& pdfPath, const std::string& filename,
+                          const std::string& username, const DuplicateCheckResult& dupCheck,
+                          const SubmitResult& result);
+
+    // Relay is down: accept into the spool instead. The copy is made on the
+    // thread pool; the outcome arrives through SetState while pdfPath is on
+    // screen. Caller holds m_submitMutex.
+    struct SpoolJob {
+        HeliumController* controller;
+        std::wstring pdfPath;
+        std::string user;
+    };
+    void SpoolSubmission(const std::wstring& pdfPath, const std::string& user);
+    static void CALLBACK SpoolJobCallback(PTP_CALLBACK_INSTANCE instance, PVOID context);
+    void FinishSpooling(const std::wstring& pdfPath, SpoolStatus status, const std::string& error);
+    void ReportSpooled(const std::wstring& pdfPath, SpoolStatus status, const std::string& error);
+    void OnSpoolDrained(const SpoolEntry& entry, const SubmitResult& result);
+    void OnRelayHealthChanged(bool reachable);
+
+    void ScheduleRevert(const std::wstring& pdfPath, DWORD delayMs, SubmitButtonState state,
+                        const std::string& label, const std::string& tooltip);
+    void CancelRevert();
+    static void CALLBACK RevertTimerCallback(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
 
     static std::wstring GetCachePath();
-    static std::string ExtractFilename(const std::wstring& path);
+    static std::wstring GetSyncExportPath();
+    static std::wstring GetConfigPath();
+    static std::wstring GetRouteCachePath();
+    static std::wstring GetSpoolPath();
+    static std::wstring GetLatencyLogPath();
+    static std::wstring WidenLabel(const std::string& label);
 };
 
 } // namespace Helium
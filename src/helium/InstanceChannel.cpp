@@ -0,0 +1,132 @@
+// InstanceChannel.cpp — Single-instance handoff (architecture doc §6.3)
+
+#include "InstanceChannel.h"
+
+namespace Helium {
+
+// Local\ = this logon session: another user on the machine gets their own
+static const wchar_t* kMutexName = L"Local\\HeliumTransformaReader.Instance";
+static const wchar_t* kWindowClass = L"HeliumTransformaInstance";
+
+static const ULONG_PTR kOpenPdf = 0x48454C31;       // "HEL1" — COPYDATASTRUCT::dwData
+static const LRESULT kAccepted = 1;
+static const DWORD kMaxPathChars = 32767;           // Longest \\?\ path
+
+// Posted to ourselves so the sender's SendMessage returns before the open
+static const UINT WM_HELIUM_OPEN_PENDING = WM_APP + 0x4846;
+
+InstanceChannel::InstanceChannel() {}
+
+InstanceChannel::~InstanceChannel() {
+    Close();
+}
+
+bool InstanceChannel::Claim() {
+    if (m_hMutex) return true;
+
+    HANDLE hMutex = CreateMutexW(nullptr, FALSE, kMutexName);
+    if (!hMutex) return true;   // Can't tell — run as if first
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(hMutex);
+        return false;
+    }
+    m_hMutex = hMutex;
+    return true;
+}
+
+bool InstanceChannel::Forward(const std::wstring& pdfPath, DWORD timeoutMs) {
+    if (pdfPath.size() > kMaxPathChars) return false;
+
+    COPYDATASTRUCT cds;
+    cds.dwData = kOpenPdf;
+    cds.cbData = (DWORD)(pdfPath.size() * sizeof(wchar_t));
+    cds.lpData = (void*)pdfPath.data();
+
+    // The running instance may have claimed the mutex but not yet created
+    // its window — poll for it briefly
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    for (;;) {
+        HWND hwnd = FindWindowExW(HWND_MESSAGE, nullptr, kWindowClass, nullptr);
+        ULONGLONG now = GetTickCount64();
+        if (hwnd) {
+            // Let it bring its window to the front — we own the foreground
+            DWORD pid = 0;
+            GetWindowThreadProcessId(hwnd, &pid);
+            AllowSetForegroundWindow(pid);
+
+            DWORD_PTR reply = 0;
+            DWORD remaining = now < deadline ? (DWORD)(deadline - now) : 1;
+            return SendMessageTimeoutW(hwnd, WM_COPYDATA, 0, (LPARAM)&cds,
+                                       SMTO_ABORTIFHUNG | SMTO_BLOCK, remaining, &reply) &&
+                   reply == kAccepted;
+        }
+        if (now >= deadline) return false;
+        Sleep(20);
+    }
+}
+
+bool InstanceChannel::Listen(OpenCallback onOpen) {
+    if (m_hwnd) return true;
+    m_onOpen = std::move(onOpen);
+
+    WNDCLASSW wc = {};
+    wc.lpfnWndProc = &InstanceChannel::WindowProc;
+    wc.hInstance = GetModuleHandle(nullptr);
+    wc.lpszClassName = kWindowClass;
+    RegisterClassW(&wc);
+
+    // Message-only: never shown, never enumerated as a top-level window
+    m_hwnd = CreateWindowExW(0, kWindowClass, nullptr, 0, 0, 0, 0, 0,
+                             HWND_MESSAGE, nullptr, GetModuleHandle(nullptr), nullptr);
+    if (!m_hwnd) return false;
+    SetWindowLongPtrW(m_hwnd, GWLP_USERDATA, (LONG_PTR)this);
+    return true;
+}
+
+void InstanceChannel::Close() {
+    if (m_hwnd) {
+        SetWindowLongPtrW(m_hwnd, GWLP_USERDATA, 0);
+        DestroyWindow(m_hwnd);
+        m_hwnd = nullptr;
+    }
+    if (m_hMutex) {
+        CloseHandle(m_hMutex);
+        m_hMutex = nullptr;
+    }
+}
+
+LRESULT CALLBACK InstanceChannel::WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    auto self = (InstanceChannel*)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+
+    switch (msg) {
+        case WM_COPYDATA: {
+            auto cds = (const COPYDATASTRUCT*)lParam;
+            if (!self || !cds || cds->dwData != kOpenPdf || cds->cbData % sizeof(wchar_t) != 0 ||
+                cds->cbData > kMaxPathChars * sizeof(wchar_t)) {
+                return 0;
+            }
+
+            // The data is only valid during this call; copy it and open
+            // after replying, so the sender can exit right away
+            auto path = new std::wstring((const wchar_t*)cds->lpData, cds->cbData / sizeof(wchar_t));
+            if (!PostMessageW(hwnd, WM_HELIUM_OPEN_PENDING, 0, (LPARAM)path)) {
+                delete path;
+                return 0;
+            }
+            return kAccepted;
+        }
+
+        case WM_HELIUM_OPEN_PENDING: {
+            auto path = (std::wstring*)lParam;
+            if (self && self->m_onOpen) {
+                self->m_onOpen(*path);
+            }
+            delete path;
+            return 0;
+        }
+    }
+
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+} // namespace Helium
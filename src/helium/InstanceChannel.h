@@ -0,0 +1,48 @@
+// InstanceChannel.h — Single-instance handoff (architecture doc §6.3)
+// The first Transforma in a logon session claims a named mutex and listens
+// on a message-only window. A later launch finds that window, hands over
+// its PDF path with WM_COPYDATA and exits — the warm instance opens it as a
+// tab with its cache, session and router already loaded.
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <functional>
+
+namespace Helium {
+
+class InstanceChannel {
+public:
+    // Runs on the listening (UI) thread, from its message loop
+    using OpenCallback = std::function<void(const std::wstring& pdfPath)>;
+
+    InstanceChannel();
+    ~InstanceChannel();
+
+    InstanceChannel(const InstanceChannel&) = delete;
+    InstanceChannel& operator=(const InstanceChannel&) = delete;
+
+    // Claim the single-instance mutex. False if another instance holds it.
+    bool Claim();
+
+    // Hand pdfPath (may be empty: just activate) to the running instance.
+    // Waits up to timeoutMs for it to start listening; false if it never
+    // does or doesn't answer, and this process should start normally.
+    static bool Forward(const std::wstring& pdfPath, DWORD timeoutMs);
+
+    // Accept forwarded paths. Call on the UI thread, after Claim() succeeded.
+    bool Listen(OpenCallback onOpen);
+
+    // Stop listening and release the mutex
+    void Close();
+
+private:
+    HANDLE m_hMutex = nullptr;
+    HWND m_hwnd = nullptr;
+    OpenCallback m_onOpen;
+
+    static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+};
+
+} // namespace Helium
@@ -0,0 +1,162 @@
+// InvoiceFields.cpp — Invoice metadata read from page 1's text
+
+#include "InvoiceFields.h"
+#include "PdfText.h"
+
+namespace Helium {
+
+// Most specific first; for each label the last occurrence with a usable
+// value wins (totals sit at the bottom, after line items)
+static const char* kTinLabels[] = {
+    "TAX IDENTIFICATION NUMBER", "TAX IDENTIFICATION NO", "TAX ID", "TIN",
+};
+static const char* kInvoiceNumberLabels[] = {
+    "INVOICE NUMBER", "INVOICE NO", "INVOICE #", "INVOICE REF", "INV NO", "INV #",
+};
+static const char* kTotalLabels[] = {
+    "GRAND TOTAL", "TOTAL AMOUNT DUE", "TOTAL AMOUNT", "AMOUNT DUE", "TOTAL DUE", "BALANCE DUE", "TOTAL",
+};
+
+// Currency written before an amount
+static const char* kCurrencyMarks[] = { "NGN", "USD", "\xE2\x82\xA6", "N", "$" };
+
+static const size_t kMaxValueChars = 40;
+
+static bool IsAlnum(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static bool IsLetter(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static char Upper(char c) {
+    return c >= 'a' && c <= 'z' ? (char)(c - 'a' + 'A') : c;
+}
+
+// Label at i, as a whole word
+static bool LabelAt(std::string_view text, size_t i, std::string_view label) {
+    if (i + label.size() > text.size() || (i > 0 && IsAlnum(text[i - 1]))) return false;
+    for (size_t k = 0; k < label.size(); k++) {
+        if (Upper(text[i + k]) != label[k]) return false;
+    }
+    size_t end = i + label.size();
+    return end == text.size() || !IsAlnum(text[end]) || !IsAlnum(label.back());
+}
+
+// Past spaces, line breaks and label punctuation ("TIN: ", "Invoice No.#")
+static size_t SkipSeparators(std::string_view text, size_t i) {
+    while (i < text.size()) {
+        char c = text[i];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != ':' && c != '.' &&
+            c != '#' && c != '-' && c != '=' && c != '(' && c != ')') {
+            break;
+        }
+        i++;
+    }
+    return i;
+}
+
+// Past a currency mark, which may touch the amount ("N1,250.00")
+static size_t SkipCurrency(std::string_view text, size_t i) {
+    for (const char* mark : kCurrencyMarks) {
+        std::string_view m(mark);
+        if (i + m.size() > text.size()) continue;
+        size_t k = 0;
+        while (k < m.size() && Upper(text[i + k]) == m[k]) k++;
+        if (k == m.size() && (i + k == text.size() || !IsLetter(text[i + k]))) {
+            return SkipSeparators(text, i + k);
+        }
+    }
+    return i;
+}
+
+static std::string ReadTin(std::string_view text, size_t i) {
+    std::string value;
+    size_t digits = 0;
+    for (; i < text.size() && value.size() < kMaxValueChars; i++) {
+        char c = text[i];
+        if (IsDigit(c)) {
+            digits++;
+        } else if (c != '-') {
+            break;
+        }
+        value += c;
+    }
+    while (!value.empty() && value.back() == '-') value.pop_back();
+    return digits >= 8 ? value : std::string();
+}
+
+static std::string ReadInvoiceNumber(std::string_view text, size_t i) {
+    std::string value;
+    bool digit = false;
+    for (; i < text.size() && value.size() < kMaxValueChars; i++) {
+        char c = text[i];
+        if (!IsAlnum(c) && c != '-' && c != '/' && c != '_') break;
+        digit |= IsDigit(c);
+        value += c;
+    }
+    while (!value.empty() && (value.back() == '-' || value.back() == '/')) value.pop_back();
+    return digit ? value : std::string();
+}
+
+static std::string ReadAmount(std::string_view text, size_t i) {
+    i = SkipCurrency(text, i);
+    std::string value;
+    bool decimals = false;
+    for (; i < text.size() && value.size() < kMaxValueChars; i++) {
+        char c = text[i];
+        if (IsDigit(c)) {
+            value += c;
+        } else if (c == ',' && !decimals && i + 1 < text.size() && IsDigit(text[i + 1])) {
+            // Thousands grouping
+        } else if (c == '.' && !decimals && i + 1 < text.size() && IsDigit(text[i + 1]) && !value.empty()) {
+            decimals = true;
+            value += c;
+        } else {
+            break;
+        }
+    }
+    return value;
+}
+
+template <size_t N>
+static std::string FindField(std::string_view text, const char* (&labels)[N],
+                             std::string (*read)(std::string_view, size_t)) {
+    for (const char* label : labels) {
+        std::string_view l(label);
+        std::string found;
+        for (size_t i = 0; i + l.size() <= text.size(); i++) {
+            if (Upper(text[i]) != l[0] || !LabelAt(text, i, l)) continue;
+            std::string value = read(text, SkipSeparators(text, i + l.size()));
+            if (!value.empty()) {
+                found = value;
+            }
+        }
+        if (!found.empty()) return found;
+    }
+    return std::string();
+}
+
+void InvoiceFields::Parse(std::string_view text) {
+    if (tin.empty()) tin = FindField(text, kTinLabels, ReadTin);
+    if (invoiceNumber.empty()) invoiceNumber = FindField(text, kInvoiceNumberLabels, ReadInvoiceNumber);
+    if (totalAmount.empty()) totalAmount = FindField(text, kTotalLabels, ReadAmount);
+}
+
+bool InvoiceFields::Extract(const std::wstring& pdfPath, InvoiceFields& fields) {
+    std::string text;
+    bool readable = PdfText::ScanFirstPage(pdfPath, kScanChars, [&](std::string_view chunk) {
+        text.append(chunk.data(), chunk.size());
+        return true;
+    });
+    fields.scanned = true;
+    fields.Parse(text);
+    return readable;
+}
+
+} // namespace Helium
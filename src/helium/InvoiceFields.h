@@ -0,0 +1,33 @@
+// InvoiceFields.h — Invoice metadata read from page 1's text
+// TIN, invoice number and total, taken from the same text the router scans,
+// and sent with the submission so Relay and Core can skip re-parsing the PDF.
+// Best effort: a field that isn't found is left empty and Core reads it itself.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace Helium {
+
+struct InvoiceFields {
+    std::string tin;                // Digits and dashes, e.g. "12345678-0001"
+    std::string invoiceNumber;
+    std::string totalAmount;        // Digits with '.' decimals, no grouping or currency
+    bool scanned = false;           // Page text was examined, found or not
+
+    bool Complete() const { return !tin.empty() && !invoiceNumber.empty() && !totalAmount.empty(); }
+
+    // Fill in the fields still empty from text (labels matched
+    // case-insensitively; all of text is searched again on each call)
+    void Parse(std::string_view text);
+
+    // Scan page 1 of pdfPath; fields.scanned is set even if none are found.
+    // False if the document can't be opened.
+    static bool Extract(const std::wstring& pdfPath, InvoiceFields& fields);
+
+    // Page text considered — the router's content scan window
+    static const int kScanChars = 4096;
+};
+
+} // namespace Helium
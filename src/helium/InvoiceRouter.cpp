@@ -1,9 +1,16 @@
 // InvoiceRouter.cpp — Two-tier intelligent PDF routing
 
 #include "InvoiceRouter.h"
+#include "Json.h"
+#include "MarkerScanner.h"
+#include "PdfText.h"
+#include "ContentHash.h"
+#include "LatencyStats.h"
+#include "StringUtil.h"
 #include <algorithm>
 #include <fstream>
-#include <cctype>
+#include <sstream>
+#include <cstring>
 
 namespace Helium {
 
@@ -11,148 +18,253 @@ InvoiceRouter::InvoiceRouter() {
     InitDefaultPatterns();
 }
 
+InvoiceRouter::~InvoiceRouter() {
+    m_configWatcher.Stop();
+}
+
 void InvoiceRouter::InitDefaultPatterns() {
-    m_patterns.clear();
+    // Compiled lazily (or mapped from the pattern pack), not here
+    m_defaultPatterns.clear();
 
     // GTBank invoice patterns
-    m_patterns.push_back({
+    m_defaultPatterns.push_back({
         "GTBank",
-        std::regex(R"(GT[_\-\s]?(Bank|B).*inv)", std::regex_constants::icase),
+        R"(GT[_\-\s]?(Bank|B).*inv)",
         "GTBank invoice filenames"
     });
 
     // MTN invoice patterns
-    m_patterns.push_back({
+    m_defaultPatterns.push_back({
         "MTN",
-        std::regex(R"(MTN.*(?:invoice|bill|statement))", std::regex_constants::icase),
+        R"(MTN.*(?:invoice|bill|statement))",
         "MTN billing documents"
     });
 
     // Airtel invoice patterns
-    m_patterns.push_back({
+    m_defaultPatterns.push_back({
         "Airtel",
-        std::regex(R"(Airtel.*(?:invoice|bill|statement))", std::regex_constants::icase),
+        R"(Airtel.*(?:invoice|bill|statement))",
         "Airtel billing documents"
     });
 
     // ExecuJet patterns (e.g., WN42752.pdf)
-    m_patterns.push_back({
+    m_defaultPatterns.push_back({
         "ExecuJet",
-        std::regex(R"(WN\d{4,6}\.pdf)", std::regex_constants::icase),
+        R"(WN\d{4,6}\.pdf)",
         "ExecuJet work order / invoice"
     });
 
     // Generic invoice filename patterns
-    m_patterns.push_back({
+    m_defaultPatterns.push_back({
         "Generic",
-        std::regex(R"((?:INV|INVOICE|BILL|RECEIPT|TAX[_\-\s]?INV)[\-_\s]?\d)", std::regex_constants::icase),
+        R"((?:INV|INVOICE|BILL|RECEIPT|TAX[_\-\s]?INV)[\-_\s]?\d)",
         "Generic invoice filenames"
     });
 
     // FIRS-related documents
-    m_patterns.push_back({
+    m_defaultPatterns.push_back({
         "FIRS",
-        std::regex(R"((?:FIRS|TIN|VAT)[\-_\s])", std::regex_constants::icase),
+        R"((?:FIRS|TIN|VAT)[\-_\s])",
         "FIRS / tax-related documents"
     });
+
 }
 
-RouteResult InvoiceRouter::Route(const std::wstring& pdfPath) {
-    // Extract filename from path
-    std::string filename = WideToUtf8(pdfPath);
-    size_t lastSlash = filename.find_last_of("\\/");
-    if (lastSlash != std::string::npos) {
-        filename = filename.substr(lastSlash + 1);
+// Same inputs as the pack stamp: a new JSON or new built-ins is a new version
+static uint64_t PatternVersion(const PackHeader& stamp) {
+    ContentHasher hasher;
+    hasher.Update(&stamp.sourceSize, sizeof(stamp.sourceSize));
+    hasher.Update(&stamp.sourceWriteTime, sizeof(stamp.sourceWriteTime));
+    hasher.Update(&stamp.defaultsHash, sizeof(stamp.defaultsHash));
+    return hasher.Final();
+}
+
+std::shared_ptr<const PatternSet> InvoiceRouter::CurrentPatterns() {
+    std::shared_ptr<const PatternSet> set = m_patternSet.Load();
+    if (set) {
+        return set;
+    }
+
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+    set = m_patternSet.Load();
+    if (!set) {
+        PackHeader stamp;
+        stamp.defaultsHash = HashDefaults();
+        std::shared_ptr<PatternSet> built = CompilePatterns(m_defaultPatterns);
+        built->version = PatternVersion(stamp);
+        m_patternSet.Publish(built);
+        set = built;
+    }
+    return set;
+}
+
+std::shared_ptr<PatternSet> InvoiceRouter::CompilePatterns(std::vector<RoutingPattern> patterns) {
+    auto set = std::make_shared<PatternSet>();
+    set->patterns = std::move(patterns);
+
+    std::vector<std::string> sources;
+    sources.reserve(set->patterns.size());
+    for (const auto& pattern : set->patterns) {
+        sources.push_back(pattern.pattern);
+    }
+
+    set->matcher.Build(sources, set->fallbackPatterns);
+    CompileFallbacks(*set);
+    return set;
+}
+
+void InvoiceRouter::CompileFallbacks(PatternSet& set) {
+    // Anything outside the DFA subset (lookaround, \b, backreferences)
+    // still works, just at std::regex speed
+    for (size_t i : set.fallbackPatterns) {
+        try {
+            set.patterns[i].fallbackRegex = std::make_shared<std::regex>(
+                set.patterns[i].pattern, std::regex_constants::icase);
+        } catch (const std::regex_error&) {
+            set.patterns[i].fallbackRegex.reset();  // Invalid pattern never matches
+        }
     }
+}
 
-    // Tier 1: Filename regex (instant — 0.0001s)
+RouteResult InvoiceRouter::Route(const std::wstring& pdfPath) {
+    return Route(pdfPath, Utf8Filename(pdfPath));
+}
+
+RouteResult InvoiceRouter::Route(const std::wstring& pdfPath, std::string_view filename) {
+    ScopedLatency timer(LatencyStage::Route);
+
+    // Tier 1: Filename patterns (instant — 0.0001s)
     RouteResult result = MatchFilename(filename);
     if (result.decision == RouteDecision::Invoice) {
         return result;
     }
 
+    // Reopened file: its Tier-2 decision is still good while neither the
+    // file nor the patterns changed — one metadata query, no reads
+    uint64_t patternVersion = CurrentPatterns()->version;
+    RouteCache::FileKey key;
+    bool keyed = m_routeCache.IsOpen() && RouteCache::MakeKey(pdfPath, key);
+    if (keyed && m_routeCache.Lookup(key, patternVersion, result)) {
+        return result;
+    }
+
     // Tier 2: Content analysis (0.1s max)
     result = AnalyzeContent(pdfPath);
+
+    // Unknown is often transient (file locked or still copying) — retry next time
+    if (keyed && result.decision != RouteDecision::Unknown) {
+        m_routeCache.Store(key, patternVersion, result);
+    }
     return result;
 }
 
-RouteResult InvoiceRouter::MatchFilename(const std::string& filename) {
+bool InvoiceRouter::RouteFast(const std::wstring& pdfPath, RouteResult& result) {
+    result = MatchFilename(Utf8Filename(pdfPath));
+    if (result.decision == RouteDecision::Invoice) {
+        return true;
+    }
+
+    RouteCache::FileKey key;
+    return m_routeCache.IsOpen() && RouteCache::MakeKey(pdfPath, key) &&
+           m_routeCache.Lookup(key, CurrentPatterns()->version, result);
+}
+
+RouteResult InvoiceRouter::MatchFilename(std::string_view filename) {
+    ScopedLatency timer(LatencyStage::MatchFilename);
     RouteResult result;
     result.decision = RouteDecision::Unknown;
     result.confidenceScore = 0.0;
 
-    for (const auto& pattern : m_patterns) {
-        if (std::regex_search(filename, pattern.filenameRegex)) {
-            result.decision = RouteDecision::Invoice;
-            result.matchedPattern = pattern.description;
-            result.clientHint = pattern.name;
-            result.confidenceScore = 0.95;
-            return result;
+    // Holding the set keeps it (and a mapped pack) alive across a reload
+    std::shared_ptr<const PatternSet> set = CurrentPatterns();
+
+    // One pass over the filename for all compiled patterns
+    int matched = set->matcher.Match(filename);
+
+    // Patterns listed before the DFA hit still take precedence
+    for (size_t i : set->fallbackPatterns) {
+        if (matched >= 0 && (int)i > matched) break;
+        const auto& regex = set->patterns[i].fallbackRegex;
+        if (regex && std::regex_search(filename.begin(), filename.end(), *regex)) {
+            matched = (int)i;
+            break;
         }
     }
 
+    if (matched >= 0) {
+        const RoutingPattern& pattern = set->patterns[matched];
+        result.decision = RouteDecision::Invoice;
+        result.matchedPattern = pattern.description;
+        result.clientHint = pattern.name;
+        result.confidenceScore = 0.95;
+    }
+
     return result;
 }
 
+// Marker score at which a document counts as an invoice
+static const double kInvoiceScore = 0.30;
+
+// New text between invoice-field parses once the decision is made
+static const size_t kFieldParseChars = 512;
+
+// Invoice markers — weighted scoring
+static const ContentMarker kContentMarkers[] = {
+    {"TAX INVOICE",    0.40},
+    {"INVOICE",        0.25},
+    {"BILL TO",        0.20},
+    {"SHIP TO",        0.15},
+    {"TIN:",           0.30},
+    {"VAT:",           0.20},
+    {"TOTAL AMOUNT",   0.15},
+    {"SUBTOTAL",       0.15},
+    {"DUE DATE",       0.15},
+    {"INVOICE NO",     0.30},
+    {"INVOICE NUMBER", 0.30},
+    {"INV NO",         0.25},
+    {"PURCHASE ORDER", 0.20},
+    {"ACCOUNT NO",     0.10},
+    {"FIRS",           0.25},
+};
+
 RouteResult InvoiceRouter::AnalyzeContent(const std::wstring& pdfPath) {
+    ScopedLatency timer(LatencyStage::AnalyzeContent);
     RouteResult result;
     result.decision = RouteDecision::Unknown;
     result.confidenceScore = 0.0;
 
-    std::string text = ExtractFirstPageText(pdfPath, 500);
-    if (text.empty()) {
-        // Can't read content — treat as unknown, open in our viewer
+    // Page text streams through the scanner as MuPDF interprets it; once the
+    // score settles the question, the rest of the page is only run for the
+    // invoice fields still missing (re-parsed every kFieldParseChars)
+    static const MarkerScanner scanner(kContentMarkers, sizeof(kContentMarkers) / sizeof(kContentMarkers[0]));
+    MarkerScanner::State scan;
+    std::string text;
+    size_t parsedAt = 0;
+    bool readable = PdfText::ScanFirstPage(pdfPath, kContentScanChars, [&](std::string_view chunk) {
+        scanner.Feed(scan, chunk);
+        text.append(chunk.data(), chunk.size());
+        if (scanner.Score(scan) < kInvoiceScore) return true;
+        if (text.size() - parsedAt < kFieldParseChars) return true;
+        parsedAt = text.size();
+        result.fields.Parse(text);
+        return !result.fields.Complete();
+    });
+    size_t scanned = text.size();
+    if (!readable || scanned == 0) {
+        // Can't read content (or image-only page) — treat as unknown, open in our viewer
         result.decision = RouteDecision::Unknown;
         return result;
     }
 
-    // Convert to uppercase for matching
-    std::string upper = text;
-    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
-
-    // Invoice markers — weighted scoring
-    struct Marker {
-        const char* text;
-        double weight;
-    };
-
-    static const Marker markers[] = {
-        {"TAX INVOICE",    0.40},
-        {"INVOICE",        0.25},
-        {"BILL TO",        0.20},
-        {"SHIP TO",        0.15},
-        {"TIN:",           0.30},
-        {"VAT:",           0.20},
-        {"TOTAL AMOUNT",   0.15},
-        {"SUBTOTAL",       0.15},
-        {"DUE DATE",       0.15},
-        {"INVOICE NO",     0.30},
-        {"INVOICE NUMBER", 0.30},
-        {"INV NO",         0.25},
-        {"PURCHASE ORDER", 0.20},
-        {"ACCOUNT NO",     0.10},
-        {"FIRS",           0.25},
-    };
-
-    double score = 0.0;
-    std::string bestMatch;
-
-    for (const auto& m : markers) {
-        if (upper.find(m.text) != std::string::npos) {
-            score += m.weight;
-            if (bestMatch.empty()) {
-                bestMatch = m.text;
-            }
-        }
-    }
-
-    // Clamp to 1.0
-    if (score > 1.0) score = 1.0;
+    double score = scanner.Score(scan);
+    const char* bestMatch = scanner.FirstFound(scan);
 
-    if (score >= 0.30) {
+    if (score >= kInvoiceScore) {
         result.decision = RouteDecision::Invoice;
-        result.matchedPattern = "Content analysis: " + bestMatch;
+        result.matchedPattern = std::string("Content analysis: ") + bestMatch;
         result.confidenceScore = score;
+        if (parsedAt != scanned) result.fields.Parse(text);
+        result.fields.scanned = true;
     } else {
         result.decision = RouteDecision::NotInvoice;
         result.confidenceScore = 1.0 - score;
@@ -161,105 +273,238 @@ RouteResult InvoiceRouter::AnalyzeContent(const std::wstring& pdfPath) {
     return result;
 }
 
-std::string InvoiceRouter::ExtractFirstPageText(const std::wstring& pdfPath, int maxChars) {
-    // NOTE: In the actual SumatraPDF fork, this will use MuPDF's fz_new_stext_page()
-    // to extract text from page 1. MuPDF is already compiled into SumatraPDF.
-    //
-    // For now, this is a placeholder that reads raw bytes looking for text streams.
-    // The real implementation will be wired during the Sumatra fork integration.
-    //
-    // MuPDF integration:
-    //   fz_context* ctx = fz_new_context(NULL, NULL, FZ_STORE_DEFAULT);
-    //   fz_document* doc = fz_open_document(ctx, path);
-    //   fz_page* page = fz_load_page(ctx, doc, 0);
-    //   fz_stext_page* stext = fz_new_stext_page_from_page(ctx, page, NULL);
-    //   // Walk stext blocks → lines → chars to build string
-
-    // Placeholder: look for ASCII text in the PDF binary
-    std::ifstream file(pdfPath, std::ios::binary);
-    if (!file.is_open()) return "";
-
-    // Read first 8KB — enough to find text in most invoices
-    std::vector<char> buffer(8192);
-    file.read(buffer.data(), buffer.size());
-    auto bytesRead = file.gcount();
-    file.close();
+bool InvoiceRouter::LoadPatterns(const std::wstring& configPath, bool watch) {
+    {
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_configPath = configPath;
+    }
+    bool loaded = ReloadPatterns();
 
-    // Extract printable ASCII runs (crude but functional for spike)
-    std::string text;
-    std::string run;
-    for (int i = 0; i < bytesRead && (int)text.size() < maxChars; i++) {
-        char c = buffer[i];
-        if (c >= 32 && c < 127) {
-            run += c;
-        } else {
-            if (run.size() >= 4) {
-                text += run + " ";
-            }
-            run.clear();
-        }
+    // Deployment tools rewrite the config in place; pick edits up live
+    if (watch && !m_configWatcher.IsRunning()) {
+        m_configWatcher.Start(configPath, [this] { ReloadPatterns(); });
     }
-    if (run.size() >= 4) {
-        text += run;
+    return loaded;
+}
+
+bool InvoiceRouter::OpenRouteCache(const std::wstring& cachePath) {
+    return m_routeCache.Open(cachePath);
+}
+
+bool InvoiceRouter::ReloadPatterns() {
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+
+    PackHeader stamp;
+    stamp.defaultsHash = HashDefaults();
+    WIN32_FILE_ATTRIBUTE_DATA attrs;
+    if (GetFileAttributesExW(m_configPath.c_str(), GetFileExInfoStandard, &attrs)) {
+        stamp.sourceSize = ((uint64_t)attrs.nFileSizeHigh << 32) | attrs.nFileSizeLow;
+        stamp.sourceWriteTime = ((uint64_t)attrs.ftLastWriteTime.dwHighDateTime << 32) |
+                                attrs.ftLastWriteTime.dwLowDateTime;
+    }
+
+    std::wstring packPath = m_configPath;
+    size_t dot = packPath.find_last_of(L'.');
+    size_t slash = packPath.find_last_of(L"\\/");
+    if (dot != std::wstring::npos && (slash == std::wstring::npos || dot > slash)) {
+        packPath.resize(dot);
+    }
+    packPath += L".pack";
+
+    // Fast path: the pack still matches the JSON — map it, nothing to compile
+    std::shared_ptr<PatternSet> set = LoadPack(packPath, stamp);
+    if (set) {
+        set->version = PatternVersion(stamp);
+        m_patternSet.Publish(std::move(set));
+        return true;
     }
 
-    if ((int)text.size() > maxChars) {
-        text.resize(maxChars);
+    std::vector<RoutingPattern> patterns;
+    if (stamp.sourceSize > 0) {
+        std::ifstream file(m_configPath, std::ios::binary);
+        std::ostringstream json;
+        json << file.rdbuf();
+        if (!file.is_open() || !ParseConfig(json.str(), patterns)) {
+            // Half-written or invalid edit — keep routing with the current set
+            return false;
+        }
     }
 
-    return text;
+    // Client-specific patterns first, so their hints win over "Generic"
+    patterns.insert(patterns.end(), m_defaultPatterns.begin(), m_defaultPatterns.end());
+    set = CompilePatterns(std::move(patterns));
+    set->version = PatternVersion(stamp);
+
+    WritePack(packPath, stamp, *set);
+    m_patternSet.Publish(std::move(set));
+    return true;
 }
 
-bool InvoiceRouter::LoadPatterns(const std::wstring& configPath) {
-    // Load routing-patterns.json for custom client patterns
-    // Format: [{"name": "ClientX", "pattern": "CLX.*inv", "description": "ClientX invoices"}]
-    // TODO: Implement JSON parsing when we add custom patterns
+bool InvoiceRouter::ParseConfig(const std::string& json, std::vector<RoutingPattern>& patterns) {
+    JsonValue root;
+    if (!JsonValue::Parse(json, root)) {
+        return false;
+    }
+
+    // [{"name": "ClientX", "pattern": "CLX.*inv", "description": "ClientX invoices"}]
+    auto addList = [&](const JsonValue& list) {
+        for (const JsonValue& item : list.items) {
+            if (!item.IsObject() || !item.GetBool("enabled", true)) continue;
+            std::string pattern = item.GetString("pattern");
+            if (pattern.empty()) continue;
+            std::string name = item.GetString("name", "Custom");
+            patterns.push_back({name, pattern, item.GetString("description", name + " invoice filenames")});
+        }
+    };
+
+    if (root.IsArray()) {
+        addList(root);
+        return true;
+    }
+    if (!root.IsObject()) {
+        return false;
+    }
+
+    // {"clients": {"gtbank": {"patterns": ["GTB_\\d{6}_INV"], "enabled": true}}}
+    if (const JsonValue* clients = root.Find("clients")) {
+        for (const auto& client : clients->members) {
+            const JsonValue& entry = client.second;
+            const JsonValue* list = entry.Find("patterns");
+            if (!list || !list->IsArray() || !entry.GetBool("enabled", true)) continue;
+
+            std::string name = entry.GetString("name", client.first);
+            std::string description = entry.GetString("description", name + " invoice filenames");
+            for (const JsonValue& pattern : list->items) {
+                if (pattern.IsString() && !pattern.string.empty()) {
+                    patterns.push_back({name, pattern.string, description});
+                }
+            }
+        }
+    }
+    if (const JsonValue* list = root.Find("patterns")) {
+        if (list->IsArray()) addList(*list);
+    }
     return true;
 }
 
-std::wstring InvoiceRouter::GetFallbackHandler() {
-    // Query registry for the user's original PDF handler
-    // HKEY_CURRENT_USER\Software\Microsoft\Windows\CurrentVersion\Explorer\FileExts\.pdf\UserChoice
-    HKEY hKey;
-    LONG result = RegOpenKeyExW(
-        HKEY_CURRENT_USER,
-        L"Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\FileExts\\.pdf\\UserChoice",
-        0, KEY_READ, &hKey
-    );
-
-    if (result != ERROR_SUCCESS) {
-        return L""; // No override set — use system default
+std::shared_ptr<PatternSet> InvoiceRouter::LoadPack(const std::wstring& packPath, const PackHeader& stamp) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(packPath) || file->Size() < sizeof(PackHeader)) {
+        return nullptr;
     }
 
-    wchar_t progId[256];
-    DWORD size = sizeof(progId);
-    result = RegQueryValueExW(hKey, L"ProgId", nullptr, nullptr, (BYTE*)progId, &size);
-    RegCloseKey(hKey);
+    const uint8_t* data = file->Data();
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(data);
+    uint64_t patternsEnd = sizeof(PackHeader) + (uint64_t)header->patternCount * sizeof(PackPattern);
+    if (header->magic != stamp.magic || header->version != stamp.version ||
+        header->sourceSize != stamp.sourceSize || header->sourceWriteTime != stamp.sourceWriteTime ||
+        header->defaultsHash != stamp.defaultsHash ||
+        file->Size() != patternsEnd + header->matcherBytes + header->stringBytes) {
+        return nullptr;
+    }
 
-    if (result != ERROR_SUCCESS) {
-        return L"";
+    auto set = std::make_shared<PatternSet>();
+    if (!set->matcher.Attach(data + patternsEnd, header->matcherBytes)) {
+        return nullptr;
     }
 
-    return progId;
+    const PackPattern* entries = reinterpret_cast<const PackPattern*>(data + sizeof(PackHeader));
+    const char* strings = reinterpret_cast<const char*>(data + patternsEnd + header->matcherBytes);
+    auto str = [&](uint32_t offset, uint32_t length, std::string& out) {
+        if ((uint64_t)offset + length > header->stringBytes) return false;
+        out.assign(strings + offset, length);
+        return true;
+    };
+
+    set->patterns.resize(header->patternCount);
+    for (uint32_t i = 0; i < header->patternCount; i++) {
+        const PackPattern& e = entries[i];
+        RoutingPattern& pattern = set->patterns[i];
+        if (!str(e.nameOffset, e.nameLength, pattern.name) ||
+            !str(e.patternOffset, e.patternLength, pattern.pattern) ||
+            !str(e.descriptionOffset, e.descriptionLength, pattern.description)) {
+            return nullptr;
+        }
+        if (e.fallback) {
+            set->fallbackPatterns.push_back(i);
+        }
+    }
+
+    // std::regex can't be serialized, so the few patterns outside the DFA
+    // subset are rebuilt (cheap — the DFA is the cost)
+    CompileFallbacks(*set);
+
+    set->pack = std::move(file);
+    return set;
+}
+
+bool InvoiceRouter::WritePack(const std::wstring& packPath, const PackHeader& stamp, const PatternSet& set) {
+    PackHeader header = stamp;
+    header.patternCount = (uint32_t)set.patterns.size();
+    header.matcherBytes = (uint32_t)set.matcher.Size();
+
+    std::vector<PackPattern> entries;
+    std::string strings;
+    auto add = [&](const std::string& text, uint32_t& offset, uint32_t& length) {
+        offset = (uint32_t)strings.size();
+        length = (uint32_t)text.size();
+        strings += text;
+    };
+    for (size_t i = 0; i < set.patterns.size(); i++) {
+        const RoutingPattern& pattern = set.patterns[i];
+        PackPattern e;
+        add(pattern.name, e.nameOffset, e.nameLength);
+        add(pattern.pattern, e.patternOffset, e.patternLength);
+        add(pattern.description, e.descriptionOffset, e.descriptionLength);
+        e.fallback = std::binary_search(set.fallbackPatterns.begin(), set.fallbackPatterns.end(), i) ? 1 : 0;
+        entries.push_back(e);
+    }
+    header.stringBytes = (uint32_t)strings.size();
+
+    // Temp file + swap: a running reader may have the old pack mapped
+    std::wstring tempPath = packPath + L".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackPattern));
+    file.write(reinterpret_cast<const char*>(set.matcher.Data()), set.matcher.Size());
+    file.write(strings.data(), strings.size());
+    file.close();
+
+    if (file.fail() ||
+        !MoveFileExW(tempPath.c_str(), packPath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint64_t InvoiceRouter::HashDefaults() const {
+    // Stale packs from a build with different built-in patterns are ignored
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const std::string& text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xFF;  // Field separator
+        hash *= 1099511628211ULL;
+    };
+    for (const auto& pattern : m_defaultPatterns) {
+        mix(pattern.name);
+        mix(pattern.pattern);
+        mix(pattern.description);
+    }
+    return hash;
 }
 
 bool InvoiceRouter::OpenWithFallback(const std::wstring& pdfPath) {
-    // Try to open with user's previous default handler
-    // If that fails, use ShellExecute with "open" verb (system default)
-    HINSTANCE result = ShellExecuteW(
-        nullptr, L"open", pdfPath.c_str(),
-        nullptr, nullptr, SW_SHOWNORMAL
-    );
-
-    return (intptr_t)result > 32; // ShellExecute returns > 32 on success
+    return m_fallbackHandler.Open(pdfPath);
 }
 
-std::string InvoiceRouter::WideToUtf8(const std::wstring& wide) {
-    if (wide.empty()) return "";
-    int size = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), (int)wide.size(), nullptr, 0, nullptr, nullptr);
-    std::string result(size, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), (int)wide.size(), &result[0], size, nullptr, nullptr);
-    return result;
+bool InvoiceRouter::IsFallbackLaunch() {
+    return GetEnvironmentVariableW(FallbackHandler::kLaunchMarkerVar, nullptr, 0) > 0;
 }
 
 } // namespace Helium
@@ -1,12 +1,23 @@
 // InvoiceRouter.h — Two-tier intelligent PDF routing
-// Tier 1: Filename regex (0.0001s)
+// Tier 1: Filename patterns, one DFA pass (0.0001s)
 // Tier 2: Content analysis fallback (0.1s)
 
 #pragma once
 
+#include "PatternMatcher.h"
+#include "MappedFile.h"
+#include "AtomicSnapshot.h"
+#include "FileWatcher.h"
+#include "RouteCache.h"
+#include "FallbackHandler.h"
+#include "InvoiceFields.h"
+#include <windows.h>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <regex>
+#include <memory>
+#include <mutex>
 
 namespace Helium {
 
@@ -21,44 +32,121 @@ struct RouteResult {
     std::string matchedPattern;  // Which pattern matched (for diagnostics)
     std::string clientHint;      // Detected client (GTBank, MTN, etc.)
     double confidenceScore;      // 0.0 - 1.0
+    InvoiceFields fields;        // From Tier 2's text pass; not scanned otherwise
 };
 
 struct RoutingPattern {
     std::string name;            // "GTBank", "MTN", "ExecuJet", "Generic"
-    std::regex filenameRegex;
+    std::string pattern;         // ECMAScript regex, matched case-insensitively
     std::string description;
+
+    // Only built for patterns PatternMatcher cannot compile
+    std::shared_ptr<std::regex> fallbackRegex;
+};
+
+// Compiled routing patterns. Immutable once published; a config reload
+// builds a new set and swaps it in atomically.
+struct PatternSet {
+    std::vector<RoutingPattern> patterns;
+    PatternMatcher matcher;
+    std::vector<size_t> fallbackPatterns;   // Indices matched with std::regex
+    std::shared_ptr<MappedFile> pack;       // Backs the matcher tables when mapped
+    uint64_t version = 0;                   // Changes with the JSON or built-ins; keys RouteCache
+};
+
+// Pattern pack (<config>.pack): the compiled pattern set, stamped with the
+// JSON it came from, so later launches map it instead of recompiling.
+// Layout: [PackHeader][PackPattern x patternCount][matcher tables][strings]
+#pragma pack(push, 1)
+struct PackHeader {
+    uint32_t magic = 0x4B415048;     // "HPAK"
+    uint32_t version = 1;
+    uint64_t sourceSize = 0;         // routing-patterns.json size (0 = absent)
+    uint64_t sourceWriteTime = 0;    // ... and last-write FILETIME
+    uint64_t defaultsHash = 0;       // Built-in patterns this pack includes
+    uint32_t patternCount = 0;
+    uint32_t matcherBytes = 0;
+    uint32_t stringBytes = 0;
+    uint32_t reserved = 0;
+};
+
+struct PackPattern {
+    uint32_t nameOffset, nameLength;             // Into the string area
+    uint32_t patternOffset, patternLength;
+    uint32_t descriptionOffset, descriptionLength;
+    uint32_t fallback;                           // 1 = outside the DFA, use std::regex
 };
+#pragma pack(pop)
 
 class InvoiceRouter {
 public:
     InvoiceRouter();
+    ~InvoiceRouter();
 
     // Main routing decision — called when user opens a PDF
     RouteResult Route(const std::wstring& pdfPath);
 
-    // Load custom patterns from JSON config file
-    bool LoadPatterns(const std::wstring& configPath);
+    // Same, with pdfPath's filename already converted (Utf8Filename) by a
+    // caller that needs it again for the duplicate check
+    RouteResult Route(const std::wstring& pdfPath, std::string_view filename);
+
+    // Tier 1 and the route cache only: never reads the PDF or touches
+    // MuPDF. False if only content analysis could decide.
+    bool RouteFast(const std::wstring& pdfPath, RouteResult& result);
 
-    // Get the fallback PDF handler (user's original default)
-    std::wstring GetFallbackHandler();
+    // Load custom patterns from JSON config file (ahead of the built-in
+    // ones) and keep watching it; edits apply without a restart.
+    // Accepts {"clients": {name: {"patterns": [...], "enabled": bool}}}
+    // or [{"name", "pattern", "description"}].
+    // watch = false for short-lived routing (no watcher thread).
+    bool LoadPatterns(const std::wstring& configPath, bool watch = true);
 
-    // Open a PDF with the fallback handler
+    // Remember content-routing decisions across launches. Without it every
+    // open that misses Tier 1 reads the PDF again.
+    bool OpenRouteCache(const std::wstring& cachePath);
+
+    // Open a PDF with the fallback handler. False if there is none but us
+    // (or it failed to start) — the caller should open it itself.
     bool OpenWithFallback(const std::wstring& pdfPath);
 
+    // This process was started by OpenWithFallback — the fallback handler
+    // resolved to us. Open the file here rather than routing it away again.
+    static bool IsFallbackLaunch();
+
 private:
-    std::vector<RoutingPattern> m_patterns;
+    std::vector<RoutingPattern> m_defaultPatterns;
+    AtomicSnapshot<PatternSet> m_patternSet;
+
+    // Serializes (re)loads; Route() only ever reads the published set
+    std::mutex m_loadMutex;
+    std::wstring m_configPath;
+    FileWatcher m_configWatcher;
+
+    RouteCache m_routeCache;
+    FallbackHandler m_fallbackHandler;
 
     // Tier 1: Filename-based routing (instant)
-    RouteResult MatchFilename(const std::string& filename);
+    RouteResult MatchFilename(std::string_view filename);
 
-    // Tier 2: Content analysis (first 200 chars of page 1)
+    // Tier 2: Content analysis (first kContentScanChars of page 1). An
+    // invoice's pass runs on until its fields are found, within the window.
     RouteResult AnalyzeContent(const std::wstring& pdfPath);
-
-    // Extract text from first page (using MuPDF — already linked via SumatraPDF)
-    std::string ExtractFirstPageText(const std::wstring& pdfPath, int maxChars = 200);
+    static const int kContentScanChars = InvoiceFields::kScanChars;
 
     void InitDefaultPatterns();
-    static std::string WideToUtf8(const std::wstring& wide);
+
+    // Published pattern set; compiles the built-in one on first use if no
+    // config was loaded
+    std::shared_ptr<const PatternSet> CurrentPatterns();
+
+    bool ReloadPatterns();
+    static bool ParseConfig(const std::string& json, std::vector<RoutingPattern>& patterns);
+    static std::shared_ptr<PatternSet> CompilePatterns(std::vector<RoutingPattern> patterns);
+    static void CompileFallbacks(PatternSet& set);
+
+    std::shared_ptr<PatternSet> LoadPack(const std::wstring& packPath, const PackHeader& stamp);
+    static bool WritePack(const std::wstring& packPath, const PackHeader& stamp, const PatternSet& set);
+    uint64_t HashDefaults() const;
 };
 
 } // namespace Helium
@@ -0,0 +1,294 @@
+// Json.cpp — Minimal JSON reader for Helium config files
+
+#include "Json.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace Helium {
+
+// Config files are small; this only guards against runaway nesting
+static const int kMaxDepth = 64;
+
+namespace {
+
+class Reader {
+public:
+    explicit Reader(std::string_view text) : m_text(text) {}
+
+    bool ParseDocument(JsonValue& out) {
+        // Notepad saves UTF-8 with a BOM
+        if (m_text.size() >= 3 && memcmp(m_text.data(), "\xEF\xBB\xBF", 3) == 0) {
+            m_pos = 3;
+        }
+        if (!ParseValue(out, 0)) return false;
+        SkipSpace();
+        return m_pos == m_text.size();
+    }
+
+private:
+    std::string_view m_text;
+    size_t m_pos = 0;
+
+    void SkipSpace() {
+        while (m_pos < m_text.size() &&
+               (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' ||
+                m_text[m_pos] == '\n' || m_text[m_pos] == '\r')) {
+            m_pos++;
+        }
+    }
+
+    bool Consume(std::string_view word) {
+        if (m_text.substr(m_pos, word.size()) != word) return false;
+        m_pos += word.size();
+        return true;
+    }
+
+    bool ParseValue(JsonValue& out, int depth) {
+        if (depth > kMaxDepth) return false;
+        SkipSpace();
+        if (m_pos >= m_text.size()) return false;
+
+        switch (m_text[m_pos]) {
+        case '{': return ParseObject(out, depth);
+        case '[': return ParseArray(out, depth);
+        case '"':
+            out.type = JsonValue::Type::String;
+            return ParseString(out.string);
+        case 't':
+            out.type = JsonValue::Type::Bool;
+            out.boolean = true;
+            return Consume("true");
+        case 'f':
+            out.type = JsonValue::Type::Bool;
+            out.boolean = false;
+            return Consume("false");
+        case 'n':
+            out.type = JsonValue::Type::Null;
+            return Consume("null");
+        default:
+            return ParseNumber(out);
+        }
+    }
+
+    bool ParseObject(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::Object;
+        m_pos++;  // '{'
+        SkipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == '}') {
+            m_pos++;
+            return true;
+        }
+
+        for (;;) {
+            SkipSpace();
+            std::string key;
+            if (m_pos >= m_text.size() || m_text[m_pos] != '"' || !ParseString(key)) return false;
+            SkipSpace();
+            if (!Consume(":")) return false;
+
+            JsonValue value;
+            if (!ParseValue(value, depth + 1)) return false;
+            out.members.emplace_back(std::move(key), std::move(value));
+
+            SkipSpace();
+            if (Consume(",")) continue;
+            return Consume("}");
+        }
+    }
+
+    bool ParseArray(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::Array;
+        m_pos++;  // '['
+        SkipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == ']') {
+            m_pos++;
+            return true;
+        }
+
+        for (;;) {
+            JsonValue value;
+            if (!ParseValue(value, depth + 1)) return false;
+            out.items.push_back(std::move(value));
+
+            SkipSpace();
+            if (Consume(",")) continue;
+            return Consume("]");
+        }
+    }
+
+    bool ParseNumber(JsonValue& out) {
+        size_t start = m_pos;
+        while (m_pos < m_text.size() && strchr("+-0123456789.eE", m_text[m_pos])) {
+            m_pos++;
+        }
+        if (m_pos == start) return false;
+
+        std::string digits(m_text.substr(start, m_pos - start));
+        char* end = nullptr;
+        out.type = JsonValue::Type::Number;
+        out.number = strtod(digits.c_str(), &end);
+        return end == digits.c_str() + digits.size();
+    }
+
+    static int HexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool ParseHex4(uint32_t& value) {
+        if (m_pos + 4 > m_text.size()) return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            int digit = HexValue(m_text[m_pos++]);
+            if (digit < 0) return false;
+            value = (value << 4) | (uint32_t)digit;
+        }
+        return true;
+    }
+
+    static void AppendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool ParseString(std::string& out) {
+        m_pos++;  // '"'
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') return true;
+            if ((unsigned char)c < 0x20) return false;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+
+            if (m_pos >= m_text.size()) return false;
+            char e = m_text[m_pos++];
+            switch (e) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!ParseHex4(cp)) return false;
+                // Surrogate pair
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low;
+                    if (!Consume("\\u") || !ParseHex4(low) || low < 0xDC00 || low > 0xDFFF) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                AppendUtf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+const JsonValue* JsonValue::Find(std::string_view key) const {
+    for (const auto& member : members) {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+std::string JsonValue::GetString(std::string_view key, const std::string& fallback) const {
+    const JsonValue* value = Find(key);
+    return value && value->type == Type::String ? value->string : fallback;
+}
+
+bool JsonValue::GetBool(std::string_view key, bool fallback) const {
+    const JsonValue* value = Find(key);
+    return value && value->type == Type::Bool ? value->boolean : fallback;
+}
+
+bool JsonValue::Parse(std::string_view text, JsonValue& out) {
+    out = JsonValue();
+    return Reader(text).ParseDocument(out);
+}
+
+// End of the string whose opening quote is at start (the closing quote), or npos
+static size_t StringEnd(std::string_view text, size_t start) {
+    for (size_t i = start + 1; i < text.size(); i++) {
+        if (text[i] == '\\') {
+            i++;
+        } else if (text[i] == '"') {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+static size_t SkipSpaces(std::string_view text, size_t i) {
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\t' || text[i] == '\n' || text[i] == '\r')) {
+        i++;
+    }
+    return i;
+}
+
+size_t ScanJsonStrings(std::string_view text, const std::string_view* keys,
+                       std::string_view* values, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        values[k] = std::string_view();
+    }
+
+    size_t found = 0;
+    size_t i = 0;
+    while (found < count && (i = text.find('"', i)) != std::string_view::npos) {
+        size_t end = StringEnd(text, i);
+        if (end == std::string_view::npos) break;
+        std::string_view key = text.substr(i + 1, end - i - 1);
+
+        // A string followed by ':' is a key; anything else is skipped whole
+        size_t colon = SkipSpaces(text, end + 1);
+        if (colon >= text.size() || text[colon] != ':') {
+            i = end + 1;
+            continue;
+        }
+        size_t value = SkipSpaces(text, colon + 1);
+        if (value >= text.size() || text[value] != '"') {
+            i = value;
+            continue;
+        }
+        size_t valueEnd = StringEnd(text, value);
+        if (valueEnd == std::string_view::npos) break;
+
+        for (size_t k = 0; k < count; k++) {
+            if (values[k].data() == nullptr && keys[k] == key) {
+                values[k] = text.substr(value + 1, valueEnd - value - 1);
+                found++;
+                break;
+            }
+        }
+        i = valueEnd + 1;
+    }
+    return found;
+}
+
+} // namespace Helium
@@ -0,0 +1,47 @@
+// Json.h — Minimal JSON reader for Helium config files
+// Parses a whole document into a tree; object members keep file order.
+// Small known replies (session file, Relay responses) skip the tree and
+// take their string fields in one pass with ScanJsonStrings.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+
+namespace Helium {
+
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;                               // Array
+    std::vector<std::pair<std::string, JsonValue>> members;     // Object
+
+    bool IsObject() const { return type == Type::Object; }
+    bool IsArray() const { return type == Type::Array; }
+    bool IsString() const { return type == Type::String; }
+
+    // Object member by key, or nullptr
+    const JsonValue* Find(std::string_view key) const;
+
+    // Typed member lookups with a fallback for missing / mistyped values
+    std::string GetString(std::string_view key, const std::string& fallback = "") const;
+    bool GetBool(std::string_view key, bool fallback) const;
+
+    // Parse a complete document (UTF-8, optional BOM). False on syntax error.
+    static bool Parse(std::string_view text, JsonValue& out);
+};
+
+// One pass over text for the string members named in keys (count of each):
+// values[i] views the first string value of keys[i], escapes as written, or
+// is left empty. No tree, no allocation. Returns how many were found.
+size_t ScanJsonStrings(std::string_view text, const std::string_view* keys,
+                       std::string_view* values, size_t count);
+
+} // namespace Helium
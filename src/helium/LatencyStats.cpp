@@ -0,0 +1,212 @@
+// LatencyStats.cpp — Always-on latency histograms for the hot paths
+
+#include "LatencyStats.h"
+#include <atomic>
+#include <cstdio>
+
+#ifdef HELIUM_ENABLE_ETW
+#include <TraceLoggingProvider.h>
+#pragma comment(lib, "advapi32.lib")
+#endif
+
+namespace Helium {
+
+static const size_t kStages = (size_t)LatencyStage::Count;
+
+// 0-3 µs exactly, then four buckets per power of two up to ~2^40 µs
+static const size_t kOctaves = 40;
+static const size_t kBuckets = kOctaves * 4;
+
+// Appended per session; started over once it grows past this
+static const LONGLONG kMaxLogBytes = 1024 * 1024;
+
+static const char* kStageNames[kStages] = {
+    "route", "route.filename", "route.content", "route.launch",
+    "cache.load", "cache.check", "cache.save",
+    "session.load",
+    "relay.connect", "relay.send", "relay.first_byte", "relay.body",
+};
+
+// One per thread that ever records; written only by its owner. Never
+// freed — pool threads are reused, and a dump may run at any time.
+struct ThreadHistograms {
+    std::atomic<uint64_t> counts[kStages][kBuckets];
+    std::atomic<uint64_t> totalUs[kStages];
+    std::atomic<uint64_t> maxUs[kStages];
+    ThreadHistograms* next;
+};
+
+static std::atomic<ThreadHistograms*> g_threads{nullptr};
+static thread_local ThreadHistograms* t_histograms = nullptr;
+
+#ifdef HELIUM_ENABLE_ETW
+// Name-derived GUID, so "*Helium.Transforma" in WPR/xperf finds it
+TRACELOGGING_DEFINE_PROVIDER(g_etwProvider, "Helium.Transforma",
+    (0x66be6e61, 0x6f57, 0x5c89, 0x3a, 0xa3, 0xde, 0x9f, 0x18, 0x0b, 0x79, 0xbb));
+
+struct EtwRegistration {
+    EtwRegistration() { TraceLoggingRegister(g_etwProvider); }
+    ~EtwRegistration() { TraceLoggingUnregister(g_etwProvider); }
+};
+#endif
+
+static ThreadHistograms* CurrentThreadHistograms() {
+    if (!t_histograms) {
+        ThreadHistograms* block = new ThreadHistograms();  // Zeroed
+        block->next = g_threads.load(std::memory_order_relaxed);
+        while (!g_threads.compare_exchange_weak(block->next, block,
+                                                std::memory_order_release, std::memory_order_relaxed)) {}
+        t_histograms = block;
+    }
+    return t_histograms;
+}
+
+static size_t BucketOf(uint64_t us) {
+    if (us < 4) return (size_t)us;
+    size_t octave = 2;
+    while (octave + 1 < kOctaves && (us >> (octave + 1)) != 0) {
+        octave++;
+    }
+    size_t sub = (size_t)((us >> (octave - 2)) & 3);
+    size_t bucket = (octave - 1) * 4 + sub;
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+static uint64_t BucketLowerUs(size_t bucket) {
+    if (bucket < 4) return bucket;
+    size_t octave = bucket / 4 + 1;
+    return (uint64_t)(4 + bucket % 4) << (octave - 2);
+}
+
+static void Bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+    // Single writer: no locked read-modify-write needed
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+int64_t LatencyStats::Now() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+int64_t LatencyStats::RecordSince(LatencyStage stage, int64_t startTicks) {
+    static const int64_t frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f.QuadPart;
+    }();
+
+    int64_t now = Now();
+    if ((size_t)stage >= kStages || now < startTicks) return now;
+    uint64_t us = (uint64_t)(now - startTicks) * 1000000 / (uint64_t)frequency;
+
+    ThreadHistograms* block = CurrentThreadHistograms();
+    size_t s = (size_t)stage;
+    Bump(block->counts[s][BucketOf(us)], 1);
+    Bump(block->totalUs[s], us);
+    if (us > block->maxUs[s].load(std::memory_order_relaxed)) {
+        block->maxUs[s].store(us, std::memory_order_relaxed);
+    }
+
+#ifdef HELIUM_ENABLE_ETW
+    static EtwRegistration registration;
+    TraceLoggingWrite(g_etwProvider, "Latency",
+                      TraceLoggingString(kStageNames[s], "Stage"),
+                      TraceLoggingUInt64(us, "Microseconds"));
+#endif
+    return now;
+}
+
+LatencySummary LatencyStats::Summarize(LatencyStage stage) {
+    LatencySummary summary;
+    if ((size_t)stage >= kStages) return summary;
+    size_t s = (size_t)stage;
+
+    uint64_t counts[kBuckets] = {};
+    uint64_t totalUs = 0, maxUs = 0;
+    for (ThreadHistograms* block = g_threads.load(std::memory_order_acquire); block; block = block->next) {
+        for (size_t b = 0; b < kBuckets; b++) {
+            counts[b] += block->counts[s][b].load(std::memory_order_relaxed);
+        }
+        totalUs += block->totalUs[s].load(std::memory_order_relaxed);
+        uint64_t blockMax = block->maxUs[s].load(std::memory_order_relaxed);
+        if (blockMax > maxUs) maxUs = blockMax;
+    }
+
+    for (uint64_t c : counts) summary.count += c;
+    if (summary.count == 0) return summary;
+
+    // Percentiles at bucket midpoints, never past the observed maximum
+    auto percentile = [&](uint64_t rank) {
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBuckets; b++) {
+            seen += counts[b];
+            if (seen >= rank) {
+                uint64_t lower = BucketLowerUs(b);
+                uint64_t upper = b + 1 < kBuckets ? BucketLowerUs(b + 1) : lower;
+                double midUs = (double)(lower + upper) / 2.0;
+                return (midUs < (double)maxUs ? midUs : (double)maxUs) / 1000.0;
+            }
+        }
+        return (double)maxUs / 1000.0;
+    };
+
+    summary.meanMs = (double)totalUs / (double)summary.count / 1000.0;
+    summary.p50Ms = percentile((summary.count * 50 + 99) / 100);
+    summary.p90Ms = percentile((summary.count * 90 + 99) / 100);
+    summary.p99Ms = percentile((summary.count * 99 + 99) / 100);
+    summary.maxMs = (double)maxUs / 1000.0;
+    return summary;
+}
+
+bool LatencyStats::Dump(const std::wstring& logPath) {
+    size_t lastSlash = logPath.find_last_of(L"\\/");
+    if (lastSlash != std::wstring::npos) {
+        std::wstring dir = logPath.substr(0, lastSlash);
+        CreateDirectoryW(dir.substr(0, dir.find_last_of(L"\\/")).c_str(), nullptr);
+        CreateDirectoryW(dir.c_str(), nullptr);
+    }
+
+    HANDLE hFile = CreateFileW(logPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                               OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > kMaxLogBytes) {
+        SetEndOfFile(hFile);  // Still at offset 0: start over
+    } else {
+        LARGE_INTEGER zero = {};
+        SetFilePointerEx(hFile, zero, nullptr, FILE_END);
+    }
+
+    SYSTEMTIME now;
+    GetLocalTime(&now);
+    char line[160];
+    std::string text;
+    sprintf_s(line, "Helium latency %04u-%02u-%02u %02u:%02u:%02u, pid %lu\r\n",
+              now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond,
+              GetCurrentProcessId());
+    text += line;
+    sprintf_s(line, "%-18s %8s %10s %10s %10s %10s %10s\r\n",
+              "stage", "count", "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    text += line;
+    for (size_t s = 0; s < kStages; s++) {
+        LatencySummary summary = Summarize((LatencyStage)s);
+        sprintf_s(line, "%-18s %8llu %10.3f %10.3f %10.3f %10.3f %10.3f\r\n",
+                  kStageNames[s], (unsigned long long)summary.count, summary.meanMs,
+                  summary.p50Ms, summary.p90Ms, summary.p99Ms, summary.maxMs);
+        text += line;
+    }
+    text += "\r\n";
+
+    DWORD written = 0;
+    BOOL ok = WriteFile(hFile, text.data(), (DWORD)text.size(), &written, nullptr);
+    CloseHandle(hFile);
+    return ok && written == text.size();
+}
+
+const char* LatencyStats::StageName(LatencyStage stage) {
+    return (size_t)stage < kStages ? kStageNames[(size_t)stage] : "";
+}
+
+} // namespace Helium
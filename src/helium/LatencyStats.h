@@ -0,0 +1,74 @@
+// LatencyStats.h — Always-on latency histograms for the hot paths
+// Each thread records into its own histogram block (plain relaxed stores,
+// no locks, no shared cache lines); a dump sums the blocks. Buckets are
+// quarter-octaves of microseconds; percentiles are bucket midpoints, within
+// 12.5% of the true value.
+// Build with HELIUM_ENABLE_ETW to also emit every sample as a TraceLogging
+// event (provider "Helium.Transforma") for WPA.
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <cstdint>
+
+namespace Helium {
+
+enum class LatencyStage : uint32_t {
+    Route,              // InvoiceRouter::Route, both tiers
+    MatchFilename,      // Tier 1
+    AnalyzeContent,     // Tier 2
+    LaunchRoute,        // HeliumController::RouteBeforeLaunch, before any UI
+    CacheLoad,          // DuplicateCache
+    CacheCheck,
+    CacheSave,
+    SessionLoad,        // SessionToken::Load
+    RelayConnect,       // Connection acquired and request opened
+    RelaySend,          // Headers and body written
+    RelayFirstByte,     // Response headers received
+    RelayBody,          // Response body drained
+    Count
+};
+
+struct LatencySummary {
+    uint64_t count = 0;
+    double meanMs = 0;
+    double p50Ms = 0;
+    double p90Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+};
+
+class LatencyStats {
+public:
+    // QueryPerformanceCounter ticks
+    static int64_t Now();
+
+    // Record the time from startTicks to now; returns now, so sequential
+    // phases can chain: t = RecordSince(A, t); ... t = RecordSince(B, t);
+    static int64_t RecordSince(LatencyStage stage, int64_t startTicks);
+
+    // All threads' samples so far
+    static LatencySummary Summarize(LatencyStage stage);
+
+    // Append a table of every stage to logPath (directory created if needed)
+    static bool Dump(const std::wstring& logPath);
+
+    static const char* StageName(LatencyStage stage);
+};
+
+// Records its lifetime against a stage
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyStage stage) : m_stage(stage), m_start(LatencyStats::Now()) {}
+    ~ScopedLatency() { LatencyStats::RecordSince(m_stage, m_start); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyStage m_stage;
+    int64_t m_start;
+};
+
+} // namespace Helium
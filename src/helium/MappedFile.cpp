@@ -0,0 +1,117 @@
+// MappedFile.cpp — Memory-mapped view of a whole file
+
+#include "MappedFile.h"
+#include <utility>
+
+namespace Helium {
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        m_hMapping = other.m_hMapping;
+        m_view = other.m_view;
+        m_size = other.m_size;
+        m_writable = other.m_writable;
+        other.m_hMapping = nullptr;
+        other.m_view = nullptr;
+        other.m_size = 0;
+        other.m_writable = false;
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::wstring& path) {
+    Close();
+
+    HANDLE hFile = CreateFileW(
+        path.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr
+    );
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0) {
+        // Zero-length files cannot be mapped
+        CloseHandle(hFile);
+        return false;
+    }
+
+    bool mapped = MapHandle(hFile, (uint64_t)size.QuadPart, false);
+
+    // The mapping holds its own reference to the file
+    CloseHandle(hFile);
+    return mapped;
+}
+
+bool MappedFile::OpenWritable(const std::wstring& path, uint64_t minSize) {
+    Close();
+
+    HANDLE hFile = CreateFileW(
+        path.c_str(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_FLAG_RANDOM_ACCESS, nullptr
+    );
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size)) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    // The mapping extends the file (zero-filled) when asked for more than it holds
+    uint64_t mapSize = (uint64_t)size.QuadPart > minSize ? (uint64_t)size.QuadPart : minSize;
+    bool mapped = mapSize > 0 && MapHandle(hFile, mapSize, true);
+
+    CloseHandle(hFile);
+    return mapped;
+}
+
+bool MappedFile::MapHandle(HANDLE hFile, uint64_t size, bool writable) {
+    m_hMapping = CreateFileMappingW(hFile, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                    (DWORD)(size >> 32), (DWORD)size, nullptr);
+    if (!m_hMapping) {
+        return false;
+    }
+
+    m_view = (uint8_t*)MapViewOfFile(m_hMapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (!m_view) {
+        CloseHandle(m_hMapping);
+        m_hMapping = nullptr;
+        return false;
+    }
+
+    m_size = size;
+    m_writable = writable;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_view) {
+        UnmapViewOfFile(m_view);
+        m_view = nullptr;
+    }
+    if (m_hMapping) {
+        CloseHandle(m_hMapping);
+        m_hMapping = nullptr;
+    }
+    m_size = 0;
+    m_writable = false;
+}
+
+} // namespace Helium
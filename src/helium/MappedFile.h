@@ -0,0 +1,50 @@
+// MappedFile.h — Memory-mapped view of a whole file
+// Lets the Helium caches read their on-disk tables in place (no copy, no parse)
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <cstdint>
+
+namespace Helium {
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map the file read-only. Returns false if it is missing, empty or locked.
+    // The file stays shareable (read/write/delete) so writers can replace it.
+    bool Open(const std::wstring& path);
+
+    // Map the file read-write, creating it or growing it (zero-filled) to
+    // at least minSize. Writes through the view land in the file; other
+    // processes mapping it see them immediately.
+    bool OpenWritable(const std::wstring& path, uint64_t minSize);
+
+    // Unmap the view and release the mapping handle
+    void Close();
+
+    bool IsOpen() const { return m_view != nullptr; }
+    const uint8_t* Data() const { return m_view; }
+    uint64_t Size() const { return m_size; }
+
+    // nullptr unless opened with OpenWritable
+    uint8_t* WritableData() const { return m_writable ? m_view : nullptr; }
+
+private:
+    HANDLE m_hMapping = nullptr;
+    uint8_t* m_view = nullptr;
+    uint64_t m_size = 0;
+    bool m_writable = false;
+
+    bool MapHandle(HANDLE hFile, uint64_t size, bool writable);
+};
+
+} // namespace Helium
@@ -0,0 +1,107 @@
+// MarkerScanner.cpp — Single-pass weighted keyword scan (Aho-Corasick)
+
+#include "MarkerScanner.h"
+#include <cctype>
+#include <cstring>
+
+namespace Helium {
+
+MarkerScanner::MarkerScanner(const ContentMarker* markers, size_t count)
+    : m_markers(markers, markers + (count < 64 ? count : 64)) {
+    // Symbols: one per distinct (uppercased) marker byte, 0 for everything
+    // else — rows stay short and the table fits in a few cache lines
+    memset(m_classOf, 0, sizeof(m_classOf));
+    m_symbolCount = 1;
+    for (const auto& marker : m_markers) {
+        for (const char* p = marker.text; *p; p++) {
+            uint8_t upper = (uint8_t)toupper((unsigned char)*p);
+            if (m_classOf[upper] == 0) {
+                m_classOf[upper] = (uint8_t)m_symbolCount++;
+            }
+        }
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        m_classOf[c] = m_classOf[c - 'a' + 'A'];
+    }
+
+    // Trie (0 = no edge; the root is node 0, so no edge ever points back to it)
+    std::vector<uint16_t> trie(m_symbolCount, 0);
+    m_output.assign(1, 0);
+    for (size_t i = 0; i < m_markers.size(); i++) {
+        uint32_t node = 0;
+        for (const char* p = m_markers[i].text; *p; p++) {
+            uint32_t sym = m_classOf[(uint8_t)*p];
+            if (trie[node * m_symbolCount + sym] == 0) {
+                trie[node * m_symbolCount + sym] = (uint16_t)m_output.size();
+                trie.resize(trie.size() + m_symbolCount, 0);
+                m_output.push_back(0);
+            }
+            node = trie[node * m_symbolCount + sym];
+        }
+        m_output[node] |= 1ULL << i;
+    }
+
+    // Breadth-first failure links, folded into a full transition table so a
+    // scan step is one lookup with no failure chasing
+    size_t nodes = m_output.size();
+    m_next.assign(nodes * m_symbolCount, 0);
+    std::vector<uint32_t> fail(nodes, 0);
+    std::vector<uint32_t> queue;
+
+    for (uint32_t sym = 0; sym < m_symbolCount; sym++) {
+        uint16_t child = trie[sym];
+        m_next[sym] = child;
+        if (child != 0) queue.push_back(child);
+    }
+    for (size_t head = 0; head < queue.size(); head++) {
+        uint32_t node = queue[head];
+        m_output[node] |= m_output[fail[node]];
+        for (uint32_t sym = 0; sym < m_symbolCount; sym++) {
+            uint16_t child = trie[node * m_symbolCount + sym];
+            if (child != 0) {
+                fail[child] = m_next[fail[node] * m_symbolCount + sym];
+                m_next[node * m_symbolCount + sym] = child;
+                queue.push_back(child);
+            } else {
+                m_next[node * m_symbolCount + sym] = m_next[fail[node] * m_symbolCount + sym];
+            }
+        }
+    }
+}
+
+void MarkerScanner::Feed(State& state, std::string_view text) const {
+    const uint16_t* next = m_next.data();
+    const uint64_t* output = m_output.data();
+    uint32_t symbols = m_symbolCount;
+    uint32_t node = state.node;
+    uint64_t found = state.found;
+
+    for (char c : text) {
+        node = next[node * symbols + m_classOf[(uint8_t)c]];
+        found |= output[node];
+    }
+
+    state.node = node;
+    state.found = found;
+}
+
+double MarkerScanner::Score(const State& state) const {
+    double score = 0.0;
+    for (size_t i = 0; i < m_markers.size(); i++) {
+        if (state.found & (1ULL << i)) {
+            score += m_markers[i].weight;
+        }
+    }
+    return score > 1.0 ? 1.0 : score;
+}
+
+const char* MarkerScanner::FirstFound(const State& state) const {
+    for (size_t i = 0; i < m_markers.size(); i++) {
+        if (state.found & (1ULL << i)) {
+            return m_markers[i].text;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace Helium
@@ -0,0 +1,46 @@
+// MarkerScanner.h — Single-pass weighted keyword scan (Aho-Corasick)
+// Finds every marker in one sweep over the text, case-insensitively and
+// without copying it. Text may arrive in chunks (e.g. page by page).
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace Helium {
+
+struct ContentMarker {
+    const char* text;
+    double weight;
+};
+
+class MarkerScanner {
+public:
+    // Up to 64 markers; table order decides FirstFound()
+    MarkerScanner(const ContentMarker* markers, size_t count);
+
+    // Per-document scan progress; the scanner itself is immutable and shared
+    struct State {
+        uint32_t node = 0;
+        uint64_t found = 0;         // Bit per marker seen
+    };
+
+    // Continue the scan with the next chunk of text
+    void Feed(State& state, std::string_view text) const;
+
+    // Sum of the found markers' weights, clamped to 1.0
+    double Score(const State& state) const;
+
+    // Earliest marker in table order that was found, or nullptr
+    const char* FirstFound(const State& state) const;
+
+private:
+    std::vector<ContentMarker> m_markers;
+    uint8_t m_classOf[256];             // Byte -> symbol (case folded)
+    uint32_t m_symbolCount = 0;
+    std::vector<uint16_t> m_next;       // [node * m_symbolCount + symbol], failure links folded in
+    std::vector<uint64_t> m_output;     // Markers ending at each node (incl. via failure links)
+};
+
+} // namespace Helium
@@ -0,0 +1,783 @@
+// PatternMatcher.cpp — Regex subset -> Thompson NFA -> DFA (subset construction)
+
+#include "PatternMatcher.h"
+#include <bitset>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <cctype>
+#include <cstring>
+
+namespace Helium {
+
+// Bounds that keep compile time and table size small for any config file
+static const uint32_t kMaxDfaStates = 1024;
+static const size_t kMaxNfaStates = 4096;
+static const int kMaxRepeat = 64;
+static const int kMaxDepth = 64;
+
+namespace {
+
+// Table blob: [BlobHeader] then per group [GroupHeader][next][accept]
+struct BlobHeader {
+    uint32_t magic;             // "HDFA"
+    uint32_t groupCount;
+};
+
+struct GroupHeader {
+    uint32_t symbolCount;
+    uint32_t stateCount;
+    int32_t firstPattern;
+    uint32_t reserved;
+    uint8_t classOf[256];
+};
+
+static const uint32_t kBlobMagic = 0x41464448;
+
+// DFA tables while under construction
+struct BuiltDfa {
+    uint8_t classOf[256] = {};
+    uint32_t symbolCount = 0;
+    uint32_t stateCount = 0;
+    int32_t firstPattern = 0;
+    std::vector<uint32_t> next;
+    std::vector<int32_t> accept;
+};
+
+using ByteSet = std::bitset<256>;
+
+// ---------------------------------------------------------------------------
+// Parser: pattern string -> syntax tree
+// ---------------------------------------------------------------------------
+
+struct Node {
+    enum Kind { Empty, Bytes, Begin, End, Concat, Alt, Repeat } kind = Empty;
+    ByteSet set;
+    std::vector<Node> children;
+    int min = 0;
+    int max = 0;        // Repeat upper bound; -1 = unbounded
+};
+
+static void FoldCase(ByteSet& set) {
+    for (int c = 'a'; c <= 'z'; c++) {
+        if (set[c] || set[c - 'a' + 'A']) {
+            set[c] = true;
+            set[c - 'a' + 'A'] = true;
+        }
+    }
+}
+
+static ByteSet Range(int lo, int hi) {
+    ByteSet set;
+    for (int c = lo; c <= hi; c++) set[c] = true;
+    return set;
+}
+
+class Parser {
+public:
+    explicit Parser(const std::string& pattern) : m_p(pattern) {}
+
+    // False if the pattern is malformed or uses syntax outside the subset
+    // (backreferences, lookaround, \b, ...) — the caller falls back to std::regex
+    bool Parse(Node& out) {
+        return ParseAlt(out, 0) && m_pos == m_p.size();
+    }
+
+private:
+    const std::string& m_p;
+    size_t m_pos = 0;
+
+    bool AtEnd() const { return m_pos >= m_p.size(); }
+    char Peek() const { return m_p[m_pos]; }
+
+    bool ParseAlt(Node& out, int depth) {
+        if (depth > kMaxDepth) return false;
+
+        Node first;
+        if (!ParseConcat(first, depth)) return false;
+        if (AtEnd() || Peek() != '|') {
+            out = std::move(first);
+            return true;
+        }
+
+        out.kind = Node::Alt;
+        out.children.push_back(std::move(first));
+        while (!AtEnd() && Peek() == '|') {
+            m_pos++;
+            Node branch;
+            if (!ParseConcat(branch, depth)) return false;
+            out.children.push_back(std::move(branch));
+        }
+        return true;
+    }
+
+    bool ParseConcat(Node& out, int depth) {
+        out.kind = Node::Concat;
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            Node item;
+            if (!ParseRepeat(item, depth)) return false;
+            out.children.push_back(std::move(item));
+        }
+        return true;
+    }
+
+    bool ParseRepeat(Node& out, int depth) {
+        Node atom;
+        if (!ParseAtom(atom, depth)) return false;
+
+        while (!AtEnd()) {
+            int min, max;
+            char c = Peek();
+            if (c == '*') {
+                min = 0; max = -1; m_pos++;
+            } else if (c == '+') {
+                min = 1; max = -1; m_pos++;
+            } else if (c == '?') {
+                min = 0; max = 1; m_pos++;
+            } else if (c == '{') {
+                if (!ParseBounds(min, max)) return false;
+            } else {
+                break;
+            }
+
+            // Lazy quantifiers match the same set of strings
+            if (!AtEnd() && Peek() == '?') m_pos++;
+
+            Node rep;
+            rep.kind = Node::Repeat;
+            rep.min = min;
+            rep.max = max;
+            rep.children.push_back(std::move(atom));
+            atom = std::move(rep);
+        }
+
+        out = std::move(atom);
+        return true;
+    }
+
+    bool ParseNumber(int& value) {
+        size_t start = m_pos;
+        value = 0;
+        while (!AtEnd() && isdigit((unsigned char)Peek())) {
+            value = value * 10 + (Peek() - '0');
+            if (value > kMaxRepeat) return false;
+            m_pos++;
+        }
+        return m_pos > start;
+    }
+
+    bool ParseBounds(int& min, int& max) {
+        m_pos++;  // '{'
+        if (!ParseNumber(min)) return false;
+        max = min;
+        if (!AtEnd() && Peek() == ',') {
+            m_pos++;
+            if (!AtEnd() && Peek() == '}') {
+                max = -1;
+            } else if (!ParseNumber(max) || max < min) {
+                return false;
+            }
+        }
+        if (AtEnd() || Peek() != '}') return false;
+        m_pos++;
+        return true;
+    }
+
+    bool ParseAtom(Node& out, int depth) {
+        if (AtEnd()) return false;
+
+        char c = m_p[m_pos++];
+        switch (c) {
+        case '(':
+            if (!AtEnd() && Peek() == '?') {
+                // Only non-capturing groups; lookaround is not a regular language
+                if (m_pos + 1 >= m_p.size() || m_p[m_pos + 1] != ':') return false;
+                m_pos += 2;
+            }
+            if (!ParseAlt(out, depth + 1)) return false;
+            if (AtEnd() || Peek() != ')') return false;
+            m_pos++;
+            return true;
+        case '[':
+            out.kind = Node::Bytes;
+            return ParseClass(out.set);
+        case '.':
+            out.kind = Node::Bytes;
+            out.set.set();
+            out.set['\n'] = false;
+            out.set['\r'] = false;
+            return true;
+        case '^':
+            out.kind = Node::Begin;
+            return true;
+        case '$':
+            out.kind = Node::End;
+            return true;
+        case '\\':
+            out.kind = Node::Bytes;
+            return ParseEscape(out.set);
+        case '*': case '+': case '?': case '{': case ')': case '|':
+            return false;
+        default:
+            out.kind = Node::Bytes;
+            out.set[(uint8_t)c] = true;
+            FoldCase(out.set);
+            return true;
+        }
+    }
+
+    bool ParseEscape(ByteSet& set) {
+        if (AtEnd()) return false;
+        char c = m_p[m_pos++];
+
+        ByteSet digit = Range('0', '9');
+        ByteSet word = Range('a', 'z') | Range('A', 'Z') | digit;
+        word['_'] = true;
+        ByteSet space;
+        for (char s : {' ', '\t', '\n', '\r', '\f', '\v'}) space[(uint8_t)s] = true;
+
+        switch (c) {
+        case 'd': set = digit; return true;
+        case 'D': set = ~digit; return true;
+        case 'w': set = word; return true;
+        case 'W': set = ~word; return true;
+        case 's': set = space; return true;
+        case 'S': set = ~space; return true;
+        case 't': set['\t'] = true; return true;
+        case 'n': set['\n'] = true; return true;
+        case 'r': set['\r'] = true; return true;
+        case 'f': set['\f'] = true; return true;
+        case 'v': set['\v'] = true; return true;
+        case 'x': {
+            if (m_pos + 2 > m_p.size() ||
+                !isxdigit((unsigned char)m_p[m_pos]) || !isxdigit((unsigned char)m_p[m_pos + 1])) {
+                return false;
+            }
+            int value = std::stoi(m_p.substr(m_pos, 2), nullptr, 16);
+            m_pos += 2;
+            set[value] = true;
+            FoldCase(set);
+            return true;
+        }
+        default:
+            // \b, \B, backreferences, \c, \u ... are not supported
+            if (isalnum((unsigned char)c)) return false;
+            set[(uint8_t)c] = true;
+            return true;
+        }
+    }
+
+    bool ParseClass(ByteSet& set) {
+        bool negate = !AtEnd() && Peek() == '^';
+        if (negate) m_pos++;
+
+        while (!AtEnd() && Peek() != ']') {
+            ByteSet item;
+            int lo = -1;
+            if (Peek() == '\\') {
+                m_pos++;
+                if (!ParseEscape(item)) return false;
+                if (item.count() == 1) {
+                    for (int b = 0; b < 256; b++) if (item[b]) lo = b;
+                }
+            } else {
+                lo = (uint8_t)m_p[m_pos++];
+                item[lo] = true;
+            }
+
+            // Range a-z (a trailing '-' is a literal)
+            if (lo >= 0 && m_pos + 1 < m_p.size() && Peek() == '-' && m_p[m_pos + 1] != ']') {
+                m_pos++;
+                int hi;
+                if (Peek() == '\\') {
+                    m_pos++;
+                    ByteSet end;
+                    if (!ParseEscape(end) || end.count() != 1) return false;
+                    for (hi = 255; !end[hi]; hi--) {}
+                } else {
+                    hi = (uint8_t)m_p[m_pos++];
+                }
+                if (hi < lo) return false;
+                item = Range(lo, hi);
+            }
+            set |= item;
+        }
+        if (AtEnd()) return false;
+        m_pos++;  // ']'
+
+        FoldCase(set);
+        if (negate) set = ~set;
+        return true;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Thompson NFA
+// ---------------------------------------------------------------------------
+
+struct NfaState {
+    enum Edge { None, Bytes, Begin, End } edge = None;
+    int setId = -1;             // Into Nfa::sets, for Bytes edges
+    int to = -1;
+    std::vector<int> eps;
+    int accept = -1;            // Pattern index, on match states
+};
+
+struct Nfa {
+    std::vector<NfaState> states;
+    std::vector<ByteSet> sets;
+
+    int Add() {
+        states.emplace_back();
+        return (int)states.size() - 1;
+    }
+};
+
+struct Fragment {
+    int start;
+    int end;
+};
+
+static bool Compile(const Node& node, Nfa& nfa, Fragment& out) {
+    if (nfa.states.size() > kMaxNfaStates) return false;
+
+    switch (node.kind) {
+    case Node::Empty: {
+        int s = nfa.Add();
+        out = {s, s};
+        return true;
+    }
+    case Node::Bytes:
+    case Node::Begin:
+    case Node::End: {
+        int s = nfa.Add();
+        int e = nfa.Add();
+        NfaState& state = nfa.states[s];
+        if (node.kind == Node::Bytes) {
+            state.edge = NfaState::Bytes;
+            state.setId = (int)nfa.sets.size();
+            nfa.sets.push_back(node.set);
+        } else {
+            state.edge = node.kind == Node::Begin ? NfaState::Begin : NfaState::End;
+        }
+        state.to = e;
+        out = {s, e};
+        return true;
+    }
+    case Node::Concat: {
+        int s = nfa.Add();
+        out = {s, s};
+        for (const Node& child : node.children) {
+            Fragment f;
+            if (!Compile(child, nfa, f)) return false;
+            nfa.states[out.end].eps.push_back(f.start);
+            out.end = f.end;
+        }
+        return true;
+    }
+    case Node::Alt: {
+        int s = nfa.Add();
+        int e = nfa.Add();
+        for (const Node& child : node.children) {
+            Fragment f;
+            if (!Compile(child, nfa, f)) return false;
+            nfa.states[s].eps.push_back(f.start);
+            nfa.states[f.end].eps.push_back(e);
+        }
+        out = {s, e};
+        return true;
+    }
+    case Node::Repeat: {
+        const Node& child = node.children[0];
+        int s = nfa.Add();
+        out = {s, s};
+
+        // Mandatory copies
+        for (int i = 0; i < node.min; i++) {
+            Fragment f;
+            if (!Compile(child, nfa, f)) return false;
+            nfa.states[out.end].eps.push_back(f.start);
+            out.end = f.end;
+        }
+
+        if (node.max < 0) {
+            // Kleene loop
+            Fragment f;
+            if (!Compile(child, nfa, f)) return false;
+            int e = nfa.Add();
+            nfa.states[out.end].eps.push_back(f.start);
+            nfa.states[out.end].eps.push_back(e);
+            nfa.states[f.end].eps.push_back(out.end);
+            out.end = e;
+            return true;
+        }
+
+        // Optional copies, each skippable to the common end
+        int e = nfa.Add();
+        for (int i = node.min; i < node.max; i++) {
+            Fragment f;
+            if (!Compile(child, nfa, f)) return false;
+            nfa.states[out.end].eps.push_back(e);
+            nfa.states[out.end].eps.push_back(f.start);
+            out.end = f.end;
+        }
+        nfa.states[out.end].eps.push_back(e);
+        out.end = e;
+        return true;
+    }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Subset construction
+// ---------------------------------------------------------------------------
+
+class DfaBuilder {
+public:
+    DfaBuilder(const Nfa& nfa, int start)
+        : m_nfa(nfa), m_start(start), m_mark(nfa.states.size(), 0), m_inStart(nfa.states.size(), false) {}
+
+    bool Build(BuiltDfa& dfa) {
+        ComputeClasses(dfa);
+        ComputeSymbols(dfa);
+
+        // Unanchored search: a match may start at every position, so every
+        // DFA state implicitly contains the start set. Keys leave it out,
+        // which keeps them (and each step) proportional to live matches only.
+        Closure({m_start}, m_startSet);
+        for (int s : m_startSet) m_inStart[s] = true;
+        m_startAccept = AcceptOf(m_startSet);
+
+        m_startMoves.resize(dfa.symbolCount);
+        {
+            std::vector<std::vector<int>> buckets(dfa.symbolCount);
+            Move(m_startSet, buckets);
+            for (uint32_t sym = 0; sym < dfa.symbolCount; sym++) {
+                Closure(buckets[sym], m_startMoves[sym]);
+                Subtract(m_startMoves[sym]);
+            }
+        }
+
+        std::map<std::vector<int>, uint32_t> ids;
+        std::vector<std::vector<int>> pending;
+        ids.emplace(std::vector<int>(), 0);
+        pending.emplace_back();
+        dfa.accept.push_back(m_startAccept);
+
+        std::vector<std::vector<int>> buckets(dfa.symbolCount);
+        std::vector<int> closed, target;
+        for (size_t current = 0; current < pending.size(); current++) {
+            for (auto& bucket : buckets) bucket.clear();
+            Move(pending[current], buckets);
+
+            for (uint32_t sym = 0; sym < dfa.symbolCount; sym++) {
+                Closure(buckets[sym], closed);
+                Subtract(closed);
+                target.clear();
+                std::set_union(closed.begin(), closed.end(),
+                               m_startMoves[sym].begin(), m_startMoves[sym].end(),
+                               std::back_inserter(target));
+
+                auto it = ids.find(target);
+                uint32_t id;
+                if (it != ids.end()) {
+                    id = it->second;
+                } else {
+                    id = (uint32_t)pending.size();
+                    if (id >= kMaxDfaStates) return false;
+                    int32_t accept = AcceptOf(target);
+                    if (m_startAccept >= 0 && (accept < 0 || m_startAccept < accept)) accept = m_startAccept;
+                    dfa.accept.push_back(accept);
+                    ids.emplace(target, id);
+                    pending.push_back(target);
+                }
+                dfa.next.push_back(id);
+            }
+        }
+
+        dfa.stateCount = (uint32_t)pending.size();
+        return true;
+    }
+
+private:
+    const Nfa& m_nfa;
+    int m_start;
+    std::vector<uint32_t> m_mark;
+    uint32_t m_stamp = 0;
+    std::vector<int> m_stack;
+    std::vector<bool> m_inStart;
+    std::vector<int> m_startSet;
+    int32_t m_startAccept = -1;
+    std::vector<std::vector<int>> m_startMoves;     // Per symbol, start set excluded
+    std::vector<uint8_t> m_rep;                     // Representative byte per class
+    std::vector<std::vector<uint32_t>> m_symbols;   // Per NFA state: symbols its edge takes
+
+    // Bytes no pattern tells apart share a symbol, so rows stay short
+    void ComputeClasses(BuiltDfa& dfa) {
+        std::vector<int> classOf(256, 0);
+        int classes = 1;
+        for (const ByteSet& set : m_nfa.sets) {
+            std::map<std::pair<int, bool>, int> split;
+            int next = 0;
+            for (int b = 0; b < 256; b++) {
+                auto key = std::make_pair(classOf[b], (bool)set[b]);
+                auto it = split.find(key);
+                if (it == split.end()) it = split.emplace(key, next++).first;
+                classOf[b] = it->second;
+            }
+            classes = next;
+        }
+
+        m_rep.assign(classes, 0);
+        for (int b = 255; b >= 0; b--) {
+            dfa.classOf[b] = (uint8_t)classOf[b];
+            m_rep[classOf[b]] = (uint8_t)b;
+        }
+        dfa.symbolCount = (uint32_t)classes + 2;
+    }
+
+    void ComputeSymbols(const BuiltDfa& dfa) {
+        uint32_t begin = dfa.symbolCount - 2;
+        m_symbols.assign(m_nfa.states.size(), {});
+        for (size_t s = 0; s < m_nfa.states.size(); s++) {
+            const NfaState& state = m_nfa.states[s];
+            if (state.edge == NfaState::Bytes) {
+                for (uint32_t sym = 0; sym < begin; sym++) {
+                    if (m_nfa.sets[state.setId][m_rep[sym]]) m_symbols[s].push_back(sym);
+                }
+            } else if (state.edge == NfaState::Begin) {
+                m_symbols[s].push_back(begin);
+            } else if (state.edge == NfaState::End) {
+                m_symbols[s].push_back(begin + 1);
+            }
+        }
+    }
+
+    void Move(const std::vector<int>& from, std::vector<std::vector<int>>& buckets) const {
+        for (int s : from) {
+            for (uint32_t sym : m_symbols[s]) {
+                buckets[sym].push_back(m_nfa.states[s].to);
+            }
+        }
+    }
+
+    // Epsilon closure, keeping only states that matter for identity
+    // (symbol edges and match states)
+    void Closure(const std::vector<int>& seeds, std::vector<int>& out) {
+        out.clear();
+        if (seeds.empty()) return;
+
+        m_stamp++;
+        std::vector<int>& stack = m_stack;
+        for (int s : seeds) {
+            if (m_mark[s] != m_stamp) {
+                m_mark[s] = m_stamp;
+                stack.push_back(s);
+            }
+        }
+        while (!stack.empty()) {
+            int s = stack.back();
+            stack.pop_back();
+            const NfaState& state = m_nfa.states[s];
+            if (state.edge != NfaState::None || state.accept >= 0) {
+                out.push_back(s);
+            }
+            for (int t : state.eps) {
+                if (m_mark[t] != m_stamp) {
+                    m_mark[t] = m_stamp;
+                    stack.push_back(t);
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+    }
+
+    void Subtract(std::vector<int>& set) const {
+        set.erase(std::remove_if(set.begin(), set.end(), [this](int s) { return m_inStart[s]; }), set.end());
+    }
+
+    int32_t AcceptOf(const std::vector<int>& set) const {
+        int32_t best = -1;
+        for (int s : set) {
+            int a = m_nfa.states[s].accept;
+            if (a >= 0 && (best < 0 || a < best)) best = a;
+        }
+        return best;
+    }
+};
+
+// One DFA over the given patterns (already parsed), or false if too large
+static bool BuildGroup(const std::vector<std::pair<size_t, const Node*>>& patterns,
+                       size_t lo, size_t hi, BuiltDfa& dfa) {
+    Nfa nfa;
+    int start = nfa.Add();
+    for (size_t i = lo; i < hi; i++) {
+        Fragment f;
+        if (!Compile(*patterns[i].second, nfa, f)) return false;
+        int match = nfa.Add();
+        nfa.states[match].accept = (int)patterns[i].first;
+        nfa.states[f.end].eps.push_back(match);
+        nfa.states[start].eps.push_back(f.start);
+    }
+
+    dfa.firstPattern = (int32_t)patterns[lo].first;
+    return DfaBuilder(nfa, start).Build(dfa);
+}
+
+static void BuildGroups(const std::vector<std::pair<size_t, const Node*>>& patterns,
+                        size_t lo, size_t hi,
+                        std::vector<BuiltDfa>& groups, std::vector<size_t>& unsupported) {
+    if (lo >= hi) return;
+
+    BuiltDfa dfa;
+    if (BuildGroup(patterns, lo, hi, dfa)) {
+        groups.push_back(std::move(dfa));
+        return;
+    }
+
+    if (hi - lo == 1) {
+        // Too large on its own (e.g. a{1,64}b{1,64}...) — leave it to std::regex
+        unsupported.push_back(patterns[lo].first);
+        return;
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    BuildGroups(patterns, lo, mid, groups, unsupported);
+    BuildGroups(patterns, mid, hi, groups, unsupported);
+}
+
+} // namespace
+
+void PatternMatcher::Build(const std::vector<std::string>& patterns, std::vector<size_t>& unsupported) {
+    m_groups.clear();
+    m_storage.clear();
+    m_data = nullptr;
+    m_size = 0;
+    unsupported.clear();
+
+    std::vector<Node> trees(patterns.size());
+    std::vector<std::pair<size_t, const Node*>> parsed;
+    for (size_t i = 0; i < patterns.size(); i++) {
+        if (Parser(patterns[i]).Parse(trees[i])) {
+            parsed.emplace_back(i, &trees[i]);
+        } else {
+            unsupported.push_back(i);
+        }
+    }
+
+    std::vector<BuiltDfa> built;
+    BuildGroups(parsed, 0, parsed.size(), built, unsupported);
+    std::sort(unsupported.begin(), unsupported.end());
+
+    // Lay the tables out exactly as Attach() expects them, so built and
+    // cached matchers share one representation
+    size_t size = sizeof(BlobHeader);
+    for (const BuiltDfa& dfa : built) {
+        size += sizeof(GroupHeader) + dfa.next.size() * sizeof(uint32_t) + dfa.accept.size() * sizeof(int32_t);
+    }
+    m_storage.resize(size);
+
+    uint8_t* out = m_storage.data();
+    BlobHeader header = { kBlobMagic, (uint32_t)built.size() };
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (const BuiltDfa& dfa : built) {
+        GroupHeader group = { dfa.symbolCount, dfa.stateCount, dfa.firstPattern, 0, {} };
+        memcpy(group.classOf, dfa.classOf, sizeof(group.classOf));
+        memcpy(out, &group, sizeof(group));
+        out += sizeof(group);
+        memcpy(out, dfa.next.data(), dfa.next.size() * sizeof(uint32_t));
+        out += dfa.next.size() * sizeof(uint32_t);
+        memcpy(out, dfa.accept.data(), dfa.accept.size() * sizeof(int32_t));
+        out += dfa.accept.size() * sizeof(int32_t);
+    }
+
+    Attach(m_storage.data(), m_storage.size());
+}
+
+bool PatternMatcher::Attach(const uint8_t* data, size_t size) {
+    m_groups.clear();
+    m_data = nullptr;
+    m_size = 0;
+
+    BlobHeader header;
+    if (size < sizeof(header) || ((uintptr_t)data & 3) != 0) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != kBlobMagic) return false;
+
+    // Validate every table entry once, so Run() can index without checks
+    std::vector<PatternDfa> groups;
+    size_t pos = sizeof(header);
+    int32_t lastFirst = -1;
+    for (uint32_t g = 0; g < header.groupCount; g++) {
+        if (size - pos < sizeof(GroupHeader)) return false;
+        const GroupHeader* group = reinterpret_cast<const GroupHeader*>(data + pos);
+        pos += sizeof(GroupHeader);
+
+        uint64_t cells = (uint64_t)group->stateCount * group->symbolCount;
+        if (group->symbolCount < 3 || group->stateCount == 0 || group->stateCount > kMaxDfaStates ||
+            group->firstPattern <= lastFirst ||
+            (size - pos) / sizeof(uint32_t) < cells + group->stateCount) {
+            return false;
+        }
+        lastFirst = group->firstPattern;
+
+        PatternDfa dfa;
+        dfa.classOf = group->classOf;
+        dfa.symbolCount = group->symbolCount;
+        dfa.stateCount = group->stateCount;
+        dfa.firstPattern = group->firstPattern;
+        dfa.next = reinterpret_cast<const uint32_t*>(data + pos);
+        pos += (size_t)cells * sizeof(uint32_t);
+        dfa.accept = reinterpret_cast<const int32_t*>(data + pos);
+        pos += (size_t)group->stateCount * sizeof(int32_t);
+
+        for (int b = 0; b < 256; b++) {
+            if (dfa.classOf[b] >= dfa.symbolCount - 2) return false;
+        }
+        for (uint64_t i = 0; i < cells; i++) {
+            if (dfa.next[i] >= dfa.stateCount) return false;
+        }
+        groups.push_back(dfa);
+    }
+    if (pos != size) return false;
+
+    m_groups = std::move(groups);
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+int PatternMatcher::Match(std::string_view text) const {
+    // Groups cover ascending pattern ranges, so the first group with any
+    // match holds the lowest matching index
+    for (const PatternDfa& dfa : m_groups) {
+        int best = Run(dfa, text);
+        if (best >= 0) return best;
+    }
+    return -1;
+}
+
+int PatternMatcher::Run(const PatternDfa& dfa, std::string_view text) {
+    const uint32_t* next = dfa.next;
+    uint32_t symbols = dfa.symbolCount;
+
+    int best = dfa.accept[0];
+    auto step = [&](uint32_t state, uint32_t symbol) {
+        state = next[state * symbols + symbol];
+        int a = dfa.accept[state];
+        if (a >= 0 && (best < 0 || a < best)) best = a;
+        return state;
+    };
+
+    uint32_t state = step(0, symbols - 2);
+    for (char c : text) {
+        if (best == dfa.firstPattern) return best;  // Nothing can beat it
+        state = step(state, dfa.classOf[(uint8_t)c]);
+    }
+    step(state, symbols - 1);
+    return best;
+}
+
+} // namespace Helium
@@ -0,0 +1,63 @@
+// PatternMatcher.h — All Tier-1 filename patterns compiled into one automaton
+// A filename is scanned once, byte by byte, whatever the number of patterns.
+// Supports the regex subset routing patterns use: literals, ., [...] classes,
+// \d \w \s (and negations), groups, (?:...), |, * + ? {n,m}, ^ and $.
+// Matching is case-insensitive (ASCII) and unanchored, like std::regex_search
+// with icase.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace Helium {
+
+// One DFA over a run of consecutive patterns. The filename is framed by two
+// virtual symbols (begin / end of text) so ^ and $ need no special casing.
+// Points into the matcher's table blob — built in memory or mapped from disk.
+struct PatternDfa {
+    const uint8_t* classOf = nullptr;   // [256] Byte -> symbol
+    uint32_t symbolCount = 0;           // Byte classes, then begin, then end
+    uint32_t stateCount = 0;
+    int32_t firstPattern = 0;           // Lowest pattern index in this group
+    const uint32_t* next = nullptr;     // [state * symbolCount + symbol]
+    const int32_t* accept = nullptr;    // Lowest pattern index matched on entry, -1 = none
+};
+
+class PatternMatcher {
+public:
+    PatternMatcher() = default;
+    PatternMatcher(const PatternMatcher&) = delete;
+    PatternMatcher& operator=(const PatternMatcher&) = delete;
+
+    // Compile patterns (index = position in the vector). Patterns outside the
+    // supported subset are skipped and their indices returned in unsupported.
+    void Build(const std::vector<std::string>& patterns, std::vector<size_t>& unsupported);
+
+    // Index of the first pattern (in Build order) found anywhere in text,
+    // or -1. Only patterns that compiled take part.
+    int Match(std::string_view text) const;
+
+    bool Empty() const { return m_groups.empty(); }
+
+    // Compiled tables as one position-independent blob, for caching on disk
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // Use tables produced by Build() without copying them (e.g. a mapped
+    // file). The memory must outlive the matcher. False if malformed.
+    bool Attach(const uint8_t* data, size_t size);
+
+private:
+    // Ascending pattern ranges; more than one only if a single DFA grew too big
+    std::vector<PatternDfa> m_groups;
+    std::vector<uint8_t> m_storage;     // Owned blob after Build()
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+    static int Run(const PatternDfa& dfa, std::string_view text);
+};
+
+} // namespace Helium
@@ -0,0 +1,241 @@
+// PdfText.cpp — First-page text through a shared MuPDF context
+
+#include "PdfText.h"
+#include "StringUtil.h"
+#include <windows.h>
+#include <cmath>
+#include <cstring>
+
+extern "C" {
+#include <mupdf/fitz.h>
+}
+
+namespace Helium {
+
+// Fonts and decoded streams stay cached across documents; bounded so routing
+// a big batch doesn't grow the viewer's footprint
+static const size_t kStoreBytes = 32 << 20;
+
+// Text is handed to the sink in chunks of about this many bytes
+static const int kChunkBytes = 256;
+
+// ── Shared context ────────────────────────────────────────────
+
+static SRWLOCK g_fzLocks[FZ_LOCK_MAX];  // Zero-initialized == SRWLOCK_INIT
+
+static void LockFz(void*, int lock) {
+    AcquireSRWLockExclusive(&g_fzLocks[lock]);
+}
+
+static void UnlockFz(void*, int lock) {
+    ReleaseSRWLockExclusive(&g_fzLocks[lock]);
+}
+
+// Created once and never dropped; each thread works on a clone that shares
+// its store, so fonts parsed for one invoice are reused for the next
+static fz_context* BaseContext() {
+    static fz_context* base = []() -> fz_context* {
+        static fz_locks_context locks = { nullptr, LockFz, UnlockFz };
+        fz_context* ctx = fz_new_context(nullptr, &locks, kStoreBytes);
+        if (!ctx) return nullptr;
+        fz_try(ctx) {
+            fz_register_document_handlers(ctx);
+        }
+        fz_catch(ctx) {
+            fz_drop_context(ctx);
+            return nullptr;
+        }
+        return ctx;
+    }();
+    return base;
+}
+
+static fz_context* ThreadContext() {
+    struct Clone {
+        fz_context* ctx = nullptr;
+        ~Clone() { if (ctx) fz_drop_context(ctx); }
+    };
+    thread_local Clone clone;
+    if (!clone.ctx) {
+        fz_context* base = BaseContext();
+        if (base) clone.ctx = fz_clone_context(base);
+    }
+    return clone.ctx;
+}
+
+// ── Text device ───────────────────────────────────────────────
+// Only text callbacks are set; paths and images are skipped by the
+// interpreter's device dispatch at no cost.
+
+struct ScanDevice {
+    fz_device super;
+    const PdfText::Sink* sink;
+    fz_cookie* cookie;
+    int remaining;              // Characters left in the budget
+    bool stopped;
+
+    // Where the next glyph starts if it follows on; anything else is a
+    // word break the PDF didn't spell out with a space
+    bool havePen;
+    fz_point pen;
+    float penSize;
+
+    bool lastSpace;
+    int len;
+    char chunk[kChunkBytes + 8];
+};
+
+static void StopScan(ScanDevice* dev) {
+    dev->stopped = true;
+    dev->cookie->abort = 1;     // Interpreter checks this between operators
+}
+
+static void FlushChunk(ScanDevice* dev) {
+    if (dev->stopped || dev->len == 0) return;
+    bool more = (*dev->sink)(std::string_view(dev->chunk, dev->len));
+    dev->len = 0;
+    if (!more || dev->remaining <= 0) {
+        StopScan(dev);
+    }
+}
+
+static void PutBytes(ScanDevice* dev, const char* bytes, int count) {
+    if (dev->stopped) return;
+    memcpy(dev->chunk + dev->len, bytes, count);
+    dev->len += count;
+    dev->remaining--;
+    if (dev->len >= kChunkBytes || dev->remaining <= 0) {
+        FlushChunk(dev);
+    }
+}
+
+static void PutSpace(ScanDevice* dev) {
+    // Collapse runs so "BILL   TO" still reads as "BILL TO"
+    if (dev->lastSpace) return;
+    PutBytes(dev, " ", 1);
+    dev->lastSpace = true;
+}
+
+static void PutRune(ScanDevice* dev, int ucs) {
+    if (ucs <= ' ' || ucs == 0xA0) {
+        PutSpace(dev);
+        return;
+    }
+    char utf8[FZ_UTFMAX];
+    PutBytes(dev, utf8, fz_runetochar(utf8, ucs));
+    dev->lastSpace = false;
+}
+
+static void ScanText(fz_context* ctx, ScanDevice* dev, const fz_text* text, fz_matrix ctm) {
+    for (const fz_text_span* span = text->head; span && !dev->stopped; span = span->next) {
+        fz_matrix trm = span->trm;
+        for (int i = 0; i < span->len && !dev->stopped; i++) {
+            const fz_text_item& item = span->items[i];
+            if (item.ucs < 0) continue;
+
+            // Ligature tails (gid -1) share the previous glyph's position
+            if (item.gid < 0) {
+                PutRune(dev, item.ucs);
+                continue;
+            }
+
+            trm.e = item.x;
+            trm.f = item.y;
+            fz_matrix glyph = fz_concat(trm, ctm);
+            float size = fz_matrix_expansion(glyph);
+
+            if (dev->havePen) {
+                float dx = glyph.e - dev->pen.x;
+                float dy = glyph.f - dev->pen.y;
+                if (hypotf(dx, dy) > dev->penSize * 0.25f) {
+                    PutSpace(dev);
+                }
+            }
+            PutRune(dev, item.ucs);
+
+            float adv = fz_advance_glyph(ctx, span->font, item.gid, span->wmode);
+            fz_point end = span->wmode ? fz_make_point(0, -adv) : fz_make_point(adv, 0);
+            dev->pen = fz_transform_point(end, glyph);
+            dev->penSize = size;
+            dev->havePen = true;
+        }
+    }
+}
+
+static void FillText(fz_context* ctx, fz_device* dev, const fz_text* text, fz_matrix ctm,
+                     fz_colorspace*, const float*, float, fz_color_params) {
+    ScanText(ctx, (ScanDevice*)dev, text, ctm);
+}
+
+static void StrokeText(fz_context* ctx, fz_device* dev, const fz_text* text, const fz_stroke_state*,
+                       fz_matrix ctm, fz_colorspace*, const float*, float, fz_color_params) {
+    ScanText(ctx, (ScanDevice*)dev, text, ctm);
+}
+
+static void ClipText(fz_context* ctx, fz_device* dev, const fz_text* text, fz_matrix ctm, fz_rect) {
+    ScanText(ctx, (ScanDevice*)dev, text, ctm);
+}
+
+static void ClipStrokeText(fz_context* ctx, fz_device* dev, const fz_text* text, const fz_stroke_state*,
+                           fz_matrix ctm, fz_rect) {
+    ScanText(ctx, (ScanDevice*)dev, text, ctm);
+}
+
+// Invisible text — the OCR layer of scanned invoices
+static void IgnoreText(fz_context* ctx, fz_device* dev, const fz_text* text, fz_matrix ctm) {
+    ScanText(ctx, (ScanDevice*)dev, text, ctm);
+}
+
+// ── Public ────────────────────────────────────────────────────
+
+bool PdfText::ScanFirstPage(const std::wstring& path, int maxChars, const Sink& sink) {
+    fz_context* ctx = ThreadContext();
+    if (!ctx || maxChars <= 0) return false;
+
+    std::string utf8 = WideToUtf8(path);
+    fz_document* doc = nullptr;
+    fz_page* page = nullptr;
+    ScanDevice* dev = nullptr;
+    fz_cookie cookie = {};
+    bool ok = false;
+
+    fz_var(doc);
+    fz_var(page);
+    fz_var(dev);
+    fz_var(ok);
+
+    fz_try(ctx) {
+        doc = fz_open_document(ctx, utf8.c_str());
+        if (fz_needs_password(ctx, doc)) {
+            fz_throw(ctx, FZ_ERROR_GENERIC, "document is password protected");
+        }
+        page = fz_load_page(ctx, doc, 0);
+
+        dev = fz_new_derived_device(ctx, ScanDevice);
+        dev->super.fill_text = FillText;
+        dev->super.stroke_text = StrokeText;
+        dev->super.clip_text = ClipText;
+        dev->super.clip_stroke_text = ClipStrokeText;
+        dev->super.ignore_text = IgnoreText;
+        dev->sink = &sink;
+        dev->cookie = &cookie;
+        dev->remaining = maxChars;
+
+        fz_run_page(ctx, page, &dev->super, fz_identity, &cookie);
+        fz_close_device(ctx, &dev->super);
+        FlushChunk(dev);
+        ok = true;
+    }
+    fz_always(ctx) {
+        fz_drop_device(ctx, (fz_device*)dev);
+        fz_drop_page(ctx, page);
+        fz_drop_document(ctx, doc);
+    }
+    fz_catch(ctx) {
+        // Stopping early may surface as an aborted run; what was read stands
+        ok = cookie.abort != 0;
+    }
+    return ok;
+}
+
+} // namespace Helium
@@ -0,0 +1,25 @@
+// PdfText.h — First-page text through a shared MuPDF context
+// Runs page 1 through a text-only device and hands the text to the caller
+// as the content stream produces it, so a caller that has seen enough can
+// stop the interpreter mid-page.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+
+namespace Helium {
+
+class PdfText {
+public:
+    // Receives successive chunks of page text. Return false to stop.
+    using Sink = std::function<bool(std::string_view text)>;
+
+    // Stream up to maxChars of page 1's text into sink. Returns false if the
+    // document can't be opened (missing, damaged, password protected).
+    // Safe to call from any thread.
+    static bool ScanFirstPage(const std::wstring& path, int maxChars, const Sink& sink);
+};
+
+} // namespace Helium
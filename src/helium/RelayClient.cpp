@@ -2,123 +2,255 @@
 // Uses WinHTTP (no external dependencies)
 
 #include "RelayClient.h"
-#include <fstream>
-#include <sstream>
+#include "LatencyStats.h"
+#include "Json.h"
+#include "StringUtil.h"
 #include <vector>
 #include <random>
 
 namespace Helium {
 
-RelayClient::RelayClient() {
-    m_hSession = WinHttpOpen(
-        L"TransformaReader/1.0",
-        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-        WINHTTP_NO_PROXY_NAME,
-        WINHTTP_NO_PROXY_BYPASS,
-        0
-    );
-}
+RelayClient::RelayClient() {}
 
 RelayClient::~RelayClient() {
-    if (m_hSession) {
-        WinHttpCloseHandle(m_hSession);
-    }
+    m_health.Stop();
 }
 
 void RelayClient::SetEndpoint(const std::wstring& host, int port) {
+    std::lock_guard<std::mutex> lock(m_handleMutex);
+    if (host != m_host || port != m_port) {
+        m_sync.connection.reset();
+        m_async.connection.reset();
+    }
     m_host = host;
     m_port = port;
 }
 
+// Closes the handle once the last user lets go; a child keeps its parent open
+static std::shared_ptr<void> WrapHandle(HINTERNET handle, std::shared_ptr<void> parent = nullptr) {
+    return std::shared_ptr<void>(handle, [parent](void* h) { WinHttpCloseHandle(h); });
+}
+
+bool RelayClient::IsLoopbackHost(const std::wstring& host) {
+    return CompareStringOrdinal(host.c_str(), (int)host.size(), L"localhost", -1, TRUE) == CSTR_EQUAL ||
+           host.compare(0, 4, L"127.") == 0 ||
+           host == L"::1" || host == L"[::1]";
+}
+
+std::shared_ptr<void> RelayClient::AcquireConnection(bool async, std::string& error) {
+    std::lock_guard<std::mutex> lock(m_handleMutex);
+    SessionSlot& slot = async ? m_async : m_sync;
+    if (slot.connection) {
+        return slot.connection;
+    }
+
+    // Relay normally runs on this machine — no proxy lookup for loopback
+    bool direct = IsLoopbackHost(m_host);
+    if (!slot.session || slot.direct != direct) {
+        HINTERNET hSession = WinHttpOpen(
+            L"TransformaReader/1.0",
+            direct ? WINHTTP_ACCESS_TYPE_NO_PROXY : WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+            WINHTTP_NO_PROXY_NAME,
+            WINHTTP_NO_PROXY_BYPASS,
+            async ? WINHTTP_FLAG_ASYNC : 0
+        );
+        if (!hSession) {
+            error = "WinHTTP session not initialized";
+            return nullptr;
+        }
+        slot.session = WrapHandle(hSession);
+        slot.direct = direct;
+    }
+
+    HINTERNET hConnect = WinHttpConnect((HINTERNET)slot.session.get(), m_host.c_str(), (INTERNET_PORT)m_port, 0);
+    if (!hConnect) {
+        error = "Failed to connect to Relay";
+        return nullptr;
+    }
+    slot.connection = WrapHandle(hConnect, slot.session);
+    return slot.connection;
+}
+
+bool RelayClient::PrepareUpload(
+    const std::wstring& pdfPath,
+    const std::string& userEmail,
+    const ContentCheck& contentCheck,
+    const InvoiceFields& fields,
+    UploadBody& upload,
+    SubmitResult& result
+) {
+    if (!upload.pdf.Open(pdfPath)) {
+        result.error = "Failed to read PDF file";
+        return false;
+    }
+
+    // The check needs the hash before anything is sent, so hash the view in
+    // place first (which also pages the file in for the upload). Without a
+    // check, hash while uploading and let the upload start right away.
+    if (contentCheck) {
+        upload.hasher.Update(upload.pdf.Data(), (size_t)upload.pdf.Size());
+        result.contentHash = upload.hasher.Final();
+        if (!contentCheck(result.contentHash)) {
+            result.blocked = true;
+            result.error = "Identical document already submitted";
+            return false;
+        }
+    }
+    upload.hashWhileSending = !contentCheck;
+
+    // Float is known to be stopped: say so now instead of after a connect timeout
+    if (m_health.State() == RelayHealth::Unreachable) {
+        result.unreachable = true;
+        result.error = "Helium Relay is not reachable (is Float running?)";
+        return false;
+    }
+
+    // Routed by filename or from the route cache: page 1's text was never
+    // read. One text pass here saves Core a full parse.
+    InvoiceFields sent = fields;
+    if (!sent.scanned) {
+        InvoiceFields::Extract(pdfPath, sent);
+    }
+
+    std::string boundary;
+    BuildMultipartFraming(pdfPath, userEmail, sent, boundary, upload.preamble, upload.epilogue);
+    upload.contentType = "multipart/form-data; boundary=" + boundary;
+
+    upload.parts = {
+        { upload.preamble.data(), upload.preamble.size() },
+        { upload.pdf.Data(), upload.pdf.Size(), upload.hashWhileSending ? &upload.hasher : nullptr },
+        { upload.epilogue.data(), upload.epilogue.size() },
+    };
+    upload.totalLength = 0;
+    for (const BodyPart& part : upload.parts) {
+        upload.totalLength += part.size;
+    }
+    if (upload.totalLength > MAXDWORD) {
+        result.error = "PDF too large to submit";
+        return false;
+    }
+    return true;
+}
+
 SubmitResult RelayClient::SubmitInvoice(
     const std::wstring& pdfPath,
     const std::string& userEmail,
-    const std::string& sessionToken
+    const std::string& sessionToken,
+    const ContentCheck& contentCheck,
+    const InvoiceFields& fields
 ) {
     SubmitResult result;
 
-    std::string boundary;
-    std::string body = BuildMultipartBody(pdfPath, userEmail, boundary);
-    if (body.empty()) {
-        result.error = "Failed to read PDF file";
+    UploadBody upload;
+    if (!PrepareUpload(pdfPath, userEmail, contentCheck, fields, upload, result)) {
         return result;
     }
 
-    std::string contentType = "multipart/form-data; boundary=" + boundary;
-    RelayResponse resp = SendRequest(L"POST", L"/api/ingest", body, contentType, sessionToken);
+    RelayResponse resp = SendRequest(L"POST", L"/api/ingest", upload.parts, upload.contentType, sessionToken);
+    if (resp.success) {
+        m_health.ReportReachable();
+    } else if (resp.unreachable) {
+        m_health.ReportUnreachable();
+    }
+    if (resp.success && upload.hashWhileSending) {
+        result.contentHash = upload.hasher.Final();
+    }
+    ParseSubmitResponse(resp, result);
+    return result;
+}
 
+void RelayClient::ParseSubmitResponse(const RelayResponse& resp, SubmitResult& result) {
     result.httpStatus = resp.statusCode;
 
     if (!resp.success) {
         result.error = resp.error;
-        return result;
+        result.unreachable = resp.unreachable;
+        return;
     }
 
     if (resp.statusCode == 200 || resp.statusCode == 201) {
         result.success = true;
-        // Parse JSON response for file_uuid and firs_reference
-        // Minimal JSON parsing — look for known keys
-        auto extractField = [&](const std::string& key) -> std::string {
-            std::string search = "\"" + key + "\"";
-            size_t pos = resp.body.find(search);
-            if (pos == std::string::npos) return "";
-            pos = resp.body.find("\"", pos + search.length() + 1);
-            if (pos == std::string::npos) return "";
-            size_t end = resp.body.find("\"", pos + 1);
-            if (end == std::string::npos) return "";
-            return resp.body.substr(pos + 1, end - pos - 1);
-        };
-        result.fileUuid = extractField("file_uuid");
-        result.firsReference = extractField("firs_reference");
+        // file_uuid and firs_reference, in one pass over the reply
+        static const std::string_view kKeys[] = { "file_uuid", "firs_reference" };
+        std::string_view values[2];
+        ScanJsonStrings(resp.body, kKeys, values, 2);
+        result.fileUuid = values[0];
+        result.firsReference = values[1];
     } else if (resp.statusCode == 409) {
         result.error = "Invoice already submitted (duplicate)";
+    } else if (resp.statusCode == 429 && resp.retryAfterSeconds > 0) {
+        result.retryAfterSeconds = resp.retryAfterSeconds;
+        result.error = "Relay is busy — try again shortly";
     } else if (resp.statusCode == 429) {
         result.error = "Daily submission limit exceeded";
     } else {
         result.error = "Relay returned HTTP " + std::to_string(resp.statusCode);
     }
-
-    return result;
 }
 
-bool RelayClient::IsRelayAvailable() {
-    RelayResponse resp = SendRequest(L"GET", L"/health", "", "", "");
+bool RelayClient::IsRelayAvailable(DWORD timeoutMs) {
+    RelayResponse resp = SendRequest(L"GET", L"/health", {}, "", "", timeoutMs);
     return resp.success && resp.statusCode == 200;
 }
 
+// Retry-After in seconds; the HTTP-date form (or none) reads as 0
+static int QueryRetryAfter(HINTERNET hRequest) {
+    DWORD seconds = 0;
+    DWORD size = sizeof(seconds);
+    if (!WinHttpQueryHeaders(hRequest,
+            WINHTTP_QUERY_RETRY_AFTER | WINHTTP_QUERY_FLAG_NUMBER,
+            WINHTTP_HEADER_NAME_BY_INDEX, &seconds, &size, WINHTTP_NO_HEADER_INDEX)) {
+        return 0;
+    }
+    return (int)seconds;
+}
+
+// Large enough to keep the socket busy, small enough that a stalled
+// network read of the mapped file holds little
+static const DWORD kWriteChunk = 64 * 1024;
+
 RelayResponse RelayClient::SendRequest(
     const std::wstring& method,
     const std::wstring& path,
-    const std::string& body,
+    const std::vector<BodyPart>& body,
     const std::string& contentType,
-    const std::string& authToken
+    const std::string& authToken,
+    DWORD timeoutMs
 ) {
     RelayResponse result;
 
-    if (!m_hSession) {
-        result.error = "WinHTTP session not initialized";
+    uint64_t totalLength = 0;
+    for (const BodyPart& part : body) {
+        totalLength += part.size;
+    }
+    if (totalLength > MAXDWORD) {
+        result.error = "Request body too large";
         return result;
     }
 
-    HINTERNET hConnect = WinHttpConnect(m_hSession, m_host.c_str(), (INTERNET_PORT)m_port, 0);
-    if (!hConnect) {
-        result.error = "Failed to connect to Relay";
+    int64_t phase = LatencyStats::Now();
+    std::shared_ptr<void> connection = AcquireConnection(false, result.error);
+    if (!connection) {
         return result;
     }
 
     HINTERNET hRequest = WinHttpOpenRequest(
-        hConnect, method.c_str(), path.c_str(),
+        (HINTERNET)connection.get(), method.c_str(), path.c_str(),
         nullptr, WINHTTP_NO_REFERER,
         WINHTTP_DEFAULT_ACCEPT_TYPES, 0
     );
     if (!hRequest) {
-        WinHttpCloseHandle(hConnect);
         result.error = "Failed to create HTTP request";
         return result;
     }
 
-    // Set timeout: 30 seconds for connect, send, receive
-    WinHttpSetTimeouts(hRequest, 5000, 30000, 30000, 30000);
+    // Set timeout: 30 seconds for connect, send, receive (probes ask for less)
+    if (timeoutMs != 0) {
+        WinHttpSetTimeouts(hRequest, timeoutMs, timeoutMs, timeoutMs, timeoutMs);
+    } else {
+        WinHttpSetTimeouts(hRequest, 5000, 30000, 30000, 30000);
+    }
+    phase = LatencyStats::RecordSince(LatencyStage::RelayConnect, phase);
 
     // Add headers
     if (!contentType.empty()) {
@@ -131,27 +263,45 @@ RelayResponse RelayClient::SendRequest(
         WinHttpAddRequestHeaders(hRequest, authHeader.c_str(), (DWORD)-1, WINHTTP_ADDREQ_FLAG_ADD);
     }
 
-    // Send request
+    // Send headers, then the body part by part in fixed-size writes
     BOOL sent = WinHttpSendRequest(
         hRequest,
         WINHTTP_NO_ADDITIONAL_HEADERS, 0,
-        (LPVOID)body.c_str(), (DWORD)body.size(),
-        (DWORD)body.size(), 0
+        WINHTTP_NO_REQUEST_DATA, 0,
+        (DWORD)totalLength, 0
     );
 
     if (!sent) {
         WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
         result.error = "Failed to send request (is Relay running?)";
+        result.unreachable = true;
         return result;
     }
 
+    for (const BodyPart& part : body) {
+        const uint8_t* data = (const uint8_t*)part.data;
+        for (uint64_t offset = 0; offset < part.size; ) {
+            DWORD chunk = (DWORD)(part.size - offset < kWriteChunk ? part.size - offset : kWriteChunk);
+            DWORD written = 0;
+            if (!WinHttpWriteData(hRequest, data + offset, chunk, &written) || written == 0) {
+                WinHttpCloseHandle(hRequest);
+                result.error = "Upload interrupted";
+                return result;
+            }
+            if (part.hasher) {
+                part.hasher->Update(data + offset, written);
+            }
+            offset += written;
+        }
+    }
+    phase = LatencyStats::RecordSince(LatencyStage::RelaySend, phase);
+
     if (!WinHttpReceiveResponse(hRequest, nullptr)) {
         WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
         result.error = "No response from Relay";
         return result;
     }
+    phase = LatencyStats::RecordSince(LatencyStage::RelayFirstByte, phase);
 
     // Get status code
     DWORD statusCode = 0;
@@ -160,8 +310,10 @@ RelayResponse RelayClient::SendRequest(
         WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
         WINHTTP_HEADER_NAME_BY_INDEX, &statusCode, &size, WINHTTP_NO_HEADER_INDEX);
     result.statusCode = (int)statusCode;
+    result.retryAfterSeconds = QueryRetryAfter(hRequest);
 
-    // Read response body
+    // Read response body — draining it returns the connection to the
+    // keep-alive pool for the next request
     std::string responseBody;
     DWORD bytesAvailable = 0;
     while (WinHttpQueryDataAvailable(hRequest, &bytesAvailable) && bytesAvailable > 0) {
@@ -172,16 +324,19 @@ RelayResponse RelayClient::SendRequest(
     }
     result.body = responseBody;
     result.success = true;
+    LatencyStats::RecordSince(LatencyStage::RelayBody, phase);
 
     WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
     return result;
 }
 
-std::string RelayClient::BuildMultipartBody(
-    const std::wstring& pdfPath,
+void RelayClient::BuildMultipartFraming(
+    std::wstring_view pdfPath,
     const std::string& userEmail,
-    std::string& boundary
+    const InvoiceFields& fields,
+    std::string& boundary,
+    std::string& preamble,
+    std::string& epilogue
 ) {
     // Generate random boundary
     std::random_device rd;
@@ -193,60 +348,343 @@ std::string RelayClient::BuildMultipartBody(
         boundary += hex[dis(gen)];
     }
 
-    // Read PDF file
-    std::ifstream file(pdfPath, std::ios::binary);
-    if (!file.is_open()) return "";
+    Utf8Filename filename(pdfPath);
+    preamble.clear();
+    preamble.reserve(512 + userEmail.size() + filename.View().size());
+
+    // Field: source
+    preamble += "--" + boundary + "\r\n";
+    preamble += "Content-Disposition: form-data; name=\"source\"\r\n\r\n";
+    preamble += "transforma_reader\r\n";
 
-    std::vector<char> pdfData((std::istreambuf_iterator<char>(file)),
-                               std::istreambuf_iterator<char>());
-    file.close();
+    // Field: user
+    preamble += "--" + boundary + "\r\n";
+    preamble += "Content-Disposition: form-data; name=\"user\"\r\n\r\n";
+    preamble += userEmail + "\r\n";
+
+    // Fields: tin, invoice_number, total_amount — pre-extracted, so Core can
+    // skip parsing the PDF; omitted when not found
+    auto addField = [&](const char* name, const std::string& value) {
+        if (value.empty()) return;
+        preamble += "--" + boundary + "\r\n";
+        preamble += std::string("Content-Disposition: form-data; name=\"") + name + "\"\r\n\r\n";
+        preamble += value + "\r\n";
+    };
+    addField("tin", fields.tin);
+    addField("invoice_number", fields.invoiceNumber);
+    addField("total_amount", fields.totalAmount);
+
+    // Field: file (PDF binary follows)
+    preamble += "--" + boundary + "\r\n";
+    preamble += "Content-Disposition: form-data; name=\"file\"; filename=\"";
+    preamble += filename.View();
+    preamble += "\"\r\n";
+    preamble += "Content-Type: application/pdf\r\n\r\n";
+
+    // End of file part, end boundary
+    epilogue = "\r\n--" + boundary + "--\r\n";
+}
 
-    // Extract filename from path
-    std::string filename = WideToUtf8(pdfPath);
-    size_t lastSlash = filename.find_last_of("\\/");
-    if (lastSlash != std::string::npos) {
-        filename = filename.substr(lastSlash + 1);
+// ── Async submission ──────────────────────────────────────────
+// Prepare (thread pool) → SendRequest → WriteData per chunk → ReceiveResponse
+// → QueryDataAvailable/ReadData until drained → close. Every path ends by
+// closing the request handle; HANDLE_CLOSING, the last callback WinHTTP
+// makes, delivers the result.
+
+std::shared_ptr<SubmitOperation> RelayClient::SubmitInvoiceAsync(
+    const std::wstring& pdfPath,
+    const std::string& userEmail,
+    const std::string& sessionToken,
+    const ContentCheck& contentCheck,
+    const UploadProgress& onProgress,
+    const SubmitCompletion& onComplete,
+    const InvoiceFields& fields
+) {
+    std::shared_ptr<SubmitOperation> op(new SubmitOperation());
+    op->m_client = this;
+    op->m_pdfPath = pdfPath;
+    op->m_userEmail = userEmail;
+    op->m_sessionToken = sessionToken;
+    op->m_fields = fields;
+    op->m_contentCheck = contentCheck;
+    op->m_onProgress = onProgress;
+    op->m_onComplete = onComplete;
+    op->m_self = op;
+
+    // Mapping and hashing can stall on a network share — keep them off the
+    // caller's (UI) thread
+    if (!TrySubmitThreadpoolCallback(&SubmitOperation::PrepareCallback, op.get(), nullptr)) {
+        op->m_self.reset();
+        return nullptr;
     }
+    return op;
+}
 
-    std::ostringstream body;
+SubmitOperation::SubmitOperation() {
+    m_hDone = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+}
 
-    // Field: source
-    body << "--" << boundary << "\r\n";
-    body << "Content-Disposition: form-data; name=\"source\"\r\n\r\n";
-    body << "transforma_reader\r\n";
+SubmitOperation::~SubmitOperation() {
+    if (m_hDone) {
+        CloseHandle(m_hDone);
+    }
+}
 
-    // Field: user
-    body << "--" << boundary << "\r\n";
-    body << "Content-Disposition: form-data; name=\"user\"\r\n\r\n";
-    body << userEmail << "\r\n";
+void SubmitOperation::Cancel() {
+    m_cancelled = true;
+    Close();
+}
 
-    // Field: file (PDF binary)
-    body << "--" << boundary << "\r\n";
-    body << "Content-Disposition: form-data; name=\"file\"; filename=\"" << filename << "\"\r\n";
-    body << "Content-Type: application/pdf\r\n\r\n";
-    body.write(pdfData.data(), pdfData.size());
-    body << "\r\n";
+void SubmitOperation::Wait() {
+    if (m_hDone) {
+        WaitForSingleObject(m_hDone, INFINITE);
+    }
+}
 
-    // End boundary
-    body << "--" << boundary << "--\r\n";
+void CALLBACK SubmitOperation::PrepareCallback(PTP_CALLBACK_INSTANCE, PVOID context) {
+    std::shared_ptr<SubmitOperation> op = ((SubmitOperation*)context)->shared_from_this();
+    op->Prepare();
+}
 
-    return body.str();
+void SubmitOperation::Prepare() {
+    if (m_cancelled ||
+        !m_client->PrepareUpload(m_pdfPath, m_userEmail, m_contentCheck, m_fields, m_upload, m_result)) {
+        Finish();
+        return;
+    }
+
+    m_phaseStart = LatencyStats::Now();
+    m_connection = m_client->AcquireConnection(true, m_result.error);
+    if (!m_connection) {
+        Finish();
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    if (m_cancelled) {
+        Finish();
+        return;
+    }
+
+    m_hRequest = WinHttpOpenRequest(
+        (HINTERNET)m_connection.get(), L"POST", L"/api/ingest",
+        nullptr, WINHTTP_NO_REFERER,
+        WINHTTP_DEFAULT_ACCEPT_TYPES, 0
+    );
+    if (!m_hRequest) {
+        m_result.error = "Failed to create HTTP request";
+        Finish();
+        return;
+    }
+
+    // On the handle itself, not just WinHttpSendRequest's dwContext: if that
+    // call fails synchronously, HANDLE_CLOSING must still find us to Finish()
+    DWORD_PTR context = (DWORD_PTR)this;
+    WinHttpSetOption(m_hRequest, WINHTTP_OPTION_CONTEXT_VALUE, &context, sizeof(context));
+    WinHttpSetStatusCallback(m_hRequest, &SubmitOperation::StatusCallback,
+                             WINHTTP_CALLBACK_FLAG_ALL_COMPLETIONS | WINHTTP_CALLBACK_FLAG_HANDLES, 0);
+
+    // Same limits as the synchronous path
+    WinHttpSetTimeouts(m_hRequest, 5000, 30000, 30000, 30000);
+    m_phaseStart = LatencyStats::RecordSince(LatencyStage::RelayConnect, m_phaseStart);
+
+    std::wstring ctHeader = L"Content-Type: " + Utf8ToWide(m_upload.contentType);
+    WinHttpAddRequestHeaders(m_hRequest, ctHeader.c_str(), (DWORD)-1, WINHTTP_ADDREQ_FLAG_ADD);
+    if (!m_sessionToken.empty()) {
+        std::wstring authHeader = L"Authorization: Bearer " + Utf8ToWide(m_sessionToken);
+        WinHttpAddRequestHeaders(m_hRequest, authHeader.c_str(), (DWORD)-1, WINHTTP_ADDREQ_FLAG_ADD);
+    }
+
+    if (!WinHttpSendRequest(m_hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+                            WINHTTP_NO_REQUEST_DATA, 0,
+                            (DWORD)m_upload.totalLength, (DWORD_PTR)this)) {
+        Fail("Failed to send request (is Relay running?)", true);
+    }
 }
 
-std::string RelayClient::WideToUtf8(const std::wstring& wide) {
-    if (wide.empty()) return "";
-    int size = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), (int)wide.size(), nullptr, 0, nullptr, nullptr);
-    std::string result(size, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), (int)wide.size(), &result[0], size, nullptr, nullptr);
-    return result;
+void CALLBACK SubmitOperation::StatusCallback(HINTERNET, DWORD_PTR context, DWORD status,
+                                              LPVOID info, DWORD infoLength) {
+    auto raw = (SubmitOperation*)context;
+    if (!raw) return;
+
+    // Keep the operation alive for this callback even if it finishes inside it
+    std::shared_ptr<SubmitOperation> op = raw->m_self;
+    if (!op) return;
+
+    switch (status) {
+    case WINHTTP_CALLBACK_STATUS_SENDREQUEST_COMPLETE:
+        op->WriteNext();
+        break;
+    case WINHTTP_CALLBACK_STATUS_WRITE_COMPLETE:
+        op->OnWritten(*(const DWORD*)info);
+        break;
+    case WINHTTP_CALLBACK_STATUS_HEADERS_AVAILABLE:
+        op->OnHeaders();
+        break;
+    case WINHTTP_CALLBACK_STATUS_DATA_AVAILABLE:
+        op->OnDataAvailable(*(const DWORD*)info);
+        break;
+    case WINHTTP_CALLBACK_STATUS_READ_COMPLETE:
+        op->OnRead(infoLength);
+        break;
+    case WINHTTP_CALLBACK_STATUS_REQUEST_ERROR:
+        op->OnError(*(const WINHTTP_ASYNC_RESULT*)info);
+        break;
+    case WINHTTP_CALLBACK_STATUS_HANDLE_CLOSING:
+        op->Finish();
+        break;
+    }
 }
 
-std::wstring RelayClient::Utf8ToWide(const std::string& utf8) {
-    if (utf8.empty()) return L"";
-    int size = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), (int)utf8.size(), nullptr, 0);
-    std::wstring result(size, 0);
-    MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), (int)utf8.size(), &result[0], size);
-    return result;
+void SubmitOperation::WriteNext() {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    if (!m_hRequest) return;
+
+    while (m_part < m_upload.parts.size() && m_partOffset >= m_upload.parts[m_part].size) {
+        m_part++;
+        m_partOffset = 0;
+    }
+
+    if (m_part == m_upload.parts.size()) {
+        m_phaseStart = LatencyStats::RecordSince(LatencyStage::RelaySend, m_phaseStart);
+        if (!WinHttpReceiveResponse(m_hRequest, nullptr)) {
+            Fail("No response from Relay");
+        }
+        return;
+    }
+
+    const BodyPart& part = m_upload.parts[m_part];
+    uint64_t remaining = part.size - m_partOffset;
+    DWORD chunk = (DWORD)(remaining < kWriteChunk ? remaining : kWriteChunk);
+    if (!WinHttpWriteData(m_hRequest, (const uint8_t*)part.data + m_partOffset, chunk, nullptr)) {
+        Fail("Upload interrupted");
+    }
+}
+
+void SubmitOperation::OnWritten(DWORD written) {
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+        const BodyPart& part = m_upload.parts[m_part];
+        if (part.hasher) {
+            part.hasher->Update((const uint8_t*)part.data + m_partOffset, written);
+        }
+        m_partOffset += written;
+        m_sent += written;
+    }
+
+    if (m_onProgress) {
+        m_onProgress(m_sent, m_upload.totalLength);
+    }
+    WriteNext();
+}
+
+void SubmitOperation::OnHeaders() {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    if (!m_hRequest) return;
+    m_phaseStart = LatencyStats::RecordSince(LatencyStage::RelayFirstByte, m_phaseStart);
+
+    DWORD statusCode = 0;
+    DWORD size = sizeof(statusCode);
+    WinHttpQueryHeaders(m_hRequest,
+        WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+        WINHTTP_HEADER_NAME_BY_INDEX, &statusCode, &size, WINHTTP_NO_HEADER_INDEX);
+    m_response.statusCode = (int)statusCode;
+    m_response.retryAfterSeconds = QueryRetryAfter(m_hRequest);
+
+    if (!WinHttpQueryDataAvailable(m_hRequest, nullptr)) {
+        Fail("No response from Relay");
+    }
+}
+
+void SubmitOperation::OnDataAvailable(DWORD available) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    if (!m_hRequest) return;
+
+    if (available == 0) {
+        OnRead(0);
+        return;
+    }
+    m_readBuffer.resize(available);
+    if (!WinHttpReadData(m_hRequest, m_readBuffer.data(), available, nullptr)) {
+        Fail("No response from Relay");
+    }
+}
+
+void SubmitOperation::OnRead(DWORD bytesRead) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    if (!m_hRequest) return;
+
+    if (bytesRead > 0) {
+        m_response.body.append(m_readBuffer.data(), bytesRead);
+        if (!WinHttpQueryDataAvailable(m_hRequest, nullptr)) {
+            Fail("No response from Relay");
+        }
+        return;
+    }
+
+    // Drained — the connection goes back to the keep-alive pool
+    m_response.success = true;
+    LatencyStats::RecordSince(LatencyStage::RelayBody, m_phaseStart);
+    m_client->m_health.ReportReachable();
+    if (m_upload.hashWhileSending) {
+        m_result.contentHash = m_upload.hasher.Final();
+    }
+    RelayClient::ParseSubmitResponse(m_response, m_result);
+    Close();
+}
+
+void SubmitOperation::OnError(const WINHTTP_ASYNC_RESULT& error) {
+    switch (error.dwResult) {
+    case API_SEND_REQUEST:      Fail("Failed to send request (is Relay running?)", true); break;
+    case API_WRITE_DATA:        Fail("Upload interrupted"); break;
+    default:                    Fail("No response from Relay"); break;
+    }
+}
+
+void SubmitOperation::Fail(const std::string& error, bool unreachable) {
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+        if (m_result.error.empty()) {
+            m_result.error = error;
+            m_result.unreachable = unreachable;
+        }
+    }
+    if (unreachable && !m_cancelled) {
+        m_client->m_health.ReportUnreachable();
+    }
+    Close();
+}
+
+void SubmitOperation::Close() {
+    // Exactly once, whoever gets here first (completion, error or Cancel)
+    HINTERNET hRequest;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+        hRequest = m_hRequest;
+        m_hRequest = nullptr;
+    }
+    if (hRequest) {
+        WinHttpCloseHandle(hRequest);
+    }
+}
+
+void SubmitOperation::Finish() {
+    if (!m_result.success && m_cancelled) {
+        m_result.cancelled = true;
+        m_result.error = "Submission cancelled";
+        m_result.unreachable = false;
+    }
+    m_connection.reset();
+    m_upload.pdf.Close();
+
+    SubmitCompletion onComplete = std::move(m_onComplete);
+    if (onComplete) {
+        onComplete(m_result);
+    }
+    SetEvent(m_hDone);
+
+    // Last: may release the final reference
+    std::shared_ptr<SubmitOperation> self = std::move(m_self);
 }
 
 } // namespace Helium
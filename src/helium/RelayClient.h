@@ -4,10 +4,20 @@
 
 #pragma once
 
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "InvoiceFields.h"
+#include "RelayHealthMonitor.h"
 #include <windows.h>
 #include <winhttp.h>
 #include <string>
+#include <string_view>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
 
 #pragma comment(lib, "winhttp.lib")
 
@@ -18,6 +28,8 @@ struct RelayResponse {
     std::string body;
     std::string error;
     bool success = false;
+    int retryAfterSeconds = 0;  // Retry-After on 429/503, if given in seconds
+    bool unreachable = false;   // Couldn't connect or send the request at all
 };
 
 struct SubmitResult {
@@ -26,6 +38,105 @@ struct SubmitResult {
     std::string fileUuid;
     std::string error;
     int httpStatus = 0;
+    uint64_t contentHash = 0;    // XXH64 of the PDF, hashed while it was read for upload
+    bool blocked = false;        // ContentCheck vetoed the upload; nothing was sent
+    bool cancelled = false;      // SubmitOperation::Cancel() stopped it
+    int retryAfterSeconds = 0;   // 429 with Retry-After: throttled, not over the daily limit
+    bool unreachable = false;    // Relay wasn't there (or known to be down); nothing was delivered
+};
+
+// Called with the document's content hash once the file has been read,
+// before anything is sent. Return false to cancel the upload.
+using ContentCheck = std::function<bool(uint64_t contentHash)>;
+
+// Bytes of the request body sent so far, out of total
+using UploadProgress = std::function<void(uint64_t sent, uint64_t total)>;
+
+using SubmitCompletion = std::function<void(const SubmitResult& result)>;
+
+// One piece of a request body. Parts are sent in order with
+// WinHttpWriteData, so large ones go straight from a mapped view.
+struct BodyPart {
+    const void* data;
+    uint64_t size;
+    ContentHasher* hasher = nullptr;    // Hashes the bytes as they are sent
+};
+
+// A PDF upload, ready to send: the mapped file between its multipart framing
+struct UploadBody {
+    MappedFile pdf;
+    ContentHasher hasher;
+    bool hashWhileSending = false;      // No ContentCheck — hash isn't final until sent
+    std::string contentType;
+    std::string preamble;
+    std::string epilogue;
+    std::vector<BodyPart> parts;
+    uint64_t totalLength = 0;
+};
+
+class RelayClient;
+
+// An upload started by SubmitInvoiceAsync. Driven entirely by WinHTTP's
+// async callbacks — no thread waits on the network. Callbacks run on
+// WinHTTP / thread-pool threads; the completion runs exactly once, also
+// after Cancel().
+class SubmitOperation : public std::enable_shared_from_this<SubmitOperation> {
+public:
+    ~SubmitOperation();
+
+    SubmitOperation(const SubmitOperation&) = delete;
+    SubmitOperation& operator=(const SubmitOperation&) = delete;
+
+    // Abort wherever it is (reading, uploading, awaiting the response)
+    void Cancel();
+
+    // Block until the completion callback has returned. Not from inside it.
+    void Wait();
+
+private:
+    friend class RelayClient;
+    SubmitOperation();
+
+    RelayClient* m_client = nullptr;
+    std::wstring m_pdfPath;
+    std::string m_userEmail;
+    std::string m_sessionToken;
+    InvoiceFields m_fields;
+    ContentCheck m_contentCheck;
+    UploadProgress m_onProgress;
+    SubmitCompletion m_onComplete;
+
+    // Held while WinHTTP may still call back; dropped on HANDLE_CLOSING
+    std::shared_ptr<SubmitOperation> m_self;
+    std::recursive_mutex m_mutex;       // WinHTTP may call back inline
+    HINTERNET m_hRequest = nullptr;
+    std::shared_ptr<void> m_connection;
+    std::atomic<bool> m_cancelled{false};
+    HANDLE m_hDone = nullptr;
+
+    UploadBody m_upload;
+    size_t m_part = 0;
+    uint64_t m_partOffset = 0;
+    uint64_t m_sent = 0;
+    int64_t m_phaseStart = 0;           // QPC ticks; start of the current latency phase
+
+    RelayResponse m_response;
+    std::vector<char> m_readBuffer;
+    SubmitResult m_result;
+
+    static void CALLBACK PrepareCallback(PTP_CALLBACK_INSTANCE instance, PVOID context);
+    static void CALLBACK StatusCallback(HINTERNET hRequest, DWORD_PTR context, DWORD status,
+                                        LPVOID info, DWORD infoLength);
+    void Prepare();
+    void WriteNext();
+    void OnWritten(DWORD written);
+    void OnHeaders();
+    void OnDataAvailable(DWORD available);
+    void OnRead(DWORD bytesRead);
+    void OnError(const WINHTTP_ASYNC_RESULT& error);
+    void Fail(const std::string& error, bool unreachable = false);
+    void Close();
+    void Finish();
 };
 
 class RelayClient {
@@ -39,37 +150,106 @@ public:
     // Submit a PDF invoice to Relay for FIRS processing
     // Calls: POST /api/ingest
     // Content-Type: multipart/form-data
-    // Fields: file (PDF binary), source ("transforma_reader"), user (email)
+    // Fields: file (PDF binary), source ("transforma_reader"), user (email),
+    // and tin / invoice_number / total_amount for those found on page 1
+    // The PDF is streamed from a mapped view — memory use doesn't grow with it.
+    // fields from routing are sent as given; unscanned ones are extracted
+    // here first.
     SubmitResult SubmitInvoice(
         const std::wstring& pdfPath,
         const std::string& userEmail,
-        const std::string& sessionToken
+        const std::string& sessionToken,
+        const ContentCheck& contentCheck = nullptr,
+        const InvoiceFields& fields = InvoiceFields()
+    );
+
+    // Same request, without blocking the caller. File access, hashing and
+    // the check run on the thread pool, the upload on WinHTTP's async I/O.
+    // onProgress and onComplete may be null. onComplete runs on a pool
+    // thread and can run before this returns (a cancelled, blocked or
+    // unreadable upload fails in the prepare step): callers that keep the
+    // handle must serialize storing it against onComplete themselves. If
+    // the operation can't be started at all, returns nullptr and onComplete
+    // is not called.
+    std::shared_ptr<SubmitOperation> SubmitInvoiceAsync(
+        const std::wstring& pdfPath,
+        const std::string& userEmail,
+        const std::string& sessionToken,
+        const ContentCheck& contentCheck,
+        const UploadProgress& onProgress,
+        const SubmitCompletion& onComplete,
+        const InvoiceFields& fields = InvoiceFields()
     );
 
-    // Check if Relay is reachable (GET /health)
-    bool IsRelayAvailable();
+    // Check if Relay is reachable (GET /health). timeoutMs bounds each
+    // phase of the request; 0 keeps the submit limits.
+    bool IsRelayAvailable(DWORD timeoutMs = 0);
+
+    // Background reachability. Once started, submissions fail fast with
+    // result.unreachable while Relay is known to be down.
+    RelayHealthMonitor& Health() { return m_health; }
+
+    // Multipart text around the file part: preamble ends with the file
+    // part's headers, epilogue closes it and the body. The PDF itself is
+    // never copied into it.
+    static void BuildMultipartFraming(
+        std::wstring_view pdfPath,
+        const std::string& userEmail,
+        const InvoiceFields& fields,
+        std::string& boundary,
+        std::string& preamble,
+        std::string& epilogue
+    );
 
 private:
+    friend class SubmitOperation;
+
     std::wstring m_host = L"localhost";
     int m_port = 8082;
-    HINTERNET m_hSession = nullptr;
+
+    // Opened on first request, not at construction, so proxy setup stays
+    // off the startup path. Requests share one connect handle, letting
+    // WinHTTP keep the TCP connection to Relay alive between them.
+    // In-flight requests hold their own reference across SetEndpoint.
+    // Async requests need a session opened with WINHTTP_FLAG_ASYNC.
+    struct SessionSlot {
+        std::shared_ptr<void> session;
+        bool direct = false;            // Opened without a proxy (loopback Relay)
+        std::shared_ptr<void> connection;
+    };
+    std::mutex m_handleMutex;
+    SessionSlot m_sync;
+    SessionSlot m_async;
+
+    // Last member: its prober is stopped before the handles above go away
+    RelayHealthMonitor m_health{*this};
+
+    std::shared_ptr<void> AcquireConnection(bool async, std::string& error);
+    static bool IsLoopbackHost(const std::wstring& host);
 
     RelayResponse SendRequest(
         const std::wstring& method,
         const std::wstring& path,
-        const std::string& body,
+        const std::vector<BodyPart>& body,
         const std::string& contentType,
-        const std::string& authToken
+        const std::string& authToken,
+        DWORD timeoutMs = 0
     );
 
-    std::string BuildMultipartBody(
+    // Map the PDF, run the check, extract unscanned fields and lay out the
+    // multipart body. Returns false with result.error (or result.blocked) set,
+    // and with result.unreachable when Relay is known to be down.
+    bool PrepareUpload(
         const std::wstring& pdfPath,
         const std::string& userEmail,
-        std::string& boundary
+        const ContentCheck& contentCheck,
+        const InvoiceFields& fields,
+        UploadBody& upload,
+        SubmitResult& result
     );
 
-    static std::string WideToUtf8(const std::wstring& wide);
-    static std::wstring Utf8ToWide(const std::string& utf8);
+    // Fill in result from Relay's /api/ingest reply
+    static void ParseSubmitResponse(const RelayResponse& resp, SubmitResult& result);
 };
 
 } // namespace Helium
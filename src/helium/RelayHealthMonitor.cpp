@@ -0,0 +1,110 @@
+// RelayHealthMonitor.cpp — Background Relay reachability with adaptive probing
+
+#include "RelayHealthMonitor.h"
+#include "RelayClient.h"
+#include <chrono>
+
+namespace Helium {
+
+// Relay is on loopback: a live one answers /health in milliseconds, so a
+// short limit only cuts off the wait when it isn't there
+static const DWORD kProbeTimeoutMs = 1500;
+
+// Healthy: an occasional check that Float is still running
+static const DWORD kHealthyIntervalMs = 30000;
+
+// Down: retry quickly at first, backing off while Float stays stopped
+static const DWORD kDownFirstIntervalMs = 1000;
+static const DWORD kDownMaxIntervalMs = 8000;
+
+RelayHealthMonitor::RelayHealthMonitor(RelayClient& relay) : m_relay(relay) {}
+
+RelayHealthMonitor::~RelayHealthMonitor() {
+    Stop();
+}
+
+void RelayHealthMonitor::Start(const RelayHealthCallback& onChange) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) return;
+        m_running = true;
+        m_probeSoon = false;
+    }
+    m_onChange = onChange;
+
+    Probe();
+    m_thread = std::thread(&RelayHealthMonitor::ProbeLoop, this);
+}
+
+void RelayHealthMonitor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_state.store(RelayHealth::Unknown, std::memory_order_release);
+}
+
+void RelayHealthMonitor::ReportReachable() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+    }
+    Publish(RelayHealth::Reachable);
+}
+
+void RelayHealthMonitor::ReportUnreachable() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        m_probeSoon = true;
+    }
+    Publish(RelayHealth::Unreachable);
+    m_wake.notify_one();
+}
+
+void RelayHealthMonitor::ProbeLoop() {
+    DWORD downIntervalMs = kDownFirstIntervalMs;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        DWORD intervalMs = State() == RelayHealth::Unreachable ? downIntervalMs : kHealthyIntervalMs;
+        m_wake.wait_for(lock, std::chrono::milliseconds(intervalMs),
+                        [this] { return !m_running || m_probeSoon; });
+        if (!m_running) break;
+
+        // A reported failure restarts the backoff from the short end
+        if (m_probeSoon) {
+            downIntervalMs = kDownFirstIntervalMs;
+            m_probeSoon = false;
+        }
+
+        lock.unlock();
+        bool reachable = Probe();
+        lock.lock();
+
+        if (reachable) {
+            downIntervalMs = kDownFirstIntervalMs;
+        } else if (intervalMs == downIntervalMs) {
+            downIntervalMs = downIntervalMs * 2 < kDownMaxIntervalMs ? downIntervalMs * 2 : kDownMaxIntervalMs;
+        }
+    }
+}
+
+bool RelayHealthMonitor::Probe() {
+    bool reachable = m_relay.IsRelayAvailable(kProbeTimeoutMs);
+    Publish(reachable ? RelayHealth::Reachable : RelayHealth::Unreachable);
+    return reachable;
+}
+
+void RelayHealthMonitor::Publish(RelayHealth state) {
+    RelayHealth was = m_state.exchange(state, std::memory_order_acq_rel);
+    if (was != state && m_onChange) {
+        m_onChange(state == RelayHealth::Reachable);
+    }
+}
+
+} // namespace Helium
@@ -0,0 +1,75 @@
+// RelayHealthMonitor.h — Background Relay reachability with adaptive probing
+// Owns the answer to "is Float running?" so nothing on the UI or submit path
+// has to wait out a connect timeout to find out. A background thread probes
+// GET /health over the kept-alive connection with short timeouts: often
+// while Relay is down (so recovery is noticed quickly), rarely while it is
+// up. Real requests feed their outcome back as free probes.
+
+#pragma once
+
+#include <windows.h>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+namespace Helium {
+
+class RelayClient;
+
+enum class RelayHealth {
+    Unknown,        // Not probed yet (or the monitor isn't running)
+    Reachable,
+    Unreachable
+};
+
+// Reachability changed. Runs on the thread that noticed: the monitor's,
+// Start()'s caller for the first probe, or a request's completion thread.
+using RelayHealthCallback = std::function<void(bool reachable)>;
+
+class RelayHealthMonitor {
+public:
+    explicit RelayHealthMonitor(RelayClient& relay);
+    ~RelayHealthMonitor();
+
+    RelayHealthMonitor(const RelayHealthMonitor&) = delete;
+    RelayHealthMonitor& operator=(const RelayHealthMonitor&) = delete;
+
+    // Probe once on the calling thread, then keep probing in the background
+    void Start(const RelayHealthCallback& onChange);
+
+    // Stop and join the prober. Safe to call when not started.
+    void Stop();
+
+    // Lock-free; never touches the network
+    RelayHealth State() const { return m_state.load(std::memory_order_acquire); }
+
+    // Unknown counts as reachable — the request itself finds out
+    bool IsReachable() const { return State() != RelayHealth::Unreachable; }
+
+    // A request got an HTTP response from Relay
+    void ReportReachable();
+
+    // A request couldn't connect or send: mark Relay down at once and
+    // re-probe soon. Ignored while the monitor isn't running, so nothing
+    // gets stuck "down" with no prober to bring it back.
+    void ReportUnreachable();
+
+private:
+    RelayClient& m_relay;
+    RelayHealthCallback m_onChange;
+    std::atomic<RelayHealth> m_state{RelayHealth::Unknown};
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+    bool m_running = false;
+    bool m_probeSoon = false;
+
+    void ProbeLoop();
+    bool Probe();
+    void Publish(RelayHealth state);
+};
+
+} // namespace Helium
@@ -0,0 +1,143 @@
+// RouteCache.cpp — Persistent cache of content-routing decisions
+
+#include "RouteCache.h"
+#include "InvoiceRouter.h"
+#include "ContentHash.h"
+#include <cstring>
+
+namespace Helium {
+
+// 8192 slots = 1 MB; a clerk's working set of reopened invoices is far smaller
+static const uint32_t kSlotCount = 8192;
+
+RouteCache::RouteCache() {}
+
+bool RouteCache::Open(const std::wstring& path) {
+    Close();
+
+    uint64_t size = sizeof(RouteCacheHeader) + (uint64_t)kSlotCount * sizeof(RouteCacheSlot);
+    if (!m_file.OpenWritable(path, size)) {
+        // First run on this machine — create the cache directory
+        std::wstring dir = path.substr(0, path.find_last_of(L"\\/"));
+        CreateDirectoryW(dir.c_str(), nullptr);
+        if (!m_file.OpenWritable(path, size)) return false;
+    }
+
+    RouteCacheHeader expected;
+    expected.slotCount = kSlotCount;
+
+    auto header = (RouteCacheHeader*)m_file.WritableData();
+    if (header->magic != expected.magic || header->version != expected.version ||
+        header->slotCount != expected.slotCount) {
+        // New (zero-filled) file or an older layout — start empty
+        memset(m_file.WritableData(), 0, (size_t)size);
+        *header = expected;
+    }
+
+    m_slots = (RouteCacheSlot*)(m_file.WritableData() + sizeof(RouteCacheHeader));
+    m_slotMask = kSlotCount - 1;
+    return true;
+}
+
+void RouteCache::Close() {
+    m_slots = nullptr;
+    m_slotMask = 0;
+    m_file.Close();
+}
+
+bool RouteCache::MakeKey(const std::wstring& path, FileKey& key) {
+    WIN32_FILE_ATTRIBUTE_DATA attrs;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attrs)) {
+        return false;
+    }
+    key.fileSize = ((uint64_t)attrs.nFileSizeHigh << 32) | attrs.nFileSizeLow;
+    key.writeTime = ((uint64_t)attrs.ftLastWriteTime.dwHighDateTime << 32) |
+                    attrs.ftLastWriteTime.dwLowDateTime;
+
+    // Windows paths are case-insensitive
+    std::wstring folded = path;
+    CharUpperBuffW(&folded[0], (DWORD)folded.size());
+    ContentHasher hasher;
+    hasher.Update(folded.data(), folded.size() * sizeof(wchar_t));
+    key.pathHash = hasher.Final();
+    return true;
+}
+
+bool RouteCache::Lookup(const FileKey& key, uint64_t patternVersion, RouteResult& result) const {
+    if (!m_slots) return false;
+
+    uint32_t start = (uint32_t)key.pathHash & m_slotMask;
+    for (uint32_t i = 0; i < kProbe; i++) {
+        const RouteCacheSlot& slot = m_slots[(start + i) & m_slotMask];
+        if (slot.pathHash != key.pathHash) continue;
+
+        // Copy out, then confirm no writer touched the slot meanwhile
+        LONG before = ReadAcquire(&slot.sequence);
+        if (before & 1) return false;
+        RouteCacheSlot copy;
+        memcpy(&copy, (const void*)&slot, sizeof(copy));
+        MemoryBarrier();
+        if (slot.sequence != before) return false;
+
+        if (copy.pathHash != key.pathHash || copy.fileSize != key.fileSize ||
+            copy.writeTime != key.writeTime || copy.patternVersion != patternVersion) {
+            return false;  // Edited file or edited patterns — route again
+        }
+
+        result.decision = (RouteDecision)copy.decision;
+        result.matchedPattern.assign(copy.matchedPattern, copy.matchedLength < sizeof(copy.matchedPattern)
+                                                              ? copy.matchedLength : sizeof(copy.matchedPattern));
+        result.clientHint.assign(copy.clientHint, copy.hintLength < sizeof(copy.clientHint)
+                                                      ? copy.hintLength : sizeof(copy.clientHint));
+        result.confidenceScore = copy.confidence;
+        return true;
+    }
+    return false;
+}
+
+void RouteCache::Store(const FileKey& key, uint64_t patternVersion, const RouteResult& result) {
+    if (!m_slots) return;
+
+    // Same file's slot, else an empty one, else evict one of the probe set
+    uint32_t start = (uint32_t)key.pathHash & m_slotMask;
+    RouteCacheSlot* target = nullptr;
+    for (uint32_t i = 0; i < kProbe && !target; i++) {
+        RouteCacheSlot& slot = m_slots[(start + i) & m_slotMask];
+        if (slot.pathHash == key.pathHash) target = &slot;
+    }
+    for (uint32_t i = 0; i < kProbe && !target; i++) {
+        RouteCacheSlot& slot = m_slots[(start + i) & m_slotMask];
+        if (slot.pathHash == 0) target = &slot;
+    }
+    if (!target) {
+        target = &m_slots[(start + (uint32_t)(key.pathHash >> 32) % kProbe) & m_slotMask];
+    }
+
+    // Claim the slot (odd sequence); if another process holds it, its
+    // write is as good as ours
+    LONG sequence = ReadAcquire(&target->sequence);
+    if ((sequence & 1) || InterlockedCompareExchange(&target->sequence, sequence + 1, sequence) != sequence) {
+        return;
+    }
+
+    target->pathHash = key.pathHash;
+    target->fileSize = key.fileSize;
+    target->writeTime = key.writeTime;
+    target->patternVersion = patternVersion;
+    target->decision = (uint8_t)result.decision;
+    target->confidence = (float)result.confidenceScore;
+
+    size_t matched = result.matchedPattern.size() < sizeof(target->matchedPattern)
+                         ? result.matchedPattern.size() : sizeof(target->matchedPattern);
+    memcpy(target->matchedPattern, result.matchedPattern.data(), matched);
+    target->matchedLength = (uint8_t)matched;
+
+    size_t hint = result.clientHint.size() < sizeof(target->clientHint)
+                      ? result.clientHint.size() : sizeof(target->clientHint);
+    memcpy(target->clientHint, result.clientHint.data(), hint);
+    target->hintLength = (uint8_t)hint;
+
+    InterlockedExchange(&target->sequence, sequence + 2);
+}
+
+} // namespace Helium
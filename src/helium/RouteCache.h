@@ -0,0 +1,84 @@
+// RouteCache.h — Persistent cache of content-routing decisions
+// A fixed-size hash table in a mapped file, keyed on the PDF's path, size,
+// last-write time and the pattern set it was routed with. A reopened
+// invoice is routed without reading a byte of it.
+
+#pragma once
+
+#include "MappedFile.h"
+#include <string>
+#include <cstdint>
+
+namespace Helium {
+
+struct RouteResult;
+
+// File layout: [RouteCacheHeader][RouteCacheSlot x slotCount]
+#pragma pack(push, 1)
+struct RouteCacheHeader {
+    uint32_t magic = 0x43545248;     // "HRTC"
+    uint32_t version = 1;            // Bump when routing logic changes meaning
+    uint32_t slotCount = 0;
+    uint32_t reserved = 0;
+};
+
+struct RouteCacheSlot {
+    // Even = stable, odd = being written. Shared across processes, so
+    // updated with interlocked operations on the mapped view.
+    volatile LONG sequence;
+    uint32_t reserved;
+    uint64_t pathHash;               // 0 = empty
+    uint64_t fileSize;
+    uint64_t writeTime;              // FILETIME
+    uint64_t patternVersion;
+    uint8_t decision;                // RouteDecision
+    uint8_t matchedLength;
+    uint8_t hintLength;
+    uint8_t pad;
+    float confidence;
+    char matchedPattern[64];         // Truncated — diagnostics only
+    char clientHint[16];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(RouteCacheSlot) == 128, "RouteCacheSlot is part of the file format");
+
+class RouteCache {
+public:
+    RouteCache();
+
+    RouteCache(const RouteCache&) = delete;
+    RouteCache& operator=(const RouteCache&) = delete;
+
+    // Map (or create) the cache file. A file from another version is reset.
+    bool Open(const std::wstring& path);
+
+    void Close();
+
+    bool IsOpen() const { return m_slots != nullptr; }
+
+    // Identify a file for lookup: its size and last-write time, one metadata
+    // query (no read). Returns false if the file can't be stat'ed.
+    struct FileKey {
+        uint64_t pathHash = 0;
+        uint64_t fileSize = 0;
+        uint64_t writeTime = 0;
+    };
+    static bool MakeKey(const std::wstring& path, FileKey& key);
+
+    // Cached decision for this exact file version and pattern set
+    bool Lookup(const FileKey& key, uint64_t patternVersion, RouteResult& result) const;
+
+    // Record a decision. Silently skipped if another writer holds the slot.
+    void Store(const FileKey& key, uint64_t patternVersion, const RouteResult& result);
+
+private:
+    MappedFile m_file;
+    RouteCacheSlot* m_slots = nullptr;
+    uint32_t m_slotMask = 0;
+
+    // Slots probed per key before evicting
+    static const uint32_t kProbe = 4;
+};
+
+} // namespace Helium
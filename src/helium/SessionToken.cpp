@@ -1,15 +1,123 @@
 // SessionToken.cpp — DPAPI-encrypted session token management
 
 #include "SessionToken.h"
+#include "FileWatcher.h"
+#include "LatencyStats.h"
+#include "Json.h"
+#include "StringUtil.h"
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <ctime>
 #include <shlobj.h>
+#include <mutex>
+#include <atomic>
 
 namespace Helium {
 
+// Last session read from disk. Everything but the token is kept in the
+// clear; the token is encrypted with CryptProtectMemory (same-process key)
+// and decrypted only into the SessionInfo a caller asked for.
+struct SessionToken::Cache {
+    std::mutex mutex;
+    std::atomic<bool> stale{true};       // Set by the watcher when the file changes
+    bool watching = false;
+    FileWatcher watcher;
+
+    SessionInfo info;                    // token left empty
+    time_t expiry = 0;
+    std::vector<BYTE> protectedToken;    // Padded to CRYPTPROTECTMEMORY_BLOCK_SIZE
+    size_t tokenLength = 0;
+};
+
+SessionToken::Cache& SessionToken::GetCache() {
+    // Never destroyed — StopWatching() joins the watcher before exit
+    static Cache* cache = new Cache();
+    return *cache;
+}
+
 SessionInfo SessionToken::Load() {
+    ScopedLatency timer(LatencyStage::SessionLoad);
+    Cache& cache = GetCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    RefreshCache(cache);
+
+    SessionInfo info = cache.info;
+    if (!info.valid) return info;
+
+    if (time(nullptr) >= cache.expiry) {
+        info.valid = false;
+        info.error = "Session expired";
+        return info;
+    }
+
+    std::vector<BYTE> plain = cache.protectedToken;
+    if (!CryptUnprotectMemory(plain.data(), (DWORD)plain.size(), CRYPTPROTECTMEMORY_SAME_PROCESS)) {
+        info.valid = false;
+        info.error = "Failed to decrypt session";
+        return info;
+    }
+    info.token.assign((const char*)plain.data(), cache.tokenLength);
+    SecureZeroMemory(plain.data(), plain.size());
+    return info;
+}
+
+void SessionToken::RefreshCache(Cache& cache) {
+    if (!cache.watching) {
+        // Float creates the directory at first login; create it ourselves
+        // (parents too) so that login is noticed too. If it still can't be
+        // watched, stay unwatched: every call reads the file and retries.
+        std::wstring path = GetTokenPath();
+        if (!path.empty()) {
+            SHCreateDirectoryExW(nullptr, path.substr(0, path.find_last_of(L"\\/")).c_str(), nullptr);
+            cache.watching = cache.watcher.Start(path, [&cache] { cache.stale = true; });
+        }
+    }
+
+    // Cleared before reading, so a rewrite during the read marks it stale
+    // again. Without a watcher, every call reads the file.
+    if (!cache.stale.exchange(false) && cache.watching) {
+        return;
+    }
+
+    SessionInfo info = ReadFromDisk(cache.expiry);
+    cache.protectedToken.clear();
+    cache.tokenLength = 0;
+
+    if (info.valid) {
+        size_t block = CRYPTPROTECTMEMORY_BLOCK_SIZE;
+        cache.tokenLength = info.token.size();
+        cache.protectedToken.assign((cache.tokenLength + block - 1) / block * block, 0);
+        if (cache.protectedToken.empty()) cache.protectedToken.resize(block);
+        memcpy(cache.protectedToken.data(), info.token.data(), cache.tokenLength);
+
+        if (!CryptProtectMemory(cache.protectedToken.data(), (DWORD)cache.protectedToken.size(),
+                                CRYPTPROTECTMEMORY_SAME_PROCESS)) {
+            // Don't keep a plaintext copy — reread next time instead
+            SecureZeroMemory(cache.protectedToken.data(), cache.protectedToken.size());
+            cache.protectedToken.clear();
+            cache.stale = true;
+            info.valid = false;
+            info.error = "Failed to protect session in memory";
+        }
+    }
+
+    if (!info.token.empty()) {
+        SecureZeroMemory(&info.token[0], info.token.size());
+        info.token.clear();
+    }
+    cache.info = info;
+}
+
+void SessionToken::StopWatching() {
+    Cache& cache = GetCache();
+    cache.watcher.Stop();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.watching = false;
+    cache.stale = true;
+}
+
+SessionInfo SessionToken::ReadFromDisk(time_t& expiry) {
     SessionInfo info;
 
     std::wstring path = GetTokenPath();
@@ -41,18 +149,21 @@ SessionInfo SessionToken::Load() {
         return info;
     }
 
-    // Parse JSON
-    info.username = ExtractJsonString(json, "username");
-    info.token = ExtractJsonString(json, "token");
-    info.expiresAt = ExtractJsonString(json, "expires_at");
-    info.userId = ExtractJsonString(json, "user_id");
+    // Parse JSON — one pass for all four fields
+    static const std::string_view kKeys[] = { "username", "token", "expires_at", "user_id" };
+    std::string_view values[4];
+    ScanJsonStrings(json, kKeys, values, 4);
+    info.username = values[0];
+    info.token = values[1];
+    info.expiresAt = values[2];
+    info.userId = values[3];
 
     if (info.token.empty()) {
         info.error = "Invalid session data (no token)";
         return info;
     }
 
-    if (IsExpired(info.expiresAt)) {
+    if (!ParseExpiry(info.expiresAt, expiry) || time(nullptr) >= expiry) {
         info.error = "Session expired";
         return info;
     }
@@ -80,6 +191,7 @@ bool SessionToken::Save(const SessionInfo& session) {
 
     file.write(encrypted.data(), encrypted.size());
     file.close();
+    GetCache().stale = true;
 
     // Set file ACL to owner-only (defense in depth alongside DPAPI)
     // DPAPI already prevents other-user decryption, but ACLs stop casual reads
@@ -92,14 +204,18 @@ bool SessionToken::Save(const SessionInfo& session) {
 }
 
 bool SessionToken::HasValidSession() {
-    SessionInfo info = Load();
-    return info.valid;
+    Cache& cache = GetCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    RefreshCache(cache);
+    return cache.info.valid && time(nullptr) < cache.expiry;
 }
 
 bool SessionToken::ClearSession() {
     std::wstring path = GetTokenPath();
     if (path.empty()) return false;
-    return DeleteFileW(path.c_str()) != 0;
+    bool deleted = DeleteFileW(path.c_str()) != 0;
+    GetCache().stale = true;
+    return deleted;
 }
 
 std::wstring SessionToken::GetTokenPath() {
@@ -114,12 +230,7 @@ std::wstring SessionToken::GetTokenPath() {
     std::wstring path = programData;
     path += L"\\Helium\\sessions\\";
 
-    // Convert username to wide
-    int size = MultiByteToWideChar(CP_UTF8, 0, username.c_str(), (int)username.size(), nullptr, 0);
-    std::wstring wideUser(size, 0);
-    MultiByteToWideChar(CP_UTF8, 0, username.c_str(), (int)username.size(), &wideUser[0], size);
-
-    path += wideUser;
+    path += Utf8ToWide(username);
     path += L".token.enc";
     return path;
 }
@@ -169,26 +280,6 @@ std::string SessionToken::Decrypt(const std::string& ciphertext) {
     return result;
 }
 
-std::string SessionToken::ExtractJsonString(const std::string& json, const std::string& key) {
-    std::string search = "\"" + key + "\"";
-    size_t pos = json.find(search);
-    if (pos == std::string::npos) return "";
-
-    // Skip past key and colon
-    pos = json.find(":", pos + search.length());
-    if (pos == std::string::npos) return "";
-
-    // Find opening quote of value
-    pos = json.find("\"", pos + 1);
-    if (pos == std::string::npos) return "";
-
-    // Find closing quote
-    size_t end = json.find("\"", pos + 1);
-    if (end == std::string::npos) return "";
-
-    return json.substr(pos + 1, end - pos - 1);
-}
-
 std::string SessionToken::BuildJson(const SessionInfo& session) {
     std::ostringstream json;
     json << "{\n";
@@ -200,25 +291,22 @@ std::string SessionToken::BuildJson(const SessionInfo& session) {
     return json.str();
 }
 
-bool SessionToken::IsExpired(const std::string& expiresAt) {
-    if (expiresAt.empty()) return true;
+bool SessionToken::ParseExpiry(const std::string& expiresAt, time_t& expiry) {
+    if (expiresAt.empty()) return false;
 
     // Parse ISO 8601: "2026-02-19T15:30:00Z"
     struct tm tm = {};
     if (sscanf_s(expiresAt.c_str(), "%d-%d-%dT%d:%d:%d",
         &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
         &tm.tm_hour, &tm.tm_min, &tm.tm_sec) < 6) {
-        return true; // Can't parse = treat as expired
+        return false; // Can't parse = treat as expired
     }
 
     tm.tm_year -= 1900;
     tm.tm_mon -= 1;
 
-    time_t expiry = _mkgmtime(&tm);
-    time_t now;
-    time(&now);
-
-    return difftime(expiry, now) <= 0;
+    expiry = _mkgmtime(&tm);
+    return expiry != (time_t)-1;
 }
 
 } // namespace Helium
@@ -1,11 +1,14 @@
 // SessionToken.h — DPAPI-encrypted session token management
 // Shared authentication between Float and Transforma Reader
+// The decrypted session is cached in-process (token under CryptProtectMemory)
+// and reread only when the sessions directory reports a change to the file.
 
 #pragma once
 
 #include <windows.h>
 #include <wincrypt.h>
 #include <string>
+#include <ctime>
 
 #pragma comment(lib, "crypt32.lib")
 
@@ -24,18 +27,30 @@ class SessionToken {
 public:
     // Load and decrypt session token for current Windows user
     // Reads from: C:\ProgramData\Helium\sessions\{username}.token.enc
+    // Served from the in-process cache unless Float rewrote the file.
     static SessionInfo Load();
 
     // Save and encrypt session token (called by Float after login)
     static bool Save(const SessionInfo& session);
 
-    // Check if a valid (non-expired) session exists
+    // Check if a valid (non-expired) session exists. No disk or DPAPI
+    // access while the cached session is current.
     static bool HasValidSession();
 
     // Delete session (logout)
     static bool ClearSession();
 
+    // Stop watching the sessions directory (call at shutdown)
+    static void StopWatching();
+
 private:
+    struct Cache;
+    static Cache& GetCache();
+
+    // Reread the token file into the cache if it changed. Caller holds the cache lock.
+    static void RefreshCache(Cache& cache);
+    static SessionInfo ReadFromDisk(time_t& expiry);
+
     static std::wstring GetTokenPath();
     static std::string GetWindowsUsername();
 
@@ -44,9 +59,8 @@ private:
     static std::string Decrypt(const std::string& ciphertext);
 
     // Minimal JSON helpers (no external dependency)
-    static std::string ExtractJsonString(const std::string& json, const std::string& key);
     static std::string BuildJson(const SessionInfo& session);
-    static bool IsExpired(const std::string& expiresAt);
+    static bool ParseExpiry(const std::string& expiresAt, time_t& expiry);
 };
 
 } // namespace Helium
@@ -0,0 +1,46 @@
+// StringUtil.cpp — UTF-16 ↔ UTF-8 conversion and path filenames
+
+#include "StringUtil.h"
+#include <windows.h>
+
+namespace Helium {
+
+std::wstring_view FilenamePart(std::wstring_view path) {
+    size_t lastSlash = path.find_last_of(L"\\/");
+    return lastSlash == std::wstring_view::npos ? path : path.substr(lastSlash + 1);
+}
+
+size_t WideToUtf8(std::wstring_view wide, char* out, size_t capacity) {
+    if (wide.empty() || capacity == 0) return 0;
+    int written = WideCharToMultiByte(CP_UTF8, 0, wide.data(), (int)wide.size(),
+                                      out, (int)capacity, nullptr, nullptr);
+    return written > 0 ? (size_t)written : 0;
+}
+
+std::string WideToUtf8(std::wstring_view wide) {
+    if (wide.empty()) return "";
+    int size = WideCharToMultiByte(CP_UTF8, 0, wide.data(), (int)wide.size(), nullptr, 0, nullptr, nullptr);
+    std::string result(size, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wide.data(), (int)wide.size(), &result[0], size, nullptr, nullptr);
+    return result;
+}
+
+std::wstring Utf8ToWide(std::string_view utf8) {
+    if (utf8.empty()) return L"";
+    int size = MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), nullptr, 0);
+    std::wstring result(size, 0);
+    MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), &result[0], size);
+    return result;
+}
+
+Utf8Filename::Utf8Filename(std::wstring_view path) {
+    std::wstring_view name = FilenamePart(path);
+    if (name.empty()) return;
+
+    m_size = WideToUtf8(name, m_buffer, kCapacity);
+    if (m_size == 0) {
+        m_spill = WideToUtf8(name);
+    }
+}
+
+} // namespace Helium
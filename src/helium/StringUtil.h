@@ -0,0 +1,46 @@
+// StringUtil.h — UTF-16 ↔ UTF-8 conversion and path filenames
+// The one place Helium converts strings. Document filenames are converted
+// once, into a stack buffer, and passed on as std::string_view.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace Helium {
+
+// Final component of a Windows path (after the last '\' or '/'); no copy
+std::wstring_view FilenamePart(std::wstring_view path);
+
+// UTF-8 into out. Returns the bytes written; 0 if it doesn't fit.
+size_t WideToUtf8(std::wstring_view wide, char* out, size_t capacity);
+
+std::string WideToUtf8(std::wstring_view wide);
+std::wstring Utf8ToWide(std::string_view utf8);
+
+// A path's filename as UTF-8 — the key the router, duplicate cache, spool
+// and Relay all use. Lives on the stack: no allocation for any name NTFS
+// allows. Build it once per document and hand out View().
+class Utf8Filename {
+public:
+    explicit Utf8Filename(std::wstring_view path);
+
+    std::string_view View() const { return m_spill.empty() ? std::string_view(m_buffer, m_size) : m_spill; }
+    operator std::string_view() const { return View(); }
+
+    // Owned copy, for callbacks that outlive the caller's frame
+    std::string Str() const { return std::string(View()); }
+
+    bool Empty() const { return View().empty(); }
+
+    // A path component is at most 255 UTF-16 units, 3 UTF-8 bytes each
+    static const size_t kCapacity = 255 * 3;
+
+private:
+    char m_buffer[kCapacity];
+    size_t m_size = 0;
+    std::string m_spill;    // Longer than NTFS allows (other filesystems) — rare
+};
+
+} // namespace Helium
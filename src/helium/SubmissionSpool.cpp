@@ -0,0 +1,346 @@
+// SubmissionSpool.cpp — Durable queue of submissions waiting for Relay
+
+#include "SubmissionSpool.h"
+#include "SessionToken.h"
+#include "ContentHash.h"
+#include "StringUtil.h"
+#include <fstream>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+
+namespace Helium {
+
+// Backoff between attempts while Relay is unreachable: 5s, 10s, … 5 min
+static const DWORD kInitialBackoffMs = 5000;
+static const DWORD kMaxBackoffMs = 5 * 60 * 1000;
+
+SubmissionSpool::SubmissionSpool(RelayClient& relay, DuplicateCache& cache)
+    : m_relay(relay), m_cache(cache) {}
+
+SubmissionSpool::~SubmissionSpool() {
+    StopDrain();
+}
+
+bool SubmissionSpool::Load(const std::wstring& spoolDir) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spoolDir = spoolDir;
+    m_entries.clear();
+
+    MappedFile file;
+    if (!file.Open(GetIndexPath())) {
+        return true;  // Nothing spooled yet
+    }
+
+    SpoolHeader expected;
+    if (file.Size() < sizeof(SpoolHeader)) return false;
+    auto header = (const SpoolHeader*)file.Data();
+    if (header->magic != expected.magic || header->version != expected.version) {
+        return false;
+    }
+
+    uint64_t complete = (file.Size() - sizeof(SpoolHeader)) / sizeof(SpoolRecord);
+    uint32_t count = header->entryCount < complete ? header->entryCount : (uint32_t)complete;
+    auto records = (const SpoolRecord*)(file.Data() + sizeof(SpoolHeader));
+
+    bool dropped = false;
+    for (uint32_t i = 0; i < count; i++) {
+        const SpoolRecord& record = records[i];
+        SpoolEntry entry;
+        entry.filename.assign(record.filename, strnlen(record.filename, sizeof(record.filename)));
+        entry.submittedBy.assign(record.submittedBy, strnlen(record.submittedBy, sizeof(record.submittedBy)));
+        entry.contentHash = record.contentHash;
+        entry.fileSize = record.fileSize;
+        entry.queuedTimestamp = record.queuedTimestamp;
+        entry.attempts = record.attempts;
+        entry.spooledPath = SpooledPath(entry.contentHash, entry.filename);
+
+        // Copy deleted by hand — nothing left to send
+        if (GetFileAttributesW(entry.spooledPath.c_str()) == INVALID_FILE_ATTRIBUTES) {
+            dropped = true;
+            continue;
+        }
+        m_entries.push_back(std::move(entry));
+    }
+    file.Close();
+
+    if (dropped) {
+        SaveLocked();
+    }
+    return true;
+}
+
+SpoolStatus SubmissionSpool::Enqueue(const std::wstring& pdfPath, const std::string& user, std::string& error) {
+    Utf8Filename filename(pdfPath);
+
+    MappedFile source;
+    if (!source.Open(pdfPath)) {
+        error = "Could not read PDF file";
+        return SpoolStatus::Failed;
+    }
+    ContentHasher hasher;
+    hasher.Update(source.Data(), (size_t)source.Size());
+    uint64_t contentHash = hasher.Final();
+
+    if (m_cache.Check(filename, contentHash).status == DuplicateStatus::AlreadySubmitted) {
+        return SpoolStatus::AlreadySubmitted;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spoolDir.empty()) {
+        error = "Submission queue unavailable";
+        return SpoolStatus::Failed;
+    }
+    for (const SpoolEntry& entry : m_entries) {
+        if (entry.contentHash == contentHash) {
+            return SpoolStatus::AlreadyQueued;
+        }
+    }
+
+    SpoolEntry entry;
+    entry.filename = filename.Str();
+    entry.submittedBy = user;
+    entry.contentHash = contentHash;
+    entry.fileSize = source.Size();
+    entry.queuedTimestamp = (uint64_t)time(nullptr);
+    entry.spooledPath = SpooledPath(contentHash, filename);
+
+    // Our own copy: the original may be moved or edited before Relay is back
+    if (!CopyIntoSpool(source, entry.spooledPath)) {
+        error = "Could not write to the submission queue";
+        return SpoolStatus::Failed;
+    }
+
+    m_entries.push_back(entry);
+    if (!SaveLocked()) {
+        m_entries.pop_back();
+        DeleteFileW(entry.spooledPath.c_str());
+        RemoveDirectoryW(entry.spooledPath.substr(0, entry.spooledPath.find_last_of(L'\\')).c_str());
+        error = "Could not write to the submission queue";
+        return SpoolStatus::Failed;
+    }
+
+    m_woken = true;
+    m_wake.notify_one();
+    return SpoolStatus::Queued;
+}
+
+bool SubmissionSpool::IsQueued(std::string_view filename, uint64_t contentHash) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const SpoolEntry& entry : m_entries) {
+        if (contentHash ? entry.contentHash == contentHash : entry.filename == filename) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t SubmissionSpool::Count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void SubmissionSpool::StartDrain(const SpoolDrainCallback& onDrained) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return;
+    m_onDrained = onDrained;
+    m_running = true;
+    m_drainThread = std::thread(&SubmissionSpool::DrainLoop, this);
+}
+
+void SubmissionSpool::StopDrain() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wake.notify_one();
+    if (m_drainThread.joinable()) {
+        m_drainThread.join();
+    }
+}
+
+void SubmissionSpool::Wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_woken = true;
+    }
+    m_wake.notify_one();
+}
+
+void SubmissionSpool::DrainLoop() {
+    DWORD backoffMs = kInitialBackoffMs;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return !m_running || !m_entries.empty(); });
+        if (!m_running) break;
+
+        m_woken = false;
+        lock.unlock();
+        bool drained = DrainOnce();
+        lock.lock();
+
+        if (drained && m_entries.empty()) {
+            backoffMs = kInitialBackoffMs;
+            continue;
+        }
+
+        // Relay down, throttling, or only other users' entries left — wait
+        // (or until Wake), doubling each time nothing goes through
+        m_wake.wait_for(lock, std::chrono::milliseconds(backoffMs),
+                        [this] { return !m_running || m_woken; });
+        backoffMs = drained ? kInitialBackoffMs : (backoffMs * 2 < kMaxBackoffMs ? backoffMs * 2 : kMaxBackoffMs);
+    }
+}
+
+bool SubmissionSpool::DrainOnce() {
+    // The health monitor's last word, not a probe of our own; it wakes us
+    // when Relay comes back
+    if (!m_relay.Health().IsReachable()) return false;
+
+    // Sent with the current session; entries queued by another Windows
+    // user's session wait for that user
+    SessionInfo session = SessionToken::Load();
+    if (!session.valid) return false;
+
+    std::vector<SpoolEntry> entries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entries = m_entries;
+    }
+
+    bool sentAny = false;
+    for (const SpoolEntry& entry : entries) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) return true;
+        }
+        if (entry.submittedBy != session.username) continue;
+
+        SubmitResult result = m_relay.SubmitInvoice(
+            entry.spooledPath, session.username, session.token,
+            [this, &entry](uint64_t contentHash) {
+                // Float (or another machine) may have submitted it meanwhile
+                return m_cache.Check(entry.filename, contentHash).status != DuplicateStatus::AlreadySubmitted;
+            });
+
+        if (result.success) {
+            m_cache.AddEntry(entry.filename, result.firsReference, session.username, result.contentHash);
+        } else if (!result.blocked && (result.httpStatus == 0 || result.httpStatus == 401 ||
+                                       result.httpStatus == 429 || result.httpStatus >= 500)) {
+            // Transient: unreachable, signed out, throttled or Relay-side —
+            // keep it and back off
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (SpoolEntry& queued : m_entries) {
+                if (queued.contentHash == entry.contentHash) queued.attempts++;
+            }
+            SaveLocked();
+            return false;
+        }
+
+        // Submitted, already submitted, or rejected for good
+        Remove(entry.contentHash);
+        sentAny = true;
+        if (m_onDrained) {
+            m_onDrained(entry, result);
+        }
+    }
+    return sentAny;
+}
+
+void SubmissionSpool::Remove(uint64_t contentHash) {
+    std::wstring spooledPath;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->contentHash == contentHash) {
+                spooledPath = it->spooledPath;
+                m_entries.erase(it);
+                break;
+            }
+        }
+        if (spooledPath.empty()) return;
+        SaveLocked();
+    }
+
+    DeleteFileW(spooledPath.c_str());
+    RemoveDirectoryW(spooledPath.substr(0, spooledPath.find_last_of(L'\\')).c_str());
+}
+
+bool SubmissionSpool::SaveLocked() {
+    if (m_spoolDir.empty()) return false;
+
+    // Temp file + atomic swap, as for the duplicate cache: a crash never
+    // leaves a half-written spool
+    std::wstring indexPath = GetIndexPath();
+    std::wstring tempPath = indexPath + L".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    SpoolHeader header;
+    header.entryCount = (uint32_t)m_entries.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const SpoolEntry& entry : m_entries) {
+        SpoolRecord record = {};
+        strncpy_s(record.filename, entry.filename.c_str(), sizeof(record.filename) - 1);
+        strncpy_s(record.submittedBy, entry.submittedBy.c_str(), sizeof(record.submittedBy) - 1);
+        record.contentHash = entry.contentHash;
+        record.fileSize = entry.fileSize;
+        record.queuedTimestamp = entry.queuedTimestamp;
+        record.attempts = entry.attempts;
+        file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    file.close();
+    if (file.fail()) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    if (!MoveFileExW(tempPath.c_str(), indexPath.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool SubmissionSpool::CopyIntoSpool(const MappedFile& source, const std::wstring& target) {
+    // First queued submission on this machine — create the spool directory
+    std::wstring entryDir = target.substr(0, target.find_last_of(L'\\'));
+    CreateDirectoryW(m_spoolDir.c_str(), nullptr);
+    CreateDirectoryW(entryDir.c_str(), nullptr);
+
+    HANDLE hFile = CreateFileW(target.c_str(), GENERIC_WRITE, 0, nullptr,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    // From the mapped view already hashed — the original is read once
+    const uint8_t* data = source.Data();
+    uint64_t remaining = source.Size();
+    bool ok = true;
+    while (ok && remaining > 0) {
+        DWORD chunk = remaining < (64 * 1024 * 1024) ? (DWORD)remaining : (64 * 1024 * 1024);
+        DWORD written = 0;
+        ok = WriteFile(hFile, data, chunk, &written, nullptr) && written == chunk;
+        data += chunk;
+        remaining -= chunk;
+    }
+    ok = ok && FlushFileBuffers(hFile);
+    CloseHandle(hFile);
+
+    if (!ok) {
+        DeleteFileW(target.c_str());
+        RemoveDirectoryW(entryDir.c_str());
+    }
+    return ok;
+}
+
+std::wstring SubmissionSpool::SpooledPath(uint64_t contentHash, std::string_view filename) const {
+    // Kept under its own name — Relay records the uploaded filename
+    wchar_t hashDir[17];
+    swprintf_s(hashDir, L"%016llx", (unsigned long long)contentHash);
+
+    return m_spoolDir + L"\\" + hashDir + L"\\" + Utf8ToWide(filename);
+}
+
+} // namespace Helium
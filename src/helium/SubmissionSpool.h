@@ -0,0 +1,123 @@
+// SubmissionSpool.h — Durable queue of submissions waiting for Relay
+// When Float/Relay is down, a submission is accepted into the spool at once:
+// the PDF is copied (and hashed in the same pass) under ProgramData\Helium
+// and a background thread sends it once Relay answers again, backing off
+// exponentially while it doesn't.
+
+#pragma once
+
+#include "RelayClient.h"
+#include "DuplicateCache.h"
+#include <windows.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+namespace Helium {
+
+// File layout (<spool>\spool.dat): [SpoolHeader][SpoolRecord x entryCount]
+// The PDFs themselves live in <spool>\<content hash>\<original filename>.
+#pragma pack(push, 1)
+struct SpoolHeader {
+    uint32_t magic = 0x4C505348;     // "HSPL"
+    uint32_t version = 1;
+    uint32_t entryCount = 0;
+    uint32_t reserved = 0;
+};
+
+struct SpoolRecord {
+    char filename[256];              // UTF-8, as submitted
+    char submittedBy[64];            // Session user that queued it
+    uint64_t contentHash;            // XXH64 of the PDF bytes
+    uint64_t fileSize;
+    uint64_t queuedTimestamp;
+    uint32_t attempts;               // Transient failures so far
+    uint32_t reserved;
+};
+#pragma pack(pop)
+
+enum class SpoolStatus {
+    Queued,
+    AlreadyQueued,      // Same content (or name) is already waiting
+    AlreadySubmitted,   // DuplicateCache knows it — nothing to queue
+    Failed              // Couldn't read the PDF or write the spool
+};
+
+struct SpoolEntry {
+    std::string filename;
+    std::string submittedBy;
+    uint64_t contentHash = 0;
+    uint64_t fileSize = 0;
+    uint64_t queuedTimestamp = 0;
+    uint32_t attempts = 0;
+    std::wstring spooledPath;        // The spool's copy, sent in place of the original
+};
+
+// An entry left the spool: submitted, found already submitted, or rejected
+// by Relay for good. Runs on the drain thread.
+using SpoolDrainCallback = std::function<void(const SpoolEntry& entry, const SubmitResult& result)>;
+
+class SubmissionSpool {
+public:
+    SubmissionSpool(RelayClient& relay, DuplicateCache& cache);
+    ~SubmissionSpool();
+
+    SubmissionSpool(const SubmissionSpool&) = delete;
+    SubmissionSpool& operator=(const SubmissionSpool&) = delete;
+
+    // Read the spool left by earlier runs. Entries whose copy is gone are dropped.
+    bool Load(const std::wstring& spoolDir);
+
+    // Copy the PDF into the spool for submission as user. Checked against
+    // DuplicateCache and the spool by content, so it can't be queued twice.
+    SpoolStatus Enqueue(const std::wstring& pdfPath, const std::string& user, std::string& error);
+
+    // Waiting in the spool (by content hash when given, else by filename)
+    bool IsQueued(std::string_view filename, uint64_t contentHash = 0);
+
+    size_t Count();
+
+    // Start the background drain thread
+    void StartDrain(const SpoolDrainCallback& onDrained);
+
+    // Stop and join it; queued entries stay on disk for the next run
+    void StopDrain();
+
+    // Relay may be back (or the user signed in) — retry now, not at the
+    // end of the current backoff
+    void Wake();
+
+private:
+    RelayClient& m_relay;
+    DuplicateCache& m_cache;
+    SpoolDrainCallback m_onDrained;
+
+    std::mutex m_mutex;
+    std::wstring m_spoolDir;
+    std::vector<SpoolEntry> m_entries;
+
+    std::thread m_drainThread;
+    std::condition_variable m_wake;
+    bool m_running = false;
+    bool m_woken = false;
+
+    void DrainLoop();
+
+    // Try every entry once. Returns false if Relay was unreachable or
+    // pushed back, and the loop should back off.
+    bool DrainOnce();
+
+    void Remove(uint64_t contentHash);
+    bool SaveLocked();
+    bool CopyIntoSpool(const MappedFile& source, const std::wstring& target);
+    std::wstring SpooledPath(uint64_t contentHash, std::string_view filename) const;
+
+    std::wstring GetIndexPath() const { return m_spoolDir + L"\\spool.dat"; }
+};
+
+} // namespace Helium
@@ -10,18 +10,38 @@
 //   In SumatraPDF's Toolbar.cpp (CreateToolbar function), add after toolbar creation:
 //     Helium::SumatraIntegration::AddSubmitButton(hwndToolbar);
 //
-//   In SumatraPDF's SumatraStartup.cpp (WinMain), add early init:
+//   In SumatraPDF's SumatraStartup.cpp (WinMain), first thing after parsing
+//   the command line — a known non-invoice goes to the fallback handler and
+//   a repeat launch hands its file to the running instance; either way exit:
+//     if (Helium::SumatraIntegration::HandleLaunch(filePath)) return 0;
+//
+//   Then register how to open a handed-over file in a new tab, and init:
+//     Helium::SumatraIntegration::SetOpenFileHandler([](const std::wstring& path) {
+//         LoadDocument(path);   // Sumatra's open-in-tab; OnDocumentLoaded follows
+//     });
 //     Helium::SumatraIntegration::Initialize();
 //
 //   In SumatraPDF's Canvas.cpp (OnDocumentLoaded), add:
 //     Helium::SumatraIntegration::OnDocumentLoaded(filePath);
+//
+//   In SumatraPDF's SumatraPDF.cpp (CloseTab), add before the tab is freed:
+//     Helium::SumatraIntegration::OnDocumentClosed(filePath);
+//
+//   For a "Submit All Tabs" menu command, collect each tab's file path and call:
+//     Helium::SumatraIntegration::SubmitAllOpenTabs(filePaths);
 
 #include "helium/HeliumController.h"
+#include "helium/InstanceChannel.h"
 #include <windows.h>
 #include <commctrl.h>
+#include <uxtheme.h>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
 
 #pragma comment(lib, "comctl32.lib")
+#pragma comment(lib, "uxtheme.lib")
 
 namespace Helium {
 
@@ -29,12 +49,23 @@ namespace Helium {
 // SumatraPDF uses IDs in the range 300-500; we use 9000+
 static const int IDC_SUBMIT_FIRS = 9001;
 
+// Posted to the button when the controller's state changes on a worker thread
+static const UINT WM_HELIUM_STATE_CHANGED = WM_APP + 0x4845;
+
 // Global controller instance
 static HeliumController* g_controller = nullptr;
 static HWND g_hwndToolbar = nullptr;
-static HWND g_hwndSubmitButton = nullptr;  // Custom child window for our button
+static std::atomic<HWND> g_hwndSubmitButton{nullptr};  // Custom child window for our button
+static std::atomic<bool> g_statePosted{false};          // A WM_HELIUM_STATE_CHANGED is in the queue
 static int g_submitButtonIndex = -1;
 
+// Single-instance handoff; owned only by the first instance
+static InstanceChannel* g_instance = nullptr;
+static std::function<void(const std::wstring&)> g_openFile;
+
+// A repeat launch waits this long for the first instance to take its file
+static const DWORD kHandOffTimeoutMs = 3000;
+
 // Colors matching the architecture doc
 static const COLORREF COLOR_BLUE    = RGB(0, 120, 215);
 static const COLORREF COLOR_GREEN   = RGB(16, 124, 16);
@@ -53,6 +84,7 @@ static COLORREF GetButtonColor(SubmitButtonState state) {
         case SubmitButtonState::Error:           return COLOR_RED;
         case SubmitButtonState::NoSession:       return COLOR_ORANGE;
         case SubmitButtonState::FloatNotRunning:  return COLOR_ORANGE;
+        case SubmitButtonState::Queued:          return COLOR_GREY;
         default:                                 return COLOR_GREY;
     }
 }
@@ -63,6 +95,77 @@ static bool IsButtonClickable(SubmitButtonState state) {
            state == SubmitButtonState::FloatNotRunning;
 }
 
+// Paint resources, created on first use and kept until Shutdown: one brush
+// and pen per state, and the two label fonts for the current DPI
+static const int kButtonStateCount = (int)SubmitButtonState::Queued + 1;
+static HBRUSH g_stateBrushes[kButtonStateCount] = {};
+static HPEN g_statePens[kButtonStateCount] = {};
+static HFONT g_fontNormal = nullptr;
+static HFONT g_fontSemibold = nullptr;
+static int g_fontDpi = 0;
+
+static HFONT GetLabelFont(HDC hdc, bool semibold) {
+    int dpi = GetDeviceCaps(hdc, LOGPIXELSY);
+    if (dpi != g_fontDpi) {
+        if (g_fontNormal) DeleteObject(g_fontNormal);
+        if (g_fontSemibold) DeleteObject(g_fontSemibold);
+        g_fontNormal = g_fontSemibold = nullptr;
+        g_fontDpi = dpi;
+    }
+
+    HFONT& font = semibold ? g_fontSemibold : g_fontNormal;
+    if (!font) {
+        font = CreateFontW(MulDiv(14, dpi, 96), 0, 0, 0,
+            semibold ? FW_SEMIBOLD : FW_NORMAL,
+            FALSE, FALSE, FALSE,
+            DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+            CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
+    }
+    return font;
+}
+
+static void FreePaintResources() {
+    for (int i = 0; i < kButtonStateCount; i++) {
+        if (g_stateBrushes[i]) DeleteObject(g_stateBrushes[i]);
+        if (g_statePens[i]) DeleteObject(g_statePens[i]);
+        g_stateBrushes[i] = nullptr;
+        g_statePens[i] = nullptr;
+    }
+    if (g_fontNormal) DeleteObject(g_fontNormal);
+    if (g_fontSemibold) DeleteObject(g_fontSemibold);
+    g_fontNormal = g_fontSemibold = nullptr;
+    g_fontDpi = 0;
+}
+
+static void PaintButton(HDC hdc, const RECT& rc, const ButtonStateInfo& state) {
+    int index = (int)state.state;
+    if (index < 0 || index >= kButtonStateCount) index = (int)SubmitButtonState::Checking;
+
+    COLORREF bgColor = GetButtonColor(state.state);
+    if (!g_stateBrushes[index]) g_stateBrushes[index] = CreateSolidBrush(bgColor);
+    if (!g_statePens[index]) g_statePens[index] = CreatePen(PS_SOLID, 1, bgColor);
+
+    // Fill background
+    FillRect(hdc, &rc, g_stateBrushes[index]);
+
+    // Draw rounded border
+    HPEN oldPen = (HPEN)SelectObject(hdc, g_statePens[index]);
+    HBRUSH oldBrush = (HBRUSH)SelectObject(hdc, g_stateBrushes[index]);
+    RoundRect(hdc, rc.left, rc.top, rc.right, rc.bottom, 6, 6);
+    SelectObject(hdc, oldBrush);
+    SelectObject(hdc, oldPen);
+
+    // Draw text — widened once, when the state was published
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, COLOR_WHITE);
+
+    HFONT oldFont = (HFONT)SelectObject(hdc, GetLabelFont(hdc, IsButtonClickable(state.state)));
+    RECT textRect = rc;
+    DrawTextW(hdc, state.displayLabel.c_str(), (int)state.displayLabel.size(), &textRect,
+             DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+    SelectObject(hdc, oldFont);
+}
+
 // Custom button window procedure
 static LRESULT CALLBACK SubmitButtonProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
@@ -73,47 +176,38 @@ static LRESULT CALLBACK SubmitButtonProc(HWND hwnd, UINT msg, WPARAM wParam, LPA
             RECT rc;
             GetClientRect(hwnd, &rc);
 
-            auto state = g_controller ? g_controller->GetButtonState() : ButtonStateInfo{};
-            COLORREF bgColor = GetButtonColor(state.state);
-            bool clickable = IsButtonClickable(state.state);
-
-            // Fill background
-            HBRUSH brush = CreateSolidBrush(bgColor);
-            FillRect(hdc, &rc, brush);
-            DeleteObject(brush);
-
-            // Draw rounded border
-            HPEN pen = CreatePen(PS_SOLID, 1, bgColor);
-            HPEN oldPen = (HPEN)SelectObject(hdc, pen);
-            RoundRect(hdc, rc.left, rc.top, rc.right, rc.bottom, 6, 6);
-            SelectObject(hdc, oldPen);
-            DeleteObject(pen);
-
-            // Draw text
-            SetBkMode(hdc, TRANSPARENT);
-            SetTextColor(hdc, COLOR_WHITE);
-
-            HFONT font = CreateFontW(14, 0, 0, 0,
-                clickable ? FW_SEMIBOLD : FW_NORMAL,
-                FALSE, FALSE, FALSE,
-                DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-                CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-            HFONT oldFont = (HFONT)SelectObject(hdc, font);
+            // No lock, no copy: the snapshot stays valid while we hold it
+            std::shared_ptr<const ButtonStateInfo> snapshot =
+                g_controller ? g_controller->GetButtonState() : nullptr;
+            static const ButtonStateInfo kNoState = {};
+            const ButtonStateInfo& state = snapshot ? *snapshot : kNoState;
+
+            // Compose off-screen and copy it over in one blit — no erase
+            // pass, so spinner repaints don't flicker
+            HDC target = nullptr;
+            HPAINTBUFFER buffer = BeginBufferedPaint(hdc, &rc, BPBF_COMPATIBLEBITMAP, nullptr, &target);
+            PaintButton(buffer ? target : hdc, rc, state);
+            if (buffer) {
+                EndBufferedPaint(buffer, TRUE);
+            }
 
-            std::wstring label(state.label.begin(), state.label.end());
-            DrawTextW(hdc, label.c_str(), -1, &rc,
-                     DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+            EndPaint(hwnd, &ps);
+            return 0;
+        }
 
-            SelectObject(hdc, oldFont);
-            DeleteObject(font);
+        case WM_ERASEBKGND:
+            return 1;  // WM_PAINT covers every pixel
 
-            EndPaint(hwnd, &ps);
+        case WM_HELIUM_STATE_CHANGED: {
+            // Cleared first, so a change during the repaint posts again
+            g_statePosted = false;
+            InvalidateRect(hwnd, nullptr, FALSE);
             return 0;
         }
 
         case WM_LBUTTONUP: {
             if (!g_controller) break;
-            auto state = g_controller->GetButtonState();
+            auto state = *g_controller->GetButtonState();
 
             if (state.state == SubmitButtonState::Ready) {
                 // Get current document path from SumatraPDF
@@ -124,6 +218,8 @@ static LRESULT CALLBACK SubmitButtonProc(HWND hwnd, UINT msg, WPARAM wParam, LPA
                 // Launch Float for login
                 ShellExecuteW(nullptr, L"open", L"float.exe", nullptr, nullptr, SW_SHOWNORMAL);
             } else if (state.state == SubmitButtonState::FloatNotRunning) {
+                // Queue the invoice (sent once Relay answers) and start Float
+                // g_controller->OnSubmitClicked(GetCurrentDocPath());
                 ShellExecuteW(nullptr, L"open", L"float.exe", nullptr, nullptr, SW_SHOWNORMAL);
             }
             return 0;
@@ -131,8 +227,7 @@ static LRESULT CALLBACK SubmitButtonProc(HWND hwnd, UINT msg, WPARAM wParam, LPA
 
         case WM_SETCURSOR: {
             if (!g_controller) break;
-            auto state = g_controller->GetButtonState();
-            if (IsButtonClickable(state.state)) {
+            if (IsButtonClickable(g_controller->GetButtonState()->state)) {
                 SetCursor(LoadCursor(nullptr, IDC_HAND));
                 return TRUE;
             }
@@ -145,19 +240,67 @@ static LRESULT CALLBACK SubmitButtonProc(HWND hwnd, UINT msg, WPARAM wParam, LPA
 
 class SumatraIntegration {
 public:
+    // Call first in WinMain. True if the file was dealt with (opened with
+    // the fallback handler, or taken by the running Transforma) — exit
+    // without creating a window. False: start normally.
+    static bool HandleLaunch(const std::wstring& filePath) {
+        // Tier 1 + route cache only; manuals and contracts never pay for
+        // the viewer's startup
+        if (HeliumController::RouteBeforeLaunch(filePath) == LaunchRoute::OpenedWithFallback) {
+            return true;
+        }
+        return HandOffToRunningInstance(filePath);
+    }
+
+    // True if another Transforma took filePath (may be empty). False: this
+    // is the first instance, or the running one didn't answer.
+    static bool HandOffToRunningInstance(const std::wstring& filePath) {
+        auto channel = new InstanceChannel();
+        if (channel->Claim()) {
+            g_instance = channel;     // Listens once Initialize runs
+            return false;
+        }
+        delete channel;
+        return InstanceChannel::Forward(filePath, kHandOffTimeoutMs);
+    }
+
+    // How to open a file handed over by a repeat launch (new tab)
+    static void SetOpenFileHandler(std::function<void(const std::wstring&)> openFile) {
+        g_openFile = std::move(openFile);
+    }
+
     // Call once at startup (WinMain)
     static void Initialize() {
         g_controller = new HeliumController();
-        g_controller->Initialize();
 
-        // Register button state change callback
+        // Register button state change callback — before Initialize, whose
+        // startup stages publish the first real state from the thread pool
         g_controller->SetButtonStateCallback([](const ButtonStateInfo& info) {
-            // Repaint the button when state changes
-            if (g_hwndSubmitButton) {
-                InvalidateRect(g_hwndSubmitButton, nullptr, TRUE);
+            // Any thread: hand the repaint to the UI thread. One message in
+            // the queue is enough — paint reads the latest state.
+            HWND hwnd = g_hwndSubmitButton;
+            if (hwnd && !g_statePosted.exchange(true)) {
+                if (!PostMessageW(hwnd, WM_HELIUM_STATE_CHANGED, 0, 0)) {
+                    g_statePosted = false;
+                }
             }
         });
 
+        // Returns at once; the button shows "Checking..." until it's done
+        g_controller->Initialize();
+
+        // Repeat launches from here on open as tabs in this process
+        if (g_instance) {
+            g_instance->Listen([](const std::wstring& path) {
+                if (g_openFile && !path.empty()) {
+                    g_openFile(path);
+                }
+            });
+        }
+
+        // Buffers for flicker-free painting, reused across WM_PAINTs
+        BufferedPaintInit();
+
         // Register the custom button window class
         WNDCLASSW wc = {};
         wc.lpfnWndProc = SubmitButtonProc;
@@ -196,16 +339,37 @@ public:
 
         // Repaint button
         if (g_hwndSubmitButton) {
-            InvalidateRect(g_hwndSubmitButton, nullptr, TRUE);
+            InvalidateRect(g_hwndSubmitButton, nullptr, FALSE);
         }
     }
 
+    // Call when a tab closes — cancels that document's upload, if any
+    static void OnDocumentClosed(const std::wstring& filePath) {
+        if (!g_controller) return;
+        g_controller->OnPdfClosed(filePath);
+    }
+
+    // Submit every open document in one batch. Per-file results show in
+    // the button label ("Submitting 3/8"); the final state follows the
+    // visible tab.
+    static bool SubmitAllOpenTabs(const std::vector<std::wstring>& filePaths) {
+        if (!g_controller) return false;
+        return g_controller->SubmitBatch(filePaths, nullptr, nullptr);
+    }
+
     // Call on application exit
     static void Shutdown() {
+        // Stop accepting handoffs first; a later launch starts fresh
+        if (g_instance) {
+            delete g_instance;
+            g_instance = nullptr;
+        }
         if (g_controller) {
             delete g_controller;
             g_controller = nullptr;
         }
+        FreePaintResources();
+        BufferedPaintUnInit();
     }
 };
 
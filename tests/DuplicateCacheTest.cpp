@@ -0,0 +1,130 @@
+// DuplicateCacheTest.cpp — Float sync must merge by content, like Check()
+// A Float row whose filename is already cached but whose content differs is
+// a different invoice: it has to be imported, or Check() would pass it again.
+// Builds its fixtures under %TEMP%\HeliumTest; exits non-zero on failure.
+
+#include "DuplicateCache.h"
+#include <windows.h>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+using namespace Helium;
+
+static int g_failures = 0;
+
+static void Expect(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+static CacheEntry MakeEntry(const char* filename, const char* firsRef, uint64_t contentHash, uint64_t stamp) {
+    CacheEntry e = {};
+    strncpy_s(e.filename, filename, sizeof(e.filename) - 1);
+    strncpy_s(e.firsReference, firsRef, sizeof(e.firsReference) - 1);
+    strncpy_s(e.submittedBy, "float@gtbank.example", sizeof(e.submittedBy) - 1);
+    e.submitTimestamp = stamp;
+    e.contentHash = contentHash;
+    return e;
+}
+
+// Float's export: wide (version 2) rows in submission order
+static bool WriteExport(const std::wstring& path, const std::vector<CacheEntry>& rows) {
+    CacheHeader header;
+    header.entryCount = (uint32_t)rows.size();
+    HANDLE hFile = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    DWORD written = 0;
+    BOOL ok = WriteFile(hFile, &header, sizeof(header), &written, nullptr) &&
+              WriteFile(hFile, rows.data(), (DWORD)(rows.size() * sizeof(CacheEntry)), &written, nullptr);
+    CloseHandle(hFile);
+    return ok != FALSE;
+}
+
+// Sync runs on the watcher thread; give it a few seconds to import
+static DuplicateCheckResult WaitForSubmitted(DuplicateCache& cache, const char* filename, uint64_t contentHash) {
+    DuplicateCheckResult result;
+    for (int i = 0; i < 50; i++) {
+        result = cache.Check(filename, contentHash);
+        if (result.status == DuplicateStatus::AlreadySubmitted) break;
+        Sleep(100);
+    }
+    return result;
+}
+
+int main() {
+    wchar_t temp[MAX_PATH];
+    GetTempPathW(MAX_PATH, temp);
+    std::wstring dir = std::wstring(temp) + L"HeliumTest";
+    CreateDirectoryW(dir.c_str(), nullptr);
+
+    std::wstring cachePath = dir + L"\\sync-content.cache";
+    std::wstring exportPath = dir + L"\\float-submissions.cache";
+    WIN32_FIND_DATAW found;
+    HANDLE hFind = FindFirstFileW((dir + L"\\*").c_str(), &found);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            DeleteFileW((dir + L"\\" + found.cFileName).c_str());
+        } while (FindNextFileW(hFind, &found));
+        FindClose(hFind);
+    }
+
+    uint64_t now = (uint64_t)time(nullptr);
+    {
+        DuplicateCache cache;
+        Expect(cache.Load(cachePath), "empty cache loads");
+        cache.AddEntry("INV-0001.pdf", "FIRS-LOCAL-1", "clerk@gtbank.example", 0x1111);
+        cache.Flush();
+
+        // Same name, new content (must merge); same content under a new
+        // name (already known); and two same-named rows that differ only
+        // in content, within one batch (both must merge)
+        std::vector<CacheEntry> rows = {
+            MakeEntry("INV-0001.pdf", "FIRS-FLOAT-1", 0x2222, now),
+            MakeEntry("renamed copy.pdf", "FIRS-FLOAT-2", 0x1111, now),
+            MakeEntry("INV-0002.pdf", "FIRS-FLOAT-3", 0x3333, now),
+            MakeEntry("INV-0002.pdf", "FIRS-FLOAT-4", 0x4444, now),
+        };
+        Expect(WriteExport(exportPath, rows), "export written");
+        cache.StartBackgroundSync(exportPath);
+
+        DuplicateCheckResult result = WaitForSubmitted(cache, "INV-0001.pdf", 0x2222);
+        Expect(result.status == DuplicateStatus::AlreadySubmitted,
+               "same-name row with different content is merged");
+        Expect(result.firsReference == "FIRS-FLOAT-1", "merged row keeps Float's reference");
+
+        result = cache.Check("INV-0001.pdf", 0x1111);
+        Expect(result.firsReference == "FIRS-LOCAL-1", "local entry is untouched");
+
+        result = cache.Check("renamed copy.pdf", 0);
+        Expect(result.status == DuplicateStatus::NotSubmitted, "row with known content is not re-imported");
+
+        Expect(WaitForSubmitted(cache, "INV-0002.pdf", 0x3333).status == DuplicateStatus::AlreadySubmitted,
+               "first same-named row in a batch is merged");
+        Expect(WaitForSubmitted(cache, "INV-0002.pdf", 0x4444).status == DuplicateStatus::AlreadySubmitted,
+               "second same-named row with other content is merged");
+
+        cache.StopBackgroundSync();
+        cache.Flush();
+    }
+
+    // And it all survived to disk
+    {
+        DuplicateCache cache;
+        Expect(cache.Load(cachePath), "cache reloads");
+        Expect(cache.Check("INV-0001.pdf", 0x2222).status == DuplicateStatus::AlreadySubmitted,
+               "merged row is persisted");
+        Expect(cache.Check("INV-0002.pdf", 0x4444).status == DuplicateStatus::AlreadySubmitted,
+               "batch rows are persisted");
+    }
+
+    if (g_failures == 0) {
+        printf("DuplicateCacheTest: all passed\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}